@@ -2,15 +2,41 @@
 
 // raymath.h should be included after raylib.h
 #include <raymath.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyfiledialogs.h>
 
 #include "utils/button.h"
 #include "utils/darray.h"
-#include "utils/dfa.h"
 #include "utils/funcs.h"
+#include "utils/graph_renderer.h"
 #include "utils/input.h"
-#include "utils/nfa.h"
+#include "utils/memory.h"
+#include "utils/slider.h"
 #include "utils/strops.h"
+#include "utils/test_suite.h"
 #include "utils/text.h"
+#include "utils/text_layout.h"
+#include "utils/trace.h"
+
+// Seconds a single animation phase takes at 1x speed
+#define ANIMATION_PHASE_DURATION 1.0f
+// Longest frame time fed to the scheduler, avoids a burst after a stall
+#define ANIMATION_MAX_FRAME_TIME 0.25f
+#define ANIMATION_INPUT_FONT_SIZE 48
+#define ANIMATION_CURRENT_INPUT_FONT_SIZE 72
+// Speed slider range as powers of two
+#define ANIMATION_MIN_SPEED_EXP -2.0f
+#define ANIMATION_MAX_SPEED_EXP 6.0f
+#define ANIMATION_TESTS_WIDTH 420
+#define ANIMATION_TESTS_FONT_SIZE 24
+#define ANIMATION_TESTS_ROW_HEIGHT 28
+// Rows above the list of failing strings
+#define ANIMATION_TESTS_HEADER_ROWS 2
+// Longer failing strings are cut off in the list
+#define ANIMATION_TESTS_MAX_CHARS 32
+// Longer inputs are traced on the worker pool
+#define ANIMATION_ASYNC_TRACE_LENGTH (64 * 1024)
 
 typedef enum AnimatingState {
     ANIMATING_STATE_NONE = 0,
@@ -26,8 +52,13 @@ static Camera2D camera;
 static RenderTexture2D target;
 static float scale;
 static Rectangle source, dest;
-static Node *initial_state = NULL;
-static Node **current_states = NULL;
+static GraphRenderer renderer;
+static RunTrace *trace = NULL;
+static RunTrace *pending_trace = NULL;  // Built on the worker pool
+static CompletionQueue traced_jobs;
+static u64 trace_step;  // Symbols consumed by the highlighted states
+static u64 timeline_step;  // Step shown on the timeline
+static Slider timeline_slider;
 static bool invalid_input = false;
 static AnimatingState anim_state, anim_prev_state, anim_next_state;
 
@@ -35,9 +66,9 @@ static InputBox input;
 static bool change_screen = false;
 static bool animating = false;
 static bool paused = false;
-static u64 frame_count;
-// TODO: UI for changing the speed
+static float step_timer;
 static float speed = 1.0f;
+static Slider speed_slider;
 
 enum Result {
     RESULT_NONE = 0,
@@ -45,20 +76,42 @@ enum Result {
     RESULT_REJECTED,
 } result = RESULT_NONE;
 
+// Where the current symbol starts in the small and the large font, and where
+// the symbol after it starts
 static Vector2 previous_input_vec, current_input_vec, next_input_vec;
+// Glyph offsets of the input, the current character is drawn larger
+static TextRun input_run;
+// Input strip layout is only recomputed when one of these changes
+static i32 layout_index, layout_width, layout_height;
 
 static const char *input_text = NULL;
+// Input loaded from a file or picked from the failing tests, used while the
+// input box is left untouched
+static char *file_input = NULL;
+static u32 file_input_length;
+static u32 file_input_generation;
 static u32 input_text_length = 0;
 static i32 input_text_index = -1;
 
-enum { TEXT_BOX_INPUT, TEXT_BOX_MAX };
+static TestSuite *tests = NULL;
+static bool tests_returned;  // The job of the current suite came back
+static CompletionQueue completed_jobs;
+static u64 tests_scroll;  // First failing string shown in the list
+
+enum { TEXT_BOX_INPUT, TEXT_BOX_SPEED, TEXT_BOX_POSITION, TEXT_BOX_MAX };
 
 TextBox text_boxes[TEXT_BOX_MAX];
 
 enum {
     BUTTON_BACK_TO_EDITOR = 0,
     BUTTON_TOGGLE_ANIMATION,
+    BUTTON_LOAD_INPUT,
+    BUTTON_LOAD_TESTS,
+    BUTTON_PASTE_TESTS,
     BUTTON_PAUSE,
+    BUTTON_STEP_BACK,
+    BUTTON_STEP_FORWARD,
+    BUTTON_RESULT,
     BUTTON_MAX
 };
 
@@ -78,41 +131,67 @@ static void animation_update_nodes_and_tlines(GlobalState *gs);
 
 static void on_toggle_animation_button_clicked(GlobalState *gs);
 static void on_back_to_editor_button_clicked(GlobalState *gs);
+static void on_load_input_button_clicked(GlobalState *gs);
+static void on_load_tests_button_clicked(GlobalState *gs);
+static void on_paste_tests_button_clicked(GlobalState *gs);
 static void on_puase_button_clicked(GlobalState *gs);
+static void on_step_back_button_clicked(GlobalState *gs);
+static void on_step_forward_button_clicked(GlobalState *gs);
+static void on_result_button_clicked(GlobalState *gs);
 
 static void (*on_button_clicked[BUTTON_MAX])(GlobalState *gs) = {
     on_back_to_editor_button_clicked, on_toggle_animation_button_clicked,
-    on_puase_button_clicked};
+    on_load_input_button_clicked,     on_load_tests_button_clicked,
+    on_paste_tests_button_clicked,    on_puase_button_clicked,
+    on_step_back_button_clicked,      on_step_forward_button_clicked,
+    on_result_button_clicked};
 
+static void animation_reset(void);
 static void animation_animate(GlobalState *gs);
+static void animation_step(GlobalState *gs);
+static void animation_seek(u64 step);
+static bool animation_is_settled(void);
+static void animation_highlight(GlobalState *gs);
+static void animation_set_speed(GlobalState *gs, float value);
+static void animation_update_timeline(GlobalState *gs);
+static void animation_layout_input(void);
+static bool animation_is_active(GlobalState *gs);
+static void animation_set_file_input(char *text, u32 len, const char *label);
+static void animation_load_tests(GlobalState *gs, char *text, u64 len);
+static void animation_drop_tests(void);
+static void animation_start(RunTrace *rt);
+static void animation_drop_trace(void);
+static void animation_poll_jobs(void);
+
+static void animation_release_jobs(GlobalState *gs);
+static Rectangle animation_get_tests_rect(void);
+static u32 animation_get_tests_rows(Rectangle rect);
+static i32 animation_update_tests(GlobalState *gs, Vector2 mpos, i32 handled);
+static void animation_draw_tests(GlobalState *gs);
 
 void animation_load(GlobalState *gs) {
     bg = DARKGRAY;
     change_screen = false;
-    initial_state = NULL;
-    anim_state = anim_next_state = anim_prev_state = ANIMATING_STATE_NONE;
     animating = false;
     paused = false;
-    frame_count = 0;
-    input_text_index = -1;
     invalid_input = false;
-    result = RESULT_NONE;
+    animation_reset();
     camera = (Camera2D){.target = (Vector2){0},
                         .offset = (Vector2){0},
                         .rotation = 0.0f,
                         .zoom = 1.0f};
 
     u64 length = darray_get_size(gs->nodes);
-    for (u64 i = 0; i < length; ++i) {
-        gs->nodes[i].editing = false;
-        if (gs->nodes[i].initial_state) initial_state = &gs->nodes[i];
-    }
+    for (u64 i = 0; i < length; ++i) gs->nodes[i].editing = false;
     length = darray_get_size(gs->tlines);
     for (u64 i = 0; i < length; ++i) gs->tlines[i].editing = false;
+    // Normally the editor kept the table up to date and this does nothing
+    if (!fsm_table_sync(&gs->table, gs->nodes, gs->tlines, gs->version))
+        TraceLog(LOG_ERROR, "Failed to compile the automaton");
 
-    target = LoadRenderTexture(1600, 160);
-
-    current_states = darray_create(Node *);
+    target = LoadRenderTexture(1600, 200);
+    graph_renderer_create(&renderer);
+    text_run_create(&input_run, gs->font, ANIMATION_INPUT_FONT_SIZE, 1.0f);
 
     struct {
             Rectangle rect;
@@ -120,7 +199,9 @@ void animation_load(GlobalState *gs) {
             u32 len;
             Color color;
     } text_box_params[TEXT_BOX_MAX] = {
-        {{10, 10, 200, 48}, "Input", 5, WHITE},
+        {  {10, 10, 200, 48}, "Input", 5, WHITE},
+        {{1000, 80, 200, 48}, "Speed", 5, WHITE},
+        {{1380, 140, 200, 48}, "0/0", 3, WHITE},
     };
 
     for (u32 i = 0; i < TEXT_BOX_MAX; ++i) {
@@ -130,7 +211,7 @@ void animation_load(GlobalState *gs) {
                                    text_box_params[i].len, gs->font);
     }
 
-    input_box_create(&input, (Rectangle){210, 10, 900, 48}, 256);
+    input_box_create(&input, (Rectangle){210, 10, 800, 48}, 256);
     input_box_set_font(&input, gs->font);
 
     struct {
@@ -139,8 +220,14 @@ void animation_load(GlobalState *gs) {
             u64 len;
     } button_params[BUTTON_MAX] = {
         {{1280, 10, 300, 48},  "Back to Editor", 14},
-        { {450, 80, 300, 48}, "Start animation", 15},
-        { {800, 80, 300, 48}, "Pause animation", 15}
+        {  {10, 80, 300, 48}, "Start animation", 15},
+        {{1020, 10, 240, 48},      "Load input", 10},
+        {{10, 140, 240, 48},       "Load tests", 10},
+        {{260, 140, 240, 48},     "Paste tests", 11},
+        { {330, 80, 300, 48}, "Pause animation", 15},
+        { {650, 80, 80, 48},               "<", 1},
+        { {740, 80, 80, 48},               ">", 1},
+        { {840, 80, 140, 48},          "Result", 6}
     };
 
     for (u32 i = 0; i < BUTTON_MAX; ++i) {
@@ -149,21 +236,35 @@ void animation_load(GlobalState *gs) {
                                  button_params[i].len, gs->font);
     }
 
-    button_disable(&buttons[BUTTON_PAUSE]);
+    for (u32 i = BUTTON_PAUSE; i < BUTTON_MAX; ++i) button_disable(&buttons[i]);
+
+    slider_create(&speed_slider, (Rectangle){1220, 90, 360, 28},
+                  ANIMATION_MIN_SPEED_EXP, ANIMATION_MAX_SPEED_EXP);
+    animation_set_speed(gs, log2f(speed));
+
+    slider_create(&timeline_slider, (Rectangle){520, 148, 840, 32}, 0, 0);
 }
 
 void animation_unload(GlobalState *gs) {
     UNUSED(gs);
     UnloadRenderTexture(target);
+    graph_renderer_destroy(&renderer);
+    text_run_destroy(&input_run);
+    memory_free(file_input);
+    file_input = NULL;
 
     input_box_destroy(&input);
     for (u32 i = 0; i < TEXT_BOX_MAX; ++i) text_box_destroy(&text_boxes[i]);
     for (u32 i = 0; i < BUTTON_MAX; ++i) button_destroy(&buttons[i]);
+    slider_destroy(&speed_slider);
+    slider_destroy(&timeline_slider);
 
-    darray_destroy(current_states);
+    animation_drop_trace();
+    animation_drop_tests();
 }
 
 ScreenChangeType animation_update(GlobalState *gs) {
+    animation_poll_jobs();
     animation_update_transforms();
 
     i32 handled = INPUT_NONE;
@@ -177,16 +278,30 @@ ScreenChangeType animation_update(GlobalState *gs) {
         if (buttons[i].clicked) on_button_clicked[i](gs);
     }
 
+    handled = slider_update(&speed_slider, mpos, handled);
+    if (speed_slider.changed)
+        animation_set_speed(gs, slider_get_value(&speed_slider));
+
+    if (animating) {
+        handled = slider_update(&timeline_slider, mpos, handled);
+        if (timeline_slider.changed)
+            animation_seek((u64)roundf(slider_get_value(&timeline_slider)));
+    }
+
+    handled = animation_update_tests(gs, GetMousePosition(), handled);
+
     mpos = GetScreenToWorld2D(GetMousePosition(), camera);
 
     animation_update_nodes_and_tlines(gs);
 
     handled = animation_update_world(mpos, gs, handled);
 
-    if (animating && !paused) {
-        frame_count++;
+    if (animating) {
+        if (!paused) animation_animate(gs);
 
-        animation_animate(gs);
+        animation_highlight(gs);
+        animation_layout_input();
+        animation_update_timeline(gs);
     }
 
     if (change_screen) return SCREEN_CHANGE;
@@ -201,28 +316,36 @@ void animation_draw(GlobalState *gs) {
 
     draw_grid(camera, 1.0f, 100.0f, GRAY);
 
-    u64 length = darray_get_size(gs->tlines);
-    for (u32 i = 0; i < length; ++i) tline_draw(&gs->tlines[i]);
-    length = darray_get_size(gs->nodes);
-    for (u32 i = 0; i < length; ++i) node_draw(&gs->nodes[i]);
+    graph_renderer_draw(&renderer, gs->nodes, gs->tlines, camera.zoom);
 
     EndMode2D();
 
     DrawTexturePro(target.texture, source, dest, (Vector2){0}, 0.0f, WHITE);
 
+    animation_draw_tests(gs);
+
     if (animating) {
         if (input_text_index >= 0) {
-            DrawTextEx(gs->font, TextSubtext(input_text, 0, input_text_index),
-                       previous_input_vec, 48, 1.0f, WHITE);
-
-            DrawTextEx(gs->font, TextSubtext(input_text, input_text_index, 1),
-                       current_input_vec, 72, 1.0f, WHITE);
+            text_run_draw(&input_run, input_text, 0, input_text_index,
+                          input_text_index, previous_input_vec, 0,
+                          GetScreenWidth(), WHITE);
+
+            if (input_text_index < (i32)input_text_length)
+                DrawTextCodepoint(gs->font, input_text[input_text_index],
+                                  current_input_vec,
+                                  ANIMATION_CURRENT_INPUT_FONT_SIZE, WHITE);
         }
 
-        DrawTextEx(gs->font,
-                   TextSubtext(input_text, input_text_index + 1,
-                               input_text_length - input_text_index - 1),
-                   next_input_vec, 48, 1.0f, WHITE);
+        text_run_draw(&input_run, input_text, input_text_index + 1,
+                      input_text_length, input_text_index + 1, next_input_vec,
+                      0, GetScreenWidth(), WHITE);
+    }
+    if (pending_trace) {
+        const char *text =
+            arena_format(&gs->frame, "Tracing %d%%",
+                         (int)(job_get_progress(&pending_trace->job) * 100));
+        DrawTextEx(gs->font, text, (Vector2){10, GetScreenHeight() - 48}, 48,
+                   1.0f, WHITE);
     }
     if (invalid_input) {
         DrawTextEx(gs->font, "Invalid input!",
@@ -246,12 +369,23 @@ void animation_draw(GlobalState *gs) {
 
 void animation_before_draw(GlobalState *gs) {
     UNUSED(gs);
+    // The run position is only shown while animating
+    u32 text_box_max = animating ? TEXT_BOX_MAX : TEXT_BOX_POSITION;
+    bool dirty = input.dirty;
+    for (u32 i = 0; i < text_box_max; ++i) dirty |= text_boxes[i].dirty;
+    for (u32 i = 0; i < BUTTON_MAX; ++i) dirty |= button_is_dirty(&buttons[i]);
+    dirty |= speed_slider.dirty;
+    dirty |= animating && timeline_slider.dirty;
+    if (!dirty) return;
+
     BeginTextureMode(target);
     ClearBackground(GRAY);
 
-    for (u32 i = 0; i < TEXT_BOX_MAX; ++i) text_box_draw(&text_boxes[i]);
+    for (u32 i = 0; i < text_box_max; ++i) text_box_draw(&text_boxes[i]);
     input_box_draw(&input);
     for (u32 i = 0; i < BUTTON_MAX; ++i) button_draw(&buttons[i]);
+    slider_draw(&speed_slider);
+    if (animating) slider_draw(&timeline_slider);
 
     EndTextureMode();
 }
@@ -346,30 +480,80 @@ static void animation_update_nodes_and_tlines(GlobalState *gs) {
 
 static void on_toggle_animation_button_clicked(GlobalState *gs) {
     invalid_input = false;
-    if (animating) {
+    if (animating || pending_trace) {
         button_set_text_and_font(&buttons[BUTTON_TOGGLE_ANIMATION],
                                  "Start animation", 15, gs->font);
         animating = false;
-        button_disable(&buttons[BUTTON_PAUSE]);
-        result = RESULT_NONE;
-        anim_state = anim_prev_state = anim_next_state = ANIMATING_STATE_NONE;
+        for (u32 i = BUTTON_PAUSE; i < BUTTON_MAX; ++i)
+            button_disable(&buttons[i]);
+        animation_reset();
+        animation_drop_trace();
+        button_enable(&buttons[BUTTON_LOAD_INPUT]);
         input_box_enable(&input);
     } else {
-        input_text_index = -1;
-        result = RESULT_NONE;
-        anim_state = anim_prev_state = anim_next_state = ANIMATING_STATE_NONE;
+        animation_reset();
+
+        if (file_input && input.generation == file_input_generation) {
+            input_text = file_input;
+            input_text_length = file_input_length;
+        } else {
+            input_text = input_box_get_text(&input, &input_text_length);
+        }
 
-        input_text = input_box_get_text(&input, &input_text_length);
         if (!all_chars_present(gs->alphabet, input_text)) {
             invalid_input = true;
             return;
         }
 
+        RunTrace *rt =
+            (RunTrace *)memory_alloc(sizeof(RunTrace), MEMORY_TAG_ENGINE);
+        if (!rt
+            || !run_trace_create(rt, &gs->table, input_text,
+                                 input_text_length)) {
+            memory_free(rt);
+            TraceLog(LOG_ERROR, "Failed to allocate the run trace");
+            return;
+        }
+
         button_set_text_and_font(&buttons[BUTTON_TOGGLE_ANIMATION],
                                  "Stop animation", 14, gs->font);
-        animating = true;
-        button_enable(&buttons[BUTTON_PAUSE]);
+        button_disable(&buttons[BUTTON_LOAD_INPUT]);
         input_box_disable(&input);
+
+        if (input_text_length < ANIMATION_ASYNC_TRACE_LENGTH) {
+            run_trace_build(rt, NULL);
+            animation_start(rt);
+            return;
+        }
+        run_trace_run(rt, &gs->workers, &traced_jobs);
+        pending_trace = rt;
+    }
+}
+
+// Takes ownership of the built trace
+static void animation_start(RunTrace *rt) {
+    trace = rt;
+    slider_set_range(&timeline_slider, 0, input_text_length);
+    timeline_step = UINT64_MAX;
+
+    text_run_set_text(&input_run, input_text, input_text_length);
+    layout_width = layout_height = 0;
+
+    animating = true;
+    for (u32 i = BUTTON_PAUSE; i < BUTTON_MAX; ++i)
+        button_enable(&buttons[i]);
+}
+
+// A trace that is still built is freed once its job comes back
+static void animation_drop_trace(void) {
+    if (trace) {
+        run_trace_destroy(trace);
+        memory_free(trace);
+        trace = NULL;
+    }
+    if (pending_trace) {
+        job_cancel(&pending_trace->job);
+        pending_trace = NULL;
     }
 }
 
@@ -378,6 +562,51 @@ static void on_back_to_editor_button_clicked(GlobalState *gs) {
     gs->next_screen = &editor;
 }
 
+static void on_load_input_button_clicked(GlobalState *gs) {
+    char *file_name =
+        tinyfd_openFileDialog("Open the input file", NULL, 0, NULL, NULL, 0);
+
+    if (!file_name) return;
+
+    u32 len;
+    char *text = load_text_file(file_name, &len);
+    if (!text) {
+        TraceLog(LOG_ERROR, "Failed to read %s", file_name);
+        return;
+    }
+
+    animation_set_file_input(
+        text, len, arena_format(&gs->frame, "<%s>", GetFileName(file_name)));
+}
+
+static void on_load_tests_button_clicked(GlobalState *gs) {
+    char *file_name =
+        tinyfd_openFileDialog("Open the test suite", NULL, 0, NULL, NULL, 0);
+
+    if (!file_name) return;
+
+    u32 len;
+    char *text = load_text_file(file_name, &len);
+    if (!text) {
+        TraceLog(LOG_ERROR, "Failed to read %s", file_name);
+        return;
+    }
+
+    animation_load_tests(gs, text, len);
+}
+
+static void on_paste_tests_button_clicked(GlobalState *gs) {
+    const char *clipboard = GetClipboardText();
+    if (!clipboard) return;
+
+    u32 len = TextLength(clipboard);
+    char *text = (char *)memory_alloc(len + 1, MEMORY_TAG_STRINGS);
+    if (!text) return;
+    memcpy(text, clipboard, len + 1);
+
+    animation_load_tests(gs, text, len);
+}
+
 static void on_puase_button_clicked(GlobalState *gs) {
     if (paused) {
         button_set_text_and_font(&buttons[BUTTON_PAUSE], "Pause animation", 15,
@@ -390,40 +619,89 @@ static void on_puase_button_clicked(GlobalState *gs) {
     }
 }
 
+static void on_step_back_button_clicked(GlobalState *gs) {
+    UNUSED(gs);
+    // From the middle of a symbol go back to where it started
+    if (animation_is_settled() && trace_step > 0)
+        animation_seek(trace_step - 1);
+    else
+        animation_seek(trace_step);
+}
+
+static void on_step_forward_button_clicked(GlobalState *gs) {
+    if (anim_state == ANIMATING_STATE_DONE) return;
+
+    if (animation_is_settled() && trace_step == trace->len) {
+        anim_state = ANIMATING_STATE_RESULT;
+        animation_step(gs);
+        return;
+    }
+
+    animation_seek(trace_step + 1);
+}
+
+static void on_result_button_clicked(GlobalState *gs) {
+    animation_seek(trace->len);
+    anim_state = ANIMATING_STATE_RESULT;
+    animation_step(gs);
+}
+
+static void animation_reset(void) {
+    anim_state = anim_next_state = anim_prev_state = ANIMATING_STATE_NONE;
+    input_text_index = -1;
+    trace_step = 0;
+    result = RESULT_NONE;
+    step_timer = 0.0f;
+}
+
 static void animation_animate(GlobalState *gs) {
-    u64 current_states_length = darray_get_size(current_states);
-    u64 tlines_length = darray_get_size(gs->tlines);
+    float frame_time = CLAMP_MAX(GetFrameTime(), ANIMATION_MAX_FRAME_TIME);
+    step_timer += frame_time * speed;
+
+    // At high speeds several phases can elapse in a single frame
+    while (anim_state != ANIMATING_STATE_DONE) {
+        if (anim_state == ANIMATING_STATE_WATING) {
+            if (step_timer < ANIMATION_PHASE_DURATION) break;
+            step_timer -= ANIMATION_PHASE_DURATION;
+            anim_state = anim_next_state;
+        }
+        animation_step(gs);
+    }
+
+    if (anim_state == ANIMATING_STATE_DONE) step_timer = 0.0f;
+}
+
+// Jumps to the state after consuming step symbols, the trace replays at most
+// the steps since its last checkpoint
+static void animation_seek(u64 step) {
+    step = CLAMP_MAX(step, trace->len);
+    trace_step = step;
+    input_text_index = (i32)step - 1;
+    result = RESULT_NONE;
+    step_timer = 0.0f;
+    anim_prev_state = step ? ANIMATING_STATE_NODE : ANIMATING_STATE_NONE;
+    anim_state = ANIMATING_STATE_WATING;
+    anim_next_state = ANIMATING_STATE_INPUT;
+}
+
+// Whether the animation is between two symbols
+static bool animation_is_settled(void) {
+    return anim_state == ANIMATING_STATE_WATING
+        && (anim_prev_state == ANIMATING_STATE_NODE
+            || anim_prev_state == ANIMATING_STATE_NONE);
+}
 
+static void animation_step(GlobalState *gs) {
+    UNUSED(gs);
     switch (anim_state) {
         case ANIMATING_STATE_NONE:
-            darray_clear(current_states);
-            darray_push(&current_states, initial_state);
-            current_states_length = darray_get_size(current_states);
+            trace_step = 0;
             anim_prev_state = ANIMATING_STATE_NONE;
             anim_state = ANIMATING_STATE_WATING;
             anim_next_state = ANIMATING_STATE_INPUT;
             break;
         case ANIMATING_STATE_NODE:
-            if (gs->fsm_type == FSM_TYPE_DFA) {
-                Node *next_state =
-                    dfa_transition(current_states[0], gs->tlines, tlines_length,
-                                   input_text[input_text_index]);
-                darray_pop(&current_states, NULL);
-                darray_push(&current_states, next_state);
-                current_states_length = darray_get_size(current_states);
-            } else if (gs->fsm_type == FSM_TYPE_NFA) {
-                Node **next_states = darray_create(Node *);
-                for (u64 i = 0; i < current_states_length; ++i)
-                    next_states = nfa_transition(current_states[i], next_states,
-                                                 gs->tlines, tlines_length,
-                                                 input_text[input_text_index]);
-                darray_clear(current_states);
-                u64 length = darray_get_size(next_states);
-                for (u64 i = 0; i < length; ++i)
-                    darray_push(&current_states, next_states[i]);
-                current_states_length = darray_get_size(current_states);
-                darray_destroy(next_states);
-            }
+            trace_step = input_text_index + 1;
             anim_prev_state = ANIMATING_STATE_NODE;
             anim_state = ANIMATING_STATE_WATING;
             anim_next_state = ANIMATING_STATE_INPUT;
@@ -445,71 +723,305 @@ static void animation_animate(GlobalState *gs) {
             anim_next_state = ANIMATING_STATE_NODE;
             break;
         case ANIMATING_STATE_RESULT:
-            result = RESULT_REJECTED;
+            trace_step = trace->len;
+            result = trace->accepted ? RESULT_ACCEPTED : RESULT_REJECTED;
             anim_state = ANIMATING_STATE_DONE;
-            for (u64 i = 0; i < current_states_length; ++i) {
-                if (current_states[i]->accepting_state) {
-                    result = RESULT_ACCEPTED;
-                    anim_state = ANIMATING_STATE_DONE;
-                    break;
-                }
-            }
             break;
         case ANIMATING_STATE_WATING:
-            if (frame_count % (u64)(60 / speed) == 0)
-                anim_state = anim_next_state;
-            break;
         case ANIMATING_STATE_DONE:
         default:
             break;
     }
+}
 
-    for (u64 i = 0; i < current_states_length; ++i)
-        current_states[i]->state = NODE_STATE_HIGHLIGHTED;
-
-    if (anim_prev_state == ANIMATING_STATE_TLINE) {
-        for (u64 i = 0; i < tlines_length; ++i) {
-            for (u64 j = 0; j < current_states_length; ++j) {
-                if (gs->tlines[i].start == current_states[j]) {
-                    char input_str[] = {input_text[input_text_index], 0};
-                    if (all_chars_present(gs->tlines[i].inputs, input_str)) {
-                        gs->tlines[i].state = TLINE_STATE_HIGHLIGHTED;
-                        break;
-                    }
-                }
-            }
-        }
-    }
+static void animation_highlight(GlobalState *gs) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    for (u64 i = 0; i < nodes_length; ++i)
+        if (run_trace_is_active(trace, trace_step, i))
+            gs->nodes[i].state = NODE_STATE_HIGHLIGHTED;
+
+    if (anim_prev_state != ANIMATING_STATE_TLINE) return;
+
+    u64 tlines_length = darray_get_size(gs->tlines);
+    for (u64 i = 0; i < tlines_length; ++i)
+        if (run_trace_has_fired(trace, input_text_index, i))
+            gs->tlines[i].state = TLINE_STATE_HIGHLIGHTED;
+}
+
+static void animation_set_speed(GlobalState *gs, float value) {
+    slider_set_value(&speed_slider, value);
+    speed = exp2f(slider_get_value(&speed_slider));
+
+    const char *text = arena_format(&gs->frame, "%.2fx", speed);
+    text_box_set_text_and_font(&text_boxes[TEXT_BOX_SPEED], text,
+                               TextLength(text), gs->font);
+}
+
+static void animation_update_timeline(GlobalState *gs) {
+    if (timeline_step == trace_step) return;
+    timeline_step = trace_step;
+
+    slider_set_value(&timeline_slider, trace_step);
+
+    const char *text = arena_format(&gs->frame, "%llu/%llu",
+                                    (unsigned long long)trace_step,
+                                    (unsigned long long)trace->len);
+    text_box_set_text_and_font(&text_boxes[TEXT_BOX_POSITION], text,
+                               TextLength(text), gs->font);
+}
 
+static void animation_layout_input(void) {
     i32 width = GetScreenWidth();
     i32 height = GetScreenHeight();
 
-    if (input_text_index >= 0) {
-        Vector2 prev_size = MeasureTextEx(
-            gs->font, TextSubtext(input_text, 0, input_text_index), 48, 1.0f);
-        Vector2 cur_size = MeasureTextEx(
-            gs->font, TextSubtext(input_text, input_text_index, 1), 72, 1.0f);
-        Vector2 next_size = MeasureTextEx(
-            gs->font,
-            TextSubtext(input_text, input_text_index + 1,
-                        (input_text_length - input_text_index - 1)),
-            48, 1.0f);
+    if (input_text_index == layout_index && width == layout_width
+        && height == layout_height)
+        return;
+
+    layout_index = input_text_index;
+    layout_width = width;
+    layout_height = height;
 
+    // Only the current symbol is measured, the runs are drawn around it
+    if (input_text_index >= 0) {
+        float cur_width = 0.0f;
+        if (input_text_index < (i32)input_text_length)
+            cur_width = text_glyph_width(input_run.font,
+                                         ANIMATION_CURRENT_INPUT_FONT_SIZE,
+                                         input_text[input_text_index]);
+
+        current_input_vec =
+            (Vector2){.x = (width - cur_width) / 2.0f,
+                      .y = height - ANIMATION_CURRENT_INPUT_FONT_SIZE};
         previous_input_vec =
-            (Vector2){.x = (((width - cur_size.x) / 2.0f) - prev_size.x),
-                      .y = height - prev_size.y};
-        current_input_vec = (Vector2){.x = previous_input_vec.x + prev_size.x,
-                                      .y = height - cur_size.y};
-        next_input_vec = (Vector2){.x = current_input_vec.x + cur_size.x,
-                                   .y = height - next_size.y};
+            (Vector2){.x = current_input_vec.x + input_run.spacing,
+                      .y = height - input_run.font_size};
+        next_input_vec = (Vector2){.x = current_input_vec.x + cur_width,
+                                   .y = height - input_run.font_size};
+    } else {
+        // Inputs wider than the screen start at the left edge
+        float next_width = text_run_get_width(&input_run, 0, input_text_length);
+        next_input_vec = (Vector2){.x = CLAMP_MIN((width - next_width) / 2.0f,
+                                                  input_run.spacing),
+                                   .y = height - input_run.font_size};
+    }
+}
+
+static bool animation_is_active(GlobalState *gs) {
+    UNUSED(gs);
+    if (animating && !paused && anim_state != ANIMATING_STATE_DONE)
+        return true;
+
+    // The progress is shown while the trace is built in the background
+    if (pending_trace) return true;
+
+    // The counters change while the tests run in the background
+    if (tests && test_suite_is_running(tests)) return true;
+
+    // Keyboard panning moves the camera while keys are held down
+    u32 length = (sizeof(navigation_keys) / sizeof(navigation_keys[0]));
+    for (u32 i = 0; i < length; ++i)
+        for (u32 j = 0; j < 4; ++j)
+            if (IsKeyDown(navigation_keys[i][j])) return true;
+
+    return false;
+}
+
+// Takes ownership of the text, typing into the input box switches back to
+// the typed input
+static void animation_set_file_input(char *text, u32 len, const char *label) {
+    memory_free(file_input);
+    file_input = text;
+    file_input_length = len;
+
+    input_box_set_text(&input, label, TextLength(label));
+    file_input_generation = input.generation;
+}
+
+// Takes ownership of the text
+static void animation_load_tests(GlobalState *gs, char *text, u64 len) {
+    animation_drop_tests();
+    tests_scroll = 0;
+
+    TestSuite *ts =
+        (TestSuite *)memory_alloc(sizeof(TestSuite), MEMORY_TAG_ENGINE);
+    if (!ts) {
+        memory_free(text);
+        TraceLog(LOG_ERROR, "Failed to run the test suite");
+        return;
+    }
+
+    if (!test_suite_parse(ts, text, len)
+        || !test_suite_run(ts, &gs->workers, &completed_jobs, &gs->table)) {
+        TraceLog(LOG_ERROR, "Failed to run the test suite");
+        test_suite_destroy(ts);
+        memory_free(ts);
+        return;
+    }
+
+    tests = ts;
+    tests_returned = false;
+}
+
+// Suites that are still evaluated are freed once their job comes back
+static void animation_drop_tests(void) {
+    if (!tests) return;
+
+    if (tests_returned) {
+        test_suite_destroy(tests);
+        memory_free(tests);
     } else {
-        Vector2 next_size = MeasureTextEx(
-            gs->font,
-            TextSubtext(input_text, input_text_index + 1,
-                        (input_text_length - input_text_index - 1)),
-            48, 1.0f);
-        next_input_vec = (Vector2){.x = (width - next_size.x) / 2.0f,
-                                   .y = height - next_size.y};
+        job_cancel(&tests->job);
+    }
+    tests = NULL;
+}
+
+static void animation_poll_jobs(void) {
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        TestSuite *ts = (TestSuite *)job->data;
+        if (ts == tests) {
+            tests_returned = true;
+            continue;
+        }
+        test_suite_destroy(ts);
+        memory_free(ts);
+    }
+
+    while ((job = completion_queue_pop(&traced_jobs))) {
+        RunTrace *rt = (RunTrace *)job->data;
+        if (rt == pending_trace) {
+            pending_trace = NULL;
+            animation_start(rt);
+            continue;
+        }
+        run_trace_destroy(rt);
+        memory_free(rt);
+    }
+}
+
+// Unloading dropped the suite and the trace, so whatever comes back is freed
+static void animation_release_jobs(GlobalState *gs) {
+    UNUSED(gs);
+    animation_poll_jobs();
+}
+
+// Right side of the screen, between the toolbar and the input strip
+static Rectangle animation_get_tests_rect(void) {
+    float y = dest.height + 10;
+    float height = GetScreenHeight() - y - ANIMATION_CURRENT_INPUT_FONT_SIZE
+                 - ANIMATION_TESTS_ROW_HEIGHT;
+    height = CLAMP_MIN(height, (ANIMATION_TESTS_HEADER_ROWS + 1)
+                                   * ANIMATION_TESTS_ROW_HEIGHT);
+
+    return (Rectangle){.x = GetScreenWidth() - ANIMATION_TESTS_WIDTH - 10,
+                       .y = y,
+                       .width = ANIMATION_TESTS_WIDTH,
+                       .height = height};
+}
+
+// Number of failing strings that fit in the list
+static u32 animation_get_tests_rows(Rectangle rect) {
+    return (u32)(rect.height / ANIMATION_TESTS_ROW_HEIGHT)
+         - ANIMATION_TESTS_HEADER_ROWS;
+}
+
+static i32 animation_update_tests(GlobalState *gs, Vector2 mpos, i32 handled) {
+    if (!tests) return handled;
+
+    Rectangle rect = animation_get_tests_rect();
+    if (!CheckCollisionPointRec(mpos, rect)) return handled;
+
+    u64 failed = sync_load_u64(&tests->failed);
+    u32 rows = animation_get_tests_rows(rect);
+
+    if (!IS_INPUT_HANDLED(handled, INPUT_MOUSE_WHEEL)) {
+        i64 scroll = (i64)tests_scroll - (i64)(GetMouseWheelMove() * 3.0f);
+        i64 max_scroll = failed > rows ? (i64)(failed - rows) : 0;
+        tests_scroll = CLAMP(scroll, 0, max_scroll);
+        handled = MARK_INPUT_HANDLED(handled, INPUT_MOUSE_WHEEL);
+    }
+
+    if (IS_INPUT_HANDLED(handled, INPUT_LEFT_BUTTON)) return handled;
+    handled = MARK_INPUT_HANDLED(handled, INPUT_LEFT_BUTTON);
+
+    if (!IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) return handled;
+
+    i64 row = (i64)((mpos.y - rect.y) / ANIMATION_TESTS_ROW_HEIGHT)
+            - ANIMATION_TESTS_HEADER_ROWS;
+    if (row < 0 || tests_scroll + row >= failed) return handled;
+
+    // Animates a copy, the suite can be replaced while it runs
+    u64 index = tests->failures[tests_scroll + row];
+    u32 len;
+    const char *test = test_suite_get_case(tests, index, &len);
+    char *text = (char *)memory_alloc(len + 1, MEMORY_TAG_STRINGS);
+    if (!text) return handled;
+    memcpy(text, test, len);
+    text[len] = 0;
+
+    if (animating || pending_trace) on_toggle_animation_button_clicked(gs);
+    animation_set_file_input(text, len,
+                             arena_format(&gs->frame, "<test %llu>",
+                                          (unsigned long long)index + 1));
+    on_toggle_animation_button_clicked(gs);
+
+    return handled;
+}
+
+static void animation_draw_tests(GlobalState *gs) {
+    if (!tests) return;
+
+    Rectangle rect = animation_get_tests_rect();
+    DrawRectangleRec(rect, Fade(BLACK, 0.6f));
+
+    u64 done = test_suite_get_done(tests);
+    u64 failed = sync_load_u64(&tests->failed);
+    // Failures are published before the progress catches up with them
+    u64 passed = done > failed ? done - failed : 0;
+
+    Vector2 position = {rect.x + 8, rect.y + 2};
+    const char *text = arena_format(&gs->frame, "Passed %llu  Failed %llu",
+                                    (unsigned long long)passed,
+                                    (unsigned long long)failed);
+    DrawTextEx(gs->font, text, position, ANIMATION_TESTS_FONT_SIZE, 1.0f,
+               WHITE);
+
+    position.y += ANIMATION_TESTS_ROW_HEIGHT;
+    if (done < tests->count)
+        text = arena_format(&gs->frame, "Running %llu/%llu",
+                            (unsigned long long)done,
+                            (unsigned long long)tests->count);
+    else if (failed)
+        text = "Failing strings, click to animate:";
+    else
+        text = arena_format(&gs->frame, "All %llu passed",
+                            (unsigned long long)tests->count);
+    DrawTextEx(gs->font, text, position, ANIMATION_TESTS_FONT_SIZE, 1.0f,
+               LIGHTGRAY);
+
+    Vector2 mpos = GetMousePosition();
+    u32 rows = animation_get_tests_rows(rect);
+    for (u32 i = 0; i < rows && tests_scroll + i < failed; ++i) {
+        position.y += ANIMATION_TESTS_ROW_HEIGHT;
+        Rectangle row = {rect.x, position.y - 2, rect.width,
+                         ANIMATION_TESTS_ROW_HEIGHT};
+        if (CheckCollisionPointRec(mpos, row))
+            DrawRectangleRec(row, Fade(WHITE, 0.2f));
+
+        u64 index = tests->failures[tests_scroll + i];
+        u32 len;
+        const char *test = test_suite_get_case(tests, index, &len);
+
+        char sign = tests->cases[index].expected ? '+' : '-';
+        u32 label_length = MIN(len, ANIMATION_TESTS_MAX_CHARS);
+        if (len)
+            text = arena_format(&gs->frame, "%c %.*s%s", sign,
+                                (int)label_length, test,
+                                len > label_length ? "..." : "");
+        else text = arena_format(&gs->frame, "%c <empty>", sign);
+        DrawTextEx(gs->font, text, position, ANIMATION_TESTS_FONT_SIZE, 1.0f,
+                   RED);
     }
 }
 
@@ -517,4 +1029,6 @@ Screen animation = {.load = animation_load,
                     .unload = animation_unload,
                     .draw = animation_draw,
                     .before_draw = animation_before_draw,
+                    .is_active = animation_is_active,
+                    .release_jobs = animation_release_jobs,
                     .update = animation_update};
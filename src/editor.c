@@ -4,19 +4,56 @@
 #include <raylib.h>
 #include <raymath.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tinyfiledialogs.h>
 
 #include "utils/button.h"
 #include "utils/checkbox.h"
 #include "utils/darray.h"
 #include "utils/dfa.h"
+#include "utils/fsm_io.h"
 #include "utils/funcs.h"
+#include "utils/graph_renderer.h"
 #include "utils/input.h"
+#include "utils/journal.h"
+#include "utils/memory.h"
 #include "utils/nfa.h"
 #include "utils/node.h"
 #include "utils/node_selector.h"
+#include "utils/snapshot.h"
+#include "utils/table.h"
 #include "utils/text.h"
 #include "utils/tline.h"
+#include "utils/worker.h"
+
+// Validates a snapshot of the automaton on the worker pool
+typedef struct ValidationJob {
+        Job job;  // Its data is the validation job
+        ModelSnapshot *snapshot;
+        FSMType fsm_type;
+        DfaState dfa_state;
+        NfaState nfa_state;
+        bool done;  // The states hold the result
+} ValidationJob;
+
+// A node or tline of one version of the model. Both versions are sorted by
+// these keys to pair up the elements that stayed the same
+typedef struct ReloadEntry {
+        u32 start;  // Tlines only, node indices in the current model
+        u32 end;
+        const char *text;  // Name or inputs
+        u32 len;
+        u32 index;
+} ReloadEntry;
+
+// Taken from the frame arena before anything is changed, so a reload is
+// either applied as a whole or left for the next frame
+typedef struct ReloadScratch {
+        ReloadEntry *current;
+        ReloadEntry *entries;
+        u32 *current_match;  // Model index of every current element
+        u32 *model_match;  // Current index of every model element
+} ReloadScratch;
 
 typedef enum EditroState {
     EDITOR_STATE_NODE,
@@ -27,6 +64,7 @@ static Camera2D camera;
 static RenderTexture2D target;
 static float scale;
 static Rectangle source, dest;
+static GraphRenderer renderer;
 static Node *selected_node;
 static TLine *selected_tline;
 static EditorState editor_state;
@@ -34,6 +72,15 @@ static bool change_screen = false;
 static DfaState dfa_state;
 static NfaState nfa_state;
 static bool show_fsm_status = false;
+// Which widgets were visible when the toolbar was last rendered
+static i32 toolbar_layout;
+// Validation result is reused until the automaton changes
+static bool validated = false;
+static u64 validated_version;
+// Running validation of the current version, switches to the animation
+// screen when it succeeds. Cancelled jobs are freed once they come back
+static ValidationJob *validation = NULL;
+static CompletionQueue completed_jobs;
 
 enum { NODE_SELECTOR_FROM = 0, NODE_SELECTOR_TO, NODE_SELECTOR_MAX };
 
@@ -47,6 +94,11 @@ enum { CHECK_BOX_INITIAL_STATE = 0, CHECK_BOX_ACCEPTING_STATE, CHECK_BOX_MAX };
 
 static CheckBox check_boxes[CHECK_BOX_MAX];
 
+// Widget generations already applied to the model
+static u32 alphabet_generation;
+static u32 name_generation;
+static u32 check_box_generations[CHECK_BOX_MAX];
+
 enum {
     TEXT_BOX_ALPHABET = 0,
     TEXT_BOX_NAME,
@@ -94,6 +146,49 @@ static i32 editor_update_nodes_and_tlines(GlobalState *gs, Vector2 mpos,
 
 static void on_transition_add_button_clicked(GlobalState *gs);
 
+static void editor_track_node_widgets(void);
+
+static bool editor_apply_alphabet(GlobalState *gs);
+
+static bool editor_toolbar_dirty(bool node_menu, bool transition_menu);
+
+static bool editor_is_active(GlobalState *gs);
+
+static void editor_validate(Job *job);
+
+static void editor_start_validation(GlobalState *gs);
+
+static void editor_cancel_validation(GlobalState *gs);
+
+static void editor_poll_jobs(GlobalState *gs);
+
+static void editor_release_jobs(GlobalState *gs);
+
+static void editor_finish_simulate(GlobalState *gs);
+
+static void editor_add_node(GlobalState *gs, Vector2 position);
+
+static void editor_remove_node(GlobalState *gs, u64 index);
+
+static void editor_remove_tline(GlobalState *gs, u64 index);
+
+static void editor_patch_tline(GlobalState *gs, u64 index);
+static void editor_patch_state(GlobalState *gs, u64 index);
+
+static u8 editor_node_flags(Node *node);
+
+static HistoryNode editor_node_state(Node *node);
+
+static HistoryTLine editor_tline_state(GlobalState *gs, TLine *tl);
+
+static void editor_record_node(GlobalState *gs, u64 index);
+
+static void editor_record_tline(GlobalState *gs, u64 index);
+
+static void editor_replay_history(GlobalState *gs, bool redo);
+
+static bool editor_apply_reload(GlobalState *gs, GlobalState *model);
+
 void editor_load(GlobalState *gs) {
     bg = DARKGRAY;
     change_screen = false;
@@ -105,13 +200,20 @@ void editor_load(GlobalState *gs) {
     };
     selected_node = NULL;
     selected_tline = NULL;
+    validated = false;
+    toolbar_layout = -1;
 
     u64 length = darray_get_size(gs->nodes);
     for (u64 i = 0; i < length; ++i) gs->nodes[i].editing = true;
     length = darray_get_size(gs->tlines);
     for (u64 i = 0; i < length; ++i) gs->tlines[i].editing = true;
+    if (!fsm_table_sync(&gs->table, gs->nodes, gs->tlines, gs->version))
+        TraceLog(LOG_ERROR, "Failed to compile the automaton");
+    // Entering the editor snapshots the machine, the menu may have changed it
+    journal_start(gs);
 
     target = LoadRenderTexture(1600, 160);
+    graph_renderer_create(&renderer);
 
     editor_state = EDITOR_STATE_NODE;
 
@@ -151,6 +253,7 @@ void editor_load(GlobalState *gs) {
 
     input_box_set_text(&input_boxes[INPUT_BOX_ALPHABET], gs->alphabet,
                        gs->alphabet_len);
+    alphabet_generation = input_boxes[INPUT_BOX_ALPHABET].generation;
 
     Rectangle check_box_rects[CHECK_BOX_MAX] = {
         { 870, 90, 50, 48},
@@ -223,7 +326,7 @@ void editor_load(GlobalState *gs) {
 }
 
 void editor_unload(GlobalState *gs) {
-    UNUSED(gs);
+    editor_cancel_validation(gs);
     for (i32 i = 0; i < TEXT_BOX_MAX; ++i) text_box_destroy(&text_boxes[i]);
     for (i32 i = 0; i < INPUT_BOX_MAX; ++i) input_box_destroy(&input_boxes[i]);
     for (i32 i = 0; i < CHECK_BOX_MAX; ++i) check_box_destroy(&check_boxes[i]);
@@ -235,10 +338,20 @@ void editor_unload(GlobalState *gs) {
 
     button_destroy(&tr_button);
 
+    graph_renderer_destroy(&renderer);
     UnloadRenderTexture(target);
 }
 
 ScreenChangeType editor_update(GlobalState *gs) {
+    // Edits patch the compiled table instead of invalidating it
+    bool table_synced = gs->table.built && gs->table.version == gs->version;
+    editor_poll_jobs(gs);
+
+    fsm_io_poll_watch(gs);
+    GlobalState *reload = fsm_io_get_reload();
+    if (reload) {
+        if (editor_apply_reload(gs, reload)) fsm_io_finish_reload();
+    }
     editor_update_transforms();
 
     // NOTE: Screen coordinates
@@ -281,18 +394,38 @@ ScreenChangeType editor_update(GlobalState *gs) {
     }
 
     if (selected_node && editor_state == EDITOR_STATE_NODE) {
-        u32 len;
-        const char *name =
-            input_box_get_text(&input_boxes[INPUT_BOX_NAME], &len);
-        node_set_name(selected_node, name, len);
+        InputBox *name_box = &input_boxes[INPUT_BOX_NAME];
+        if (name_box->generation != name_generation) {
+            u32 len;
+            const char *name = input_box_get_text(name_box, &len);
+            editor_record_node(gs, selected_node - gs->nodes);
+            node_set_name(selected_node, &gs->strings, name, len);
+            journal_node(gs, selected_node - gs->nodes);
+            name_generation = name_box->generation;
+            gs->version++;
+        }
 
-        for (i32 i = 0; i < CHECK_BOX_MAX; ++i)
+        bool flags_changed = false;
+        for (i32 i = 0; i < CHECK_BOX_MAX; ++i) {
             handled = check_box_update(&check_boxes[i], mpos, handled);
+            if (check_boxes[i].generation != check_box_generations[i]) {
+                check_box_generations[i] = check_boxes[i].generation;
+                flags_changed = true;
+            }
+        }
 
-        selected_node->initial_state =
-            check_boxes[CHECK_BOX_INITIAL_STATE].checked;
-        selected_node->accepting_state =
-            check_boxes[CHECK_BOX_ACCEPTING_STATE].checked;
+        if (flags_changed) {
+            editor_record_node(gs, selected_node - gs->nodes);
+            selected_node->initial_state =
+                check_boxes[CHECK_BOX_INITIAL_STATE].checked;
+            selected_node->accepting_state =
+                check_boxes[CHECK_BOX_ACCEPTING_STATE].checked;
+            u64 index = selected_node - gs->nodes;
+            editor_patch_state(gs, index);
+            snapshot_store_mark_node(&gs->snapshots, index);
+            journal_node(gs, index);
+            gs->version++;
+        }
     }
 
     // Works, but feel wierd
@@ -321,6 +454,19 @@ ScreenChangeType editor_update(GlobalState *gs) {
     handled = editor_update_world(mpos, gs, handled);
     // TraceLog(LOG_INFO, "world = %d", handled);
 
+    // The result would be for an outdated automaton
+    if (validation && validation->snapshot->version != gs->version)
+        editor_cancel_validation(gs);
+
+    if (table_synced && gs->table.built) gs->table.version = gs->version;
+    // A failed patch is caught up with a full rebuild
+    if (!gs->table.built
+        && !fsm_table_sync(&gs->table, gs->nodes, gs->tlines, gs->version))
+        TraceLog(LOG_ERROR, "Failed to compile the automaton");
+
+    // A drag keeps adding its moves to one entry until the button is up
+    if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT)) history_seal(&gs->history);
+
     if (change_screen) return SCREEN_CHANGE;
     return SCREEN_SAME;
 }
@@ -335,14 +481,11 @@ void editor_draw(GlobalState *gs) {
     // 5000,
     //          200, 32, WHITE);
 
-    u64 length = darray_get_size(gs->tlines);
-    for (u32 i = 0; i < length; ++i) tline_draw(&gs->tlines[i]);
-    length = darray_get_size(gs->nodes);
-    for (u32 i = 0; i < length; ++i) node_draw(&gs->nodes[i]);
+    graph_renderer_draw(&renderer, gs->nodes, gs->tlines, camera.zoom);
     if (selected_tline && editor_state == EDITOR_STATE_TRANSITION)
-        tline_draw(selected_tline);
+        tline_draw(selected_tline, camera.zoom);
     if (selected_node && editor_state == EDITOR_STATE_NODE)
-        node_draw(selected_node);
+        node_draw(selected_node, camera.zoom);
 
     EndMode2D();
 
@@ -427,16 +570,18 @@ void editor_draw(GlobalState *gs) {
 
 void editor_before_draw(GlobalState *gs) {
     UNUSED(gs);
+    bool node_menu = selected_node && editor_state == EDITOR_STATE_NODE;
+    bool transition_menu = editor_state == EDITOR_STATE_TRANSITION;
+    if (!editor_toolbar_dirty(node_menu, transition_menu)) return;
+
     BeginTextureMode(target);
 
     ClearBackground(GRAY);
 
     for (i32 i = 0; i < BUTTON_MAX; ++i) button_draw(&buttons[i]);
-    i32 text_box_max = selected_node && editor_state == EDITOR_STATE_NODE
-                         ? TEXT_BOX_MAX
-                         : TEXT_BOX_NAME;
+    i32 text_box_max = node_menu ? TEXT_BOX_MAX : TEXT_BOX_NAME;
 
-    if (editor_state == EDITOR_STATE_TRANSITION) {
+    if (transition_menu) {
         for (u32 i = 0; i < TRT_MAX; ++i) text_box_draw(&tr_texts[i]);
         input_box_draw(&tr_input);
         for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
@@ -445,12 +590,10 @@ void editor_before_draw(GlobalState *gs) {
     }
 
     for (i32 i = 0; i < text_box_max; ++i) text_box_draw(&text_boxes[i]);
-    i32 input_box_max = selected_node && editor_state == EDITOR_STATE_NODE
-                          ? INPUT_BOX_MAX
-                          : INPUT_BOX_NAME;
+    i32 input_box_max = node_menu ? INPUT_BOX_MAX : INPUT_BOX_NAME;
     for (i32 i = 0; i < input_box_max; ++i) input_box_draw(&input_boxes[i]);
 
-    if (selected_node && editor_state == EDITOR_STATE_NODE)
+    if (node_menu)
         for (i32 i = 0; i < CHECK_BOX_MAX; ++i) check_box_draw(&check_boxes[i]);
 
     EndTextureMode();
@@ -478,11 +621,8 @@ static i32 editor_update_world(Vector2 mpos, GlobalState *gs, i32 handled) {
         && !IS_INPUT_HANDLED(handled, INPUT_RIGHT_BUTTON)
         && editor_state == EDITOR_STATE_NODE) {
         handled = MARK_INPUT_HANDLED(handled, MOUSE_BUTTON_RIGHT);
-        Node node;
-        node_create(&node, mpos);
-        node_set_font(&node, gs->font, 32);
-        node.editing = true;
-        darray_push(&gs->nodes, node);
+        editor_add_node(gs, mpos);
+        history_add_node(&gs->history, darray_get_size(gs->nodes) - 1);
     }
 
     if (!IS_INPUT_HANDLED(handled, INPUT_KEYSTROKES)) {
@@ -500,33 +640,30 @@ static i32 editor_update_world(Vector2 mpos, GlobalState *gs, i32 handled) {
             return handled;
         }
 
+        bool control = IsKeyDown(KEY_LEFT_CONTROL)
+                    || IsKeyDown(KEY_RIGHT_CONTROL);
+        bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+        if (control && IsKeyPressed(KEY_Z))
+            editor_replay_history(gs, shift);
+        else if (control && IsKeyPressed(KEY_Y))
+            editor_replay_history(gs, true);
+
         if (IsKeyPressed(KEY_DELETE)) {
             if (selected_node && editor_state == EDITOR_STATE_NODE) {
-                u64 len = darray_get_size(gs->nodes);
-                for (u32 i = 0; i < len; ++i) {
-                    if (&gs->nodes[i] == selected_node) {
-                        node_destroy(selected_node);
-                        selected_node = NULL;
-                        darray_pop_at(&gs->nodes, i, NULL);
-                        break;
-                    }
-                }
+                u64 index = selected_node - gs->nodes;
+                selected_node = NULL;
+                editor_remove_node(gs, index);
+                gs->version++;
             } else if (selected_tline
                        && editor_state == EDITOR_STATE_TRANSITION) {
-                u64 len = darray_get_size(gs->tlines);
-                for (u32 i = 0; i < len; ++i) {
-                    if (&gs->tlines[i] == selected_tline) {
-                        tline_destroy(selected_tline);
-                        selected_tline = NULL;
-
-                        for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
-                            node_selectors[i].node = NULL;
-                        input_box_set_text(&tr_input, NULL, 0);
-
-                        darray_pop_at(&gs->tlines, i, NULL);
-                        break;
-                    }
-                }
+                u64 index = selected_tline - gs->tlines;
+                selected_tline = NULL;
+                for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
+                    node_selector_set_node(&node_selectors[i], NULL);
+                input_box_set_text(&tr_input, NULL, 0);
+
+                editor_remove_tline(gs, index);
+                gs->version++;
             }
         }
 
@@ -572,7 +709,14 @@ static i32 editor_update_nodes_and_tlines(GlobalState *gs, Vector2 mpos,
     if (update_nodes) {
         Node *prev_selected = selected_node;
         if (selected_node) {
+            Vector2 center = selected_node->center;
             handled = node_update(selected_node, mpos, delta, handled);
+            if (!Vector2Equals(center, selected_node->center)) {
+                history_move_node(&gs->history, selected_node - gs->nodes,
+                                  center);
+                journal_node(gs, selected_node - gs->nodes);
+                gs->version++;
+            }
             if (!selected_node->selected) {
                 selected_node = NULL;
                 input_box_set_text(&input_boxes[INPUT_BOX_NAME], NULL, 0);
@@ -581,20 +725,33 @@ static i32 editor_update_nodes_and_tlines(GlobalState *gs, Vector2 mpos,
         u64 length = darray_get_size(gs->nodes);
         for (i32 i = length - 1; i > -1; --i) {
             if (&gs->nodes[i] == prev_selected) continue;
+            Vector2 center = gs->nodes[i].center;
             handled = node_update(&gs->nodes[i], mpos, delta, handled);
+            if (!Vector2Equals(center, gs->nodes[i].center)) {
+                history_move_node(&gs->history, i, center);
+                journal_node(gs, i);
+                gs->version++;
+            }
             // Make sure only one state is initial state
-            if (prev_selected && prev_selected->initial_state)
+            if (prev_selected && prev_selected->initial_state
+                && gs->nodes[i].initial_state) {
+                editor_record_node(gs, i);
                 gs->nodes[i].initial_state = false;
+                editor_patch_state(gs, i);
+                snapshot_store_mark_node(&gs->snapshots, i);
+                journal_node(gs, i);
+            }
 
             if (gs->nodes[i].selected) {
                 selected_node = &gs->nodes[i];
                 input_box_set_text(&input_boxes[INPUT_BOX_NAME],
-                                   selected_node->name,
-                                   selected_node->name_length);
+                                   small_string_get(&selected_node->name),
+                                   selected_node->name.len);
                 check_box_set_checked(&check_boxes[CHECK_BOX_INITIAL_STATE],
                                       selected_node->initial_state);
                 check_box_set_checked(&check_boxes[CHECK_BOX_ACCEPTING_STATE],
                                       selected_node->accepting_state);
+                editor_track_node_widgets();
             }
         }
     }
@@ -605,7 +762,7 @@ static i32 editor_update_nodes_and_tlines(GlobalState *gs, Vector2 mpos,
         if (!selected_tline->selected) {
             selected_tline = NULL;
             for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
-                node_selectors[i].node = NULL;
+                node_selector_set_node(&node_selectors[i], NULL);
             input_box_set_text(&tr_input, NULL, 0);
         }
     }
@@ -619,8 +776,10 @@ static i32 editor_update_nodes_and_tlines(GlobalState *gs, Vector2 mpos,
             u32 len;
             const char *inputs = tline_get_inputs(selected_tline, &len);
             input_box_set_text(&tr_input, inputs, len);
-            node_selectors[NODE_SELECTOR_FROM].node = selected_tline->start;
-            node_selectors[NODE_SELECTOR_TO].node = selected_tline->end;
+            node_selector_set_node(&node_selectors[NODE_SELECTOR_FROM],
+                                   selected_tline->start);
+            node_selector_set_node(&node_selectors[NODE_SELECTOR_TO],
+                                   selected_tline->end);
         }
     }
 
@@ -650,33 +809,27 @@ static void on_change_mode_button_clicked(GlobalState *gs) {
 }
 
 static void on_simulate_button_clicked(GlobalState *gs) {
-    u32 len;
-    const char *alphabet =
-        input_box_get_text(&input_boxes[INPUT_BOX_ALPHABET], &len);
-    if (!len) alphabet = NULL;
+    // Clicking again while validating cancels it
+    if (validation) {
+        editor_cancel_validation(gs);
+        return;
+    }
 
-    if (alphabet) {
-        char *new_alphabet = realloc(gs->alphabet, (len + 1) * sizeof(char));
-        if (!new_alphabet) return;
-        gs->alphabet = new_alphabet;
-        for (u64 i = 0; i < len; ++i) gs->alphabet[i] = alphabet[i];
-        gs->alphabet[len] = 0;
-        gs->alphabet_len = len;
+    if (!editor_apply_alphabet(gs)) return;
+
+    if (!validated || validated_version != gs->version) {
+        editor_start_validation(gs);
+        return;
     }
 
-    if (gs->fsm_type == FSM_TYPE_DFA) {
-        dfa_state = is_dfa_valid(gs->nodes, gs->tlines, gs->alphabet);
-        if (dfa_state != DFA_STATE_OK) {
-            show_fsm_status = true;
-            return;
-        }
+    editor_finish_simulate(gs);
+}
 
-    } else if (gs->fsm_type == FSM_TYPE_NFA) {
-        nfa_state = is_nfa_valid(gs->nodes, gs->tlines, gs->alphabet);
-        if (nfa_state != NFA_STATE_OK) {
-            show_fsm_status = true;
-            return;
-        }
+static void editor_finish_simulate(GlobalState *gs) {
+    if ((gs->fsm_type == FSM_TYPE_DFA && dfa_state != DFA_STATE_OK)
+        || (gs->fsm_type == FSM_TYPE_NFA && nfa_state != NFA_STATE_OK)) {
+        show_fsm_status = true;
+        return;
     }
 
     change_screen = true;
@@ -684,28 +837,16 @@ static void on_simulate_button_clicked(GlobalState *gs) {
 }
 
 static void on_save_button_clicked(GlobalState *gs) {
-    u32 len;
-    const char *alphabet =
-        input_box_get_text(&input_boxes[INPUT_BOX_ALPHABET], &len);
-    if (!len) alphabet = NULL;
-
-    if (alphabet) {
-        char *new_alphabet = realloc(gs->alphabet, (len + 1) * sizeof(char));
-        if (!new_alphabet) return;
-        gs->alphabet = new_alphabet;
-        for (u64 i = 0; i < len; ++i) gs->alphabet[i] = alphabet[i];
-        gs->alphabet[len] = 0;
-        gs->alphabet_len = len;
-    }
+    if (!editor_apply_alphabet(gs)) return;
 
-    const char *filters[] = {"*.fsm"};
+    const char *filters[] = {"*.fsm", "*" FSM_TEXT_FILE_EXTENSION};
     char *file_name =
-        tinyfd_saveFileDialog("Save FSM file", NULL, 1, filters, "FSM file");
+        tinyfd_saveFileDialog("Save FSM file", NULL, 2, filters, "FSM file");
 
     if (!file_name) return;
 
-    if (!store_fsm_to_file(gs, file_name))
-        TraceLog(LOG_ERROR, "Failed to save!");
+    // Failures of the write itself are logged when the job comes back
+    if (!fsm_io_save(gs, file_name)) TraceLog(LOG_ERROR, "Failed to save!");
 }
 
 static void on_transition_add_button_clicked(GlobalState *gs) {
@@ -717,9 +858,13 @@ static void on_transition_add_button_clicked(GlobalState *gs) {
             if ((gs->tlines[i].start == node_selectors[NODE_SELECTOR_FROM].node)
                 && (gs->tlines[i].end
                     == node_selectors[NODE_SELECTOR_TO].node)) {
-                tline_append_inputs(&gs->tlines[i], inputs, len);
+                editor_record_tline(gs, i);
+                tline_append_inputs(&gs->tlines[i], &gs->strings, inputs,
+                                    len);
+                editor_patch_tline(gs, i);
+                gs->version++;
                 for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
-                    node_selectors[i].node = NULL;
+                    node_selector_set_node(&node_selectors[i], NULL);
                 input_box_set_text(&tr_input, NULL, 0);
                 return;
             }
@@ -729,25 +874,846 @@ static void on_transition_add_button_clicked(GlobalState *gs) {
         tline_create(&tline);
         tline_set_start_node(&tline, node_selectors[NODE_SELECTOR_FROM].node);
         tline_set_end_node(&tline, node_selectors[NODE_SELECTOR_TO].node);
-        tline_set_inputs(&tline, inputs, len);
+        tline_set_inputs(&tline, &gs->strings, inputs, len);
         tline_set_font(&tline, gs->font);
         tline.editing = true;
 
         darray_push(&gs->tlines, tline);
+        editor_patch_tline(gs, darray_get_size(gs->tlines) - 1);
+        history_add_tline(&gs->history, darray_get_size(gs->tlines) - 1);
     } else {
+        editor_record_tline(gs, selected_tline - gs->tlines);
         tline_set_start_node(selected_tline,
                              node_selectors[NODE_SELECTOR_FROM].node);
         tline_set_end_node(selected_tline,
                            node_selectors[NODE_SELECTOR_TO].node);
-        tline_set_inputs(selected_tline, inputs, len);
+        tline_set_inputs(selected_tline, &gs->strings, inputs, len);
+        editor_patch_tline(gs, selected_tline - gs->tlines);
         selected_tline = NULL;
     }
-    for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i) node_selectors[i].node = NULL;
+    gs->version++;
+    for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
+        node_selector_set_node(&node_selectors[i], NULL);
     input_box_set_text(&tr_input, NULL, 0);
 }
 
+static void editor_track_node_widgets(void) {
+    name_generation = input_boxes[INPUT_BOX_NAME].generation;
+    for (i32 i = 0; i < CHECK_BOX_MAX; ++i)
+        check_box_generations[i] = check_boxes[i].generation;
+}
+
+static bool editor_apply_alphabet(GlobalState *gs) {
+    InputBox *alphabet_box = &input_boxes[INPUT_BOX_ALPHABET];
+    if (alphabet_box->generation == alphabet_generation) return true;
+
+    u32 len;
+    const char *alphabet = input_box_get_text(alphabet_box, &len);
+    if (!len) alphabet = NULL;
+
+    if (alphabet) {
+        // A shorter alphabet would not leave the old one in the new buffer
+        char *new_alphabet = (char *)memory_alloc((len + 1) * sizeof(char),
+                                                  MEMORY_TAG_STRINGS);
+        if (!new_alphabet) return false;
+        history_alphabet(&gs->history, gs->fsm_type, gs->alphabet,
+                         gs->alphabet_len);
+        memory_free(gs->alphabet);
+        gs->alphabet = new_alphabet;
+        for (u64 i = 0; i < len; ++i) gs->alphabet[i] = alphabet[i];
+        gs->alphabet[len] = 0;
+        gs->alphabet_len = len;
+        journal_alphabet(gs);
+    }
+
+    alphabet_generation = alphabet_box->generation;
+    gs->version++;
+    return true;
+}
+
+static bool editor_toolbar_dirty(bool node_menu, bool transition_menu) {
+    i32 layout = (node_menu ? 1 : 0) | (transition_menu ? 2 : 0);
+    bool dirty = layout != toolbar_layout;
+    toolbar_layout = layout;
+
+    for (i32 i = 0; i < BUTTON_MAX; ++i) dirty |= button_is_dirty(&buttons[i]);
+    dirty |= text_boxes[TEXT_BOX_ALPHABET].dirty;
+    dirty |= input_boxes[INPUT_BOX_ALPHABET].dirty;
+
+    if (transition_menu) {
+        for (u32 i = 0; i < TRT_MAX; ++i) dirty |= tr_texts[i].dirty;
+        for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
+            dirty |= node_selectors[i].dirty;
+        dirty |= tr_input.dirty;
+        dirty |= button_is_dirty(&tr_button);
+    }
+
+    if (node_menu) {
+        for (i32 i = 0; i < TEXT_BOX_MAX; ++i) dirty |= text_boxes[i].dirty;
+        for (i32 i = 0; i < CHECK_BOX_MAX; ++i) dirty |= check_boxes[i].dirty;
+        dirty |= input_boxes[INPUT_BOX_NAME].dirty;
+    }
+
+    return dirty;
+}
+
+static bool editor_is_active(GlobalState *gs) {
+    UNUSED(gs);
+    // Completed jobs are only noticed in update
+    if (validation) return true;
+
+    // Without a watch thread waking the loop, waiting for input would leave a
+    // change on disk unread while the window sits in the background
+    if (fsm_io_needs_polling()) return true;
+
+    // Keyboard panning moves the camera while keys are held down
+    u32 length = (sizeof(navigation_keys) / sizeof(navigation_keys[0]));
+    for (u32 i = 0; i < length; ++i)
+        for (u32 j = 0; j < 4; ++j)
+            if (IsKeyDown(navigation_keys[i][j])) return true;
+
+    return false;
+}
+
+// Runs on a worker thread, only reads the snapshot
+static void editor_validate(Job *job) {
+    ValidationJob *vj = (ValidationJob *)job->data;
+    ModelSnapshot *ms = vj->snapshot;
+
+    Node *nodes;
+    TLine *tlines;
+    if (!model_snapshot_expand(ms, &nodes, &tlines)) return;
+
+    if (vj->fsm_type == FSM_TYPE_DFA)
+        vj->dfa_state = is_dfa_valid(nodes, tlines, ms->alphabet);
+    else if (vj->fsm_type == FSM_TYPE_NFA)
+        vj->nfa_state = is_nfa_valid(nodes, tlines, ms->alphabet);
+
+    darray_destroy(nodes);
+    darray_destroy(tlines);
+    vj->done = true;
+    job_set_progress(job, 1);
+}
+
+static void editor_start_validation(GlobalState *gs) {
+    ValidationJob *vj = (ValidationJob *)memory_alloc(sizeof(ValidationJob),
+                                                      MEMORY_TAG_ENGINE);
+    if (!vj) return;
+
+    vj->snapshot = snapshot_store_acquire(&gs->snapshots, gs->nodes,
+                                          gs->tlines, gs->alphabet,
+                                          gs->version);
+    if (!vj->snapshot) {
+        TraceLog(LOG_ERROR, "Failed to copy the automaton for validation");
+        memory_free(vj);
+        return;
+    }
+
+    vj->fsm_type = gs->fsm_type;
+    vj->dfa_state = DFA_STATE_OK;
+    vj->nfa_state = NFA_STATE_OK;
+    vj->done = false;
+    job_init(&vj->job, editor_validate, vj, &completed_jobs);
+    worker_pool_submit(&gs->workers, &vj->job);
+
+    validation = vj;
+    button_set_text_and_font(&buttons[BUTTON_SIMULATE], "Validating", 10,
+                             gs->font);
+}
+
+static void editor_cancel_validation(GlobalState *gs) {
+    if (!validation) return;
+
+    job_cancel(&validation->job);
+    validation = NULL;
+    button_set_text_and_font(&buttons[BUTTON_SIMULATE], "Simulate", 8,
+                             gs->font);
+}
+
+static void editor_poll_jobs(GlobalState *gs) {
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        ValidationJob *vj = (ValidationJob *)job->data;
+
+        if (vj == validation) {
+            validation = NULL;
+            button_set_text_and_font(&buttons[BUTTON_SIMULATE], "Simulate", 8,
+                                     gs->font);
+        }
+
+        if (vj->done && !job_is_cancelled(job)) {
+            dfa_state = vj->dfa_state;
+            nfa_state = vj->nfa_state;
+            validated = true;
+            validated_version = vj->snapshot->version;
+            editor_finish_simulate(gs);
+        }
+
+        model_snapshot_release(vj->snapshot);
+        memory_free(vj);
+    }
+}
+
+// Unloading cancelled the validation, so nothing that comes back is used
+static void editor_release_jobs(GlobalState *gs) {
+    UNUSED(gs);
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        ValidationJob *vj = (ValidationJob *)job->data;
+        model_snapshot_release(vj->snapshot);
+        memory_free(vj);
+    }
+}
+
+static void editor_add_node(GlobalState *gs, Vector2 position) {
+    Node node;
+    node_create(&node, position);
+    node_set_font(&node, gs->font, 32);
+    node.editing = true;
+
+    uintptr_t old_nodes = (uintptr_t)gs->nodes;
+    darray_push(&gs->nodes, node);
+    // The darray moved, everything pointing into it has to follow
+    if ((uintptr_t)gs->nodes != old_nodes) {
+        uintptr_t new_nodes = (uintptr_t)gs->nodes;
+        u64 length = darray_get_size(gs->tlines);
+        for (u64 i = 0; i < length; ++i) {
+            TLine *tl = &gs->tlines[i];
+            if (tl->start)
+                tl->start = (Node *)((uintptr_t)tl->start - old_nodes
+                                     + new_nodes);
+            if (tl->end)
+                tl->end = (Node *)((uintptr_t)tl->end - old_nodes + new_nodes);
+        }
+        if (selected_node)
+            selected_node = (Node *)((uintptr_t)selected_node - old_nodes
+                                     + new_nodes);
+        for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i) {
+            uintptr_t selected = (uintptr_t)node_selectors[i].node;
+            if (selected)
+                node_selector_set_node(
+                    &node_selectors[i],
+                    (Node *)(selected - old_nodes + new_nodes));
+        }
+    }
+
+    if (gs->table.built && !fsm_table_add_state(&gs->table, 0))
+        gs->table.built = false;
+    journal_node(gs, darray_get_size(gs->nodes) - 1);
+    gs->version++;
+}
+
+// Swaps the last node into the index, its tlines are removed with it
+static void editor_remove_node(GlobalState *gs, u64 index) {
+    Node *node = &gs->nodes[index];
+    // Backwards, so the tline swapped into a removed one was already visited
+    for (u64 i = darray_get_size(gs->tlines); i > 0; --i) {
+        if (gs->tlines[i - 1].start == node || gs->tlines[i - 1].end == node)
+            editor_remove_tline(gs, i - 1);
+    }
+
+    u64 last = darray_get_size(gs->nodes) - 1;
+    Node *moved = &gs->nodes[last];
+    for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i) {
+        if (node_selectors[i].node == node)
+            node_selector_set_node(&node_selectors[i], NULL);
+        else if (node_selectors[i].node == moved && index != last)
+            node_selector_set_node(&node_selectors[i], node);
+    }
+
+    HistoryNode hn = editor_node_state(node);
+    history_remove_node(&gs->history, index, &hn,
+                        small_string_get(&node->name));
+
+    node_destroy(node);
+    if (index != last) {
+        u64 length = darray_get_size(gs->tlines);
+        for (u64 i = 0; i < length; ++i) {
+            TLine *tl = &gs->tlines[i];
+            if (tl->start != moved && tl->end != moved) continue;
+            if (tl->start == moved) tl->start = node;
+            if (tl->end == moved) tl->end = node;
+            snapshot_store_mark_tline(&gs->snapshots, i);
+        }
+        if (selected_node == moved) selected_node = node;
+    }
+    darray_swap_remove(&gs->nodes, index, NULL);
+
+    if (gs->table.built) fsm_table_remove_state(&gs->table, index);
+    snapshot_store_mark_node(&gs->snapshots, index);
+    journal_remove_node(index);
+}
+
+// Swaps the last tline into the index
+static void editor_remove_tline(GlobalState *gs, u64 index) {
+    u64 last = darray_get_size(gs->tlines) - 1;
+    if (selected_tline == &gs->tlines[index]) selected_tline = NULL;
+    else if (selected_tline == &gs->tlines[last])
+        selected_tline = &gs->tlines[index];
+
+    TLine *tl = &gs->tlines[index];
+    HistoryTLine ht = editor_tline_state(gs, tl);
+    history_remove_tline(&gs->history, index, &ht,
+                         small_string_get(&tl->inputs));
+
+    tline_destroy(tl);
+    darray_swap_remove(&gs->tlines, index, NULL);
+
+    if (gs->table.built) fsm_table_remove_tline(&gs->table, index);
+    snapshot_store_mark_tline(&gs->snapshots, index);
+    journal_remove_tline(index);
+}
+
+// A failed patch leaves the table to be rebuilt at the end of the frame.
+// Until then the table no longer matches the indices, so every patch of it
+// is skipped
+static void editor_patch_tline(GlobalState *gs, u64 index) {
+    TLine *tl = &gs->tlines[index];
+    u32 start = tl->start ? tl->start - gs->nodes : FSM_TABLE_NONE;
+    u32 end = tl->end ? tl->end - gs->nodes : FSM_TABLE_NONE;
+    if (gs->table.built
+        && !fsm_table_set_tline(&gs->table, index, start, end,
+                                small_string_get(&tl->inputs), tl->inputs.len))
+        gs->table.built = false;
+    snapshot_store_mark_tline(&gs->snapshots, index);
+    journal_tline(gs, index);
+}
+
+static void editor_patch_state(GlobalState *gs, u64 index) {
+    if (gs->table.built)
+        fsm_table_set_state(&gs->table, index,
+                            editor_node_flags(&gs->nodes[index]));
+}
+
+static u8 editor_node_flags(Node *node) {
+    return (node->initial_state ? FSM_STATE_INITIAL : 0)
+         | (node->accepting_state ? FSM_STATE_ACCEPTING : 0);
+}
+
+static HistoryNode editor_node_state(Node *node) {
+    return (HistoryNode){.center = node->center,
+                         .flags = editor_node_flags(node),
+                         .name_len = node->name.len};
+}
+
+static HistoryTLine editor_tline_state(GlobalState *gs, TLine *tl) {
+    return (HistoryTLine){
+        .start = tl->start ? tl->start - gs->nodes : FSM_TABLE_NONE,
+        .end = tl->end ? tl->end - gs->nodes : FSM_TABLE_NONE,
+        .inputs_len = tl->inputs.len,
+    };
+}
+
+// Records how to undo the change that is about to be made
+static void editor_record_node(GlobalState *gs, u64 index) {
+    Node *node = &gs->nodes[index];
+    HistoryNode hn = editor_node_state(node);
+    history_change_node(&gs->history, index, &hn,
+                        small_string_get(&node->name));
+}
+
+static void editor_record_tline(GlobalState *gs, u64 index) {
+    TLine *tl = &gs->tlines[index];
+    HistoryTLine ht = editor_tline_state(gs, tl);
+    history_change_tline(&gs->history, index, &ht,
+                         small_string_get(&tl->inputs));
+}
+
+// Exchanges two nodes, so a node put back by an undo takes its old index
+static void editor_swap_nodes(GlobalState *gs, u64 a, u64 b) {
+    Node *na = &gs->nodes[a];
+    Node *nb = &gs->nodes[b];
+    Node node = *na;
+    *na = *nb;
+    *nb = node;
+
+    u64 length = darray_get_size(gs->tlines);
+    for (u64 i = 0; i < length; ++i) {
+        TLine *tl = &gs->tlines[i];
+        if (tl->start != na && tl->start != nb && tl->end != na
+            && tl->end != nb)
+            continue;
+        if (tl->start == na) tl->start = nb;
+        else if (tl->start == nb) tl->start = na;
+        if (tl->end == na) tl->end = nb;
+        else if (tl->end == nb) tl->end = na;
+        editor_patch_tline(gs, i);
+    }
+
+    for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i) {
+        if (node_selectors[i].node == na)
+            node_selector_set_node(&node_selectors[i], nb);
+        else if (node_selectors[i].node == nb)
+            node_selector_set_node(&node_selectors[i], na);
+    }
+
+    u64 indices[2] = {a, b};
+    for (u32 i = 0; i < 2; ++i) {
+        editor_patch_state(gs, indices[i]);
+        snapshot_store_mark_node(&gs->snapshots, indices[i]);
+        journal_node(gs, indices[i]);
+    }
+}
+
+static void editor_swap_tlines(GlobalState *gs, u64 a, u64 b) {
+    TLine tline = gs->tlines[a];
+    gs->tlines[a] = gs->tlines[b];
+    gs->tlines[b] = tline;
+    editor_patch_tline(gs, a);
+    editor_patch_tline(gs, b);
+}
+
+static void editor_undo_move_node(GlobalState *gs, u64 index,
+                                  const u8 *payload) {
+    Vector2 center;
+    memcpy(&center, payload, sizeof(center));
+
+    Node *node = &gs->nodes[index];
+    history_move_node(&gs->history, index, node->center);
+    node->position =
+        Vector2Add(node->position, Vector2Subtract(center, node->center));
+    node->center = center;
+    journal_node(gs, index);
+}
+
+// Changes the node back, or puts a removed one back at its index
+static void editor_undo_node(GlobalState *gs, u64 index, const u8 *payload,
+                             bool removed) {
+    HistoryNode hn;
+    memcpy(&hn, payload, sizeof(hn));
+
+    if (removed) {
+        editor_add_node(gs, hn.center);
+        u64 last = darray_get_size(gs->nodes) - 1;
+        history_add_node(&gs->history, index);
+        if (index != last) editor_swap_nodes(gs, index, last);
+    } else {
+        editor_record_node(gs, index);
+    }
+
+    Node *node = &gs->nodes[index];
+    node->position =
+        Vector2Add(node->position, Vector2Subtract(hn.center, node->center));
+    node->center = hn.center;
+    node_set_name(node, &gs->strings, (const char *)payload + sizeof(hn),
+                  hn.name_len);
+    node->initial_state = hn.flags & FSM_STATE_INITIAL;
+    node->accepting_state = hn.flags & FSM_STATE_ACCEPTING;
+    editor_patch_state(gs, index);
+    snapshot_store_mark_node(&gs->snapshots, index);
+    journal_node(gs, index);
+}
+
+static void editor_undo_tline(GlobalState *gs, u64 index, const u8 *payload,
+                              bool removed) {
+    HistoryTLine ht;
+    memcpy(&ht, payload, sizeof(ht));
+
+    if (removed) {
+        TLine tline;
+        tline_create(&tline);
+        tline_set_font(&tline, gs->font);
+        tline.editing = true;
+        darray_push(&gs->tlines, tline);
+
+        u64 last = darray_get_size(gs->tlines) - 1;
+        editor_patch_tline(gs, last);
+        history_add_tline(&gs->history, index);
+        if (index != last) editor_swap_tlines(gs, index, last);
+    } else {
+        editor_record_tline(gs, index);
+    }
+
+    TLine *tl = &gs->tlines[index];
+    tline_set_start_node(
+        tl, ht.start == FSM_TABLE_NONE ? NULL : &gs->nodes[ht.start]);
+    tline_set_end_node(tl,
+                       ht.end == FSM_TABLE_NONE ? NULL : &gs->nodes[ht.end]);
+    tline_set_inputs(tl, &gs->strings, (const char *)payload + sizeof(ht),
+                     ht.inputs_len);
+    editor_patch_tline(gs, index);
+}
+
+static void editor_undo_alphabet(GlobalState *gs, const u8 *payload) {
+    HistoryAlphabet ha;
+    memcpy(&ha, payload, sizeof(ha));
+
+    char *alphabet = NULL;
+    if (ha.len) {
+        alphabet = (char *)memory_alloc(ha.len + 1, MEMORY_TAG_STRINGS);
+        if (!alphabet) return;
+        memcpy(alphabet, payload + sizeof(ha), ha.len);
+        alphabet[ha.len] = 0;
+    }
+
+    history_alphabet(&gs->history, gs->fsm_type, gs->alphabet,
+                     gs->alphabet_len);
+    memory_free(gs->alphabet);
+    gs->alphabet = alphabet;
+    gs->alphabet_len = ha.len;
+    gs->fsm_type = ha.fsm_type;
+
+    InputBox *alphabet_box = &input_boxes[INPUT_BOX_ALPHABET];
+    input_box_set_text(alphabet_box, gs->alphabet, gs->alphabet_len);
+    alphabet_generation = alphabet_box->generation;
+    journal_alphabet(gs);
+}
+
+static void editor_undo_record(GlobalState *gs, const HistoryRecord *record) {
+    const u8 *payload = (const u8 *)(record + 1);
+    switch (record->type) {
+        case HISTORY_RECORD_MOVE_NODE:
+            editor_undo_move_node(gs, record->index, payload);
+            break;
+        case HISTORY_RECORD_ADD_NODE:
+            editor_remove_node(gs, record->index);
+            break;
+        case HISTORY_RECORD_CHANGE_NODE:
+        case HISTORY_RECORD_REMOVE_NODE:
+            editor_undo_node(gs, record->index, payload,
+                             record->type == HISTORY_RECORD_REMOVE_NODE);
+            break;
+        case HISTORY_RECORD_ADD_TLINE:
+            editor_remove_tline(gs, record->index);
+            break;
+        case HISTORY_RECORD_CHANGE_TLINE:
+        case HISTORY_RECORD_REMOVE_TLINE:
+            editor_undo_tline(gs, record->index, payload,
+                              record->type == HISTORY_RECORD_REMOVE_TLINE);
+            break;
+        case HISTORY_RECORD_ALPHABET:
+            editor_undo_alphabet(gs, payload);
+            break;
+        default:
+            break;
+    }
+}
+
+// Undoing or redoing an entry records its inverse on the other stack, so
+// both directions go through the same records
+static void editor_replay_history(GlobalState *gs, bool redo) {
+    history_seal(&gs->history);
+    bool started = redo ? history_begin_redo(&gs->history)
+                        : history_begin_undo(&gs->history);
+    if (!started) return;
+
+    // The selection may point at what is undone
+    if (selected_node) {
+        selected_node->selected = false;
+        selected_node = NULL;
+        input_box_set_text(&input_boxes[INPUT_BOX_NAME], NULL, 0);
+    }
+    if (selected_tline) {
+        selected_tline->selected = false;
+        selected_tline = NULL;
+    }
+    for (u32 i = 0; i < NODE_SELECTOR_MAX; ++i)
+        node_selector_set_node(&node_selectors[i], NULL);
+    input_box_set_text(&tr_input, NULL, 0);
+
+    const HistoryRecord *record;
+    while ((record = history_next(&gs->history)))
+        editor_undo_record(gs, record);
+    history_end(&gs->history);
+    gs->version++;
+}
+
+static i32 reload_entry_compare_keys(const ReloadEntry *a,
+                                     const ReloadEntry *b, bool text) {
+    if (a->start != b->start) return a->start < b->start ? -1 : 1;
+    if (a->end != b->end) return a->end < b->end ? -1 : 1;
+    if (!text) return 0;
+
+    i32 order = memcmp(a->text, b->text, MIN(a->len, b->len));
+    if (order) return order;
+    if (a->len != b->len) return a->len < b->len ? -1 : 1;
+    return 0;
+}
+
+static int reload_entry_compare(const void *a, const void *b) {
+    const ReloadEntry *x = (const ReloadEntry *)a;
+    const ReloadEntry *y = (const ReloadEntry *)b;
+    i32 order = reload_entry_compare_keys(x, y, true);
+    if (order) return order;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// Pairs the unpaired entries with equal keys in index order, without the text
+// only the endpoints have to be equal
+static void reload_pair(ReloadEntry *current, u32 current_count,
+                        u32 *current_match, ReloadEntry *model,
+                        u32 model_count, u32 *model_match, bool text) {
+    u32 i = 0, j = 0;
+    while (i < current_count && j < model_count) {
+        if (current_match[current[i].index] != FSM_TABLE_NONE) {
+            ++i;
+            continue;
+        }
+        if (model_match[model[j].index] != FSM_TABLE_NONE) {
+            ++j;
+            continue;
+        }
+
+        i32 order = reload_entry_compare_keys(&current[i], &model[j], text);
+        if (order < 0) {
+            ++i;
+        } else if (order > 0) {
+            ++j;
+        } else {
+            current_match[current[i].index] = model[j].index;
+            model_match[model[j].index] = current[i].index;
+            ++i;
+            ++j;
+        }
+    }
+}
+
+// Nodes are paired by name, returns the current index of every model node
+static bool editor_reload_scratch(GlobalState *gs, ReloadScratch *rs,
+                                  u32 current_count, u32 model_count) {
+    rs->current = (ReloadEntry *)arena_alloc(
+        &gs->frame, (current_count + 1) * sizeof(ReloadEntry));
+    rs->entries = (ReloadEntry *)arena_alloc(
+        &gs->frame, (model_count + 1) * sizeof(ReloadEntry));
+    rs->current_match =
+        (u32 *)arena_alloc(&gs->frame, (current_count + 1) * sizeof(u32));
+    rs->model_match =
+        (u32 *)arena_alloc(&gs->frame, (model_count + 1) * sizeof(u32));
+    return rs->current && rs->entries && rs->current_match && rs->model_match;
+}
+
+static u32 *editor_reload_nodes(GlobalState *gs, GlobalState *model,
+                                ReloadScratch *rs) {
+    u32 current_count = darray_get_size(gs->nodes);
+    u32 model_count = darray_get_size(model->nodes);
+    ReloadEntry *current = rs->current;
+    ReloadEntry *entries = rs->entries;
+    u32 *current_match = rs->current_match;
+    u32 *node_of = rs->model_match;
+
+    for (u32 i = 0; i < current_count; ++i) {
+        Node *node = &gs->nodes[i];
+        current[i] = (ReloadEntry){.text = small_string_get(&node->name),
+                                   .len = node->name.len,
+                                   .index = i};
+        current_match[i] = FSM_TABLE_NONE;
+    }
+    for (u32 i = 0; i < model_count; ++i) {
+        Node *node = &model->nodes[i];
+        entries[i] = (ReloadEntry){.text = small_string_get(&node->name),
+                                   .len = node->name.len,
+                                   .index = i};
+        node_of[i] = FSM_TABLE_NONE;
+    }
+
+    qsort(current, current_count, sizeof(ReloadEntry), reload_entry_compare);
+    qsort(entries, model_count, sizeof(ReloadEntry), reload_entry_compare);
+    reload_pair(current, current_count, current_match, entries, model_count,
+                node_of, true);
+
+    // Backwards, so the node swapped into a removed one was already visited
+    for (u32 i = current_count; i > 0; --i) {
+        if (current_match[i - 1] != FSM_TABLE_NONE) continue;
+        if (selected_node == &gs->nodes[i - 1]) {
+            selected_node = NULL;
+            input_box_set_text(&input_boxes[INPUT_BOX_NAME], NULL, 0);
+        }
+
+        u64 last = darray_get_size(gs->nodes) - 1;
+        editor_remove_node(gs, i - 1);
+        current_match[i - 1] = current_match[last];
+    }
+
+    // Untouched nodes keep their place, only differences are patched
+    current_count = darray_get_size(gs->nodes);
+    for (u32 i = 0; i < current_count; ++i) {
+        Node *node = &gs->nodes[i];
+        Node *src = &model->nodes[current_match[i]];
+        node_of[current_match[i]] = i;
+
+        bool moved = !Vector2Equals(node->center, src->center);
+        bool flagged = node->initial_state != src->initial_state
+                    || node->accepting_state != src->accepting_state;
+        if (!moved && !flagged) continue;
+
+        editor_record_node(gs, i);
+        if (moved) {
+            Vector2 delta = Vector2Subtract(src->center, node->center);
+            node->center = src->center;
+            node->position = Vector2Add(node->position, delta);
+        }
+        if (flagged) {
+            node->initial_state = src->initial_state;
+            node->accepting_state = src->accepting_state;
+            editor_patch_state(gs, i);
+        }
+        snapshot_store_mark_node(&gs->snapshots, i);
+        journal_node(gs, i);
+
+        if (node == selected_node) {
+            check_box_set_checked(&check_boxes[CHECK_BOX_INITIAL_STATE],
+                                  node->initial_state);
+            check_box_set_checked(&check_boxes[CHECK_BOX_ACCEPTING_STATE],
+                                  node->accepting_state);
+            editor_track_node_widgets();
+        }
+    }
+
+    for (u32 i = 0; i < model_count; ++i) {
+        if (node_of[i] != FSM_TABLE_NONE) continue;
+        Node *src = &model->nodes[i];
+
+        editor_add_node(gs, src->center);
+        u64 index = darray_get_size(gs->nodes) - 1;
+        history_add_node(&gs->history, index);
+        Node *node = &gs->nodes[index];
+        node_set_name(node, &gs->strings, small_string_get(&src->name),
+                      src->name.len);
+        node->initial_state = src->initial_state;
+        node->accepting_state = src->accepting_state;
+        editor_patch_state(gs, index);
+        snapshot_store_mark_node(&gs->snapshots, index);
+        journal_node(gs, index);
+        node_of[i] = index;
+    }
+
+    return node_of;
+}
+
+// Tlines are paired by endpoints and inputs, then by endpoints alone
+static void editor_reload_tlines(GlobalState *gs, GlobalState *model,
+                                 u32 *node_of, ReloadScratch *rs) {
+    // Removed nodes took their tlines with them, so there are no more than
+    // the scratch was taken for
+    u32 current_count = darray_get_size(gs->tlines);
+    u32 model_count = darray_get_size(model->tlines);
+    ReloadEntry *current = rs->current;
+    ReloadEntry *entries = rs->entries;
+    u32 *current_match = rs->current_match;
+    u32 *model_match = rs->model_match;
+
+    for (u32 i = 0; i < current_count; ++i) {
+        TLine *tl = &gs->tlines[i];
+        current[i] = (ReloadEntry){
+            .start = tl->start ? tl->start - gs->nodes : FSM_TABLE_NONE,
+            .end = tl->end ? tl->end - gs->nodes : FSM_TABLE_NONE,
+            .text = small_string_get(&tl->inputs),
+            .len = tl->inputs.len,
+            .index = i};
+        current_match[i] = FSM_TABLE_NONE;
+    }
+    for (u32 i = 0; i < model_count; ++i) {
+        TLine *tl = &model->tlines[i];
+        entries[i] = (ReloadEntry){
+            .start = tl->start ? node_of[tl->start - model->nodes]
+                               : FSM_TABLE_NONE,
+            .end = tl->end ? node_of[tl->end - model->nodes] : FSM_TABLE_NONE,
+            .text = small_string_get(&tl->inputs),
+            .len = tl->inputs.len,
+            .index = i};
+        model_match[i] = FSM_TABLE_NONE;
+    }
+
+    qsort(current, current_count, sizeof(ReloadEntry), reload_entry_compare);
+    qsort(entries, model_count, sizeof(ReloadEntry), reload_entry_compare);
+    reload_pair(current, current_count, current_match, entries, model_count,
+                model_match, true);
+    reload_pair(current, current_count, current_match, entries, model_count,
+                model_match, false);
+
+    for (u32 i = current_count; i > 0; --i) {
+        if (current_match[i - 1] != FSM_TABLE_NONE) continue;
+        u64 last = darray_get_size(gs->tlines) - 1;
+        editor_remove_tline(gs, i - 1);
+        current_match[i - 1] = current_match[last];
+    }
+
+    current_count = darray_get_size(gs->tlines);
+    for (u32 i = 0; i < current_count; ++i) {
+        TLine *tl = &gs->tlines[i];
+        SmallString *inputs = &model->tlines[current_match[i]].inputs;
+        if (tl->inputs.len == inputs->len
+            && !memcmp(small_string_get(&tl->inputs), small_string_get(inputs),
+                       inputs->len))
+            continue;
+
+        editor_record_tline(gs, i);
+        tline_set_inputs(tl, &gs->strings, small_string_get(inputs),
+                         inputs->len);
+        editor_patch_tline(gs, i);
+        if (tl == selected_tline)
+            input_box_set_text(&tr_input, small_string_get(&tl->inputs),
+                               tl->inputs.len);
+    }
+
+    for (u32 i = 0; i < model_count; ++i) {
+        if (model_match[i] != FSM_TABLE_NONE) continue;
+        TLine *src = &model->tlines[i];
+
+        TLine tline;
+        tline_create(&tline);
+        if (src->start) {
+            u32 start = node_of[src->start - model->nodes];
+            tline_set_start_node(&tline, &gs->nodes[start]);
+        }
+        if (src->end) {
+            u32 end = node_of[src->end - model->nodes];
+            tline_set_end_node(&tline, &gs->nodes[end]);
+        }
+        tline_set_inputs(&tline, &gs->strings, small_string_get(&src->inputs),
+                         src->inputs.len);
+        tline_set_font(&tline, gs->font);
+        tline.editing = true;
+
+        darray_push(&gs->tlines, tline);
+        editor_patch_tline(gs, darray_get_size(gs->tlines) - 1);
+        history_add_tline(&gs->history, darray_get_size(gs->tlines) - 1);
+    }
+}
+
+// The file is the truth, but only what differs from it is touched. Matched
+// nodes keep their state on screen and the camera stays where it is
+static bool editor_apply_reload(GlobalState *gs, GlobalState *model) {
+    ReloadScratch node_scratch, tline_scratch;
+    if (!editor_reload_scratch(gs, &node_scratch, darray_get_size(gs->nodes),
+                               darray_get_size(model->nodes))
+        || !editor_reload_scratch(gs, &tline_scratch,
+                                  darray_get_size(gs->tlines),
+                                  darray_get_size(model->tlines))) {
+        TraceLog(LOG_WARNING, "Out of memory, the changed file waits");
+        return false;
+    }
+
+    FSMType fsm_type = gs->fsm_type;
+    gs->fsm_type = model->fsm_type;
+    if (fsm_type != gs->fsm_type || gs->alphabet_len != model->alphabet_len
+        || (gs->alphabet_len
+            && memcmp(gs->alphabet, model->alphabet, gs->alphabet_len))) {
+        history_alphabet(&gs->history, fsm_type, gs->alphabet,
+                         gs->alphabet_len);
+        char *alphabet = gs->alphabet;
+        u64 alphabet_len = gs->alphabet_len;
+        gs->alphabet = model->alphabet;
+        gs->alphabet_len = model->alphabet_len;
+        model->alphabet = alphabet;
+        model->alphabet_len = alphabet_len;
+
+        InputBox *alphabet_box = &input_boxes[INPUT_BOX_ALPHABET];
+        input_box_set_text(alphabet_box, gs->alphabet, gs->alphabet_len);
+        alphabet_generation = alphabet_box->generation;
+        journal_alphabet(gs);
+    }
+
+    u32 *node_of = editor_reload_nodes(gs, model, &node_scratch);
+    editor_reload_tlines(gs, model, node_of, &tline_scratch);
+    gs->version++;
+    return true;
+}
+
 Screen editor = {.load = editor_load,
                  .unload = editor_unload,
                  .draw = editor_draw,
                  .before_draw = editor_before_draw,
+                 .is_active = editor_is_active,
+                 .release_jobs = editor_release_jobs,
                  .update = editor_update};
@@ -7,7 +7,9 @@
 
 #include "utils/button.h"
 #include "utils/darray.h"
+#include "utils/fsm_io.h"
 #include "utils/funcs.h"
+#include "utils/journal.h"
 #include "utils/node.h"
 #include "utils/text.h"
 #include "utils/tline.h"
@@ -34,6 +36,8 @@ static void menu_update_transforms(void);
 
 static Vector2 menu_get_transformed_mouse_position(void);
 
+static bool menu_is_active(GlobalState *gs);
+
 void menu_load(GlobalState *gs) {
     bg = DARKGRAY;
     change_screen = false;
@@ -63,16 +67,7 @@ void menu_load(GlobalState *gs) {
 
     menu_update_transforms();
 
-    u64 length = darray_get_size(gs->nodes);
-    for (u64 i = 0; i < length; ++i) node_destroy(&gs->nodes[i]);
-    darray_clear(gs->nodes);
-    length = darray_get_size(gs->tlines);
-    for (u64 i = 0; i < length; ++i) tline_destroy(&gs->tlines[i]);
-    darray_clear(gs->tlines);
-
-    free(gs->alphabet);
-    gs->alphabet = NULL;
-    gs->alphabet_len = 0;
+    clear_fsm(gs);
 }
 
 void menu_unload(GlobalState *gs) {
@@ -91,8 +86,15 @@ ScreenChangeType menu_update(GlobalState *gs) {
     for (i32 i = 0; i < BUTTON_MAX; ++i)
         handled = button_update(&buttons[i], mpos, handled);
 
-    for (i32 i = 0; i < BUTTON_MAX; ++i)
-        if (buttons[i].clicked) on_button_clicked[i](gs);
+    // Nothing else is started until the file is in
+    if (!fsm_io_is_loading())
+        for (i32 i = 0; i < BUTTON_MAX; ++i)
+            if (buttons[i].clicked) on_button_clicked[i](gs);
+
+    if (fsm_io_take_loaded() || journal_take_recovered()) {
+        gs->next_screen = &editor;
+        change_screen = true;
+    }
 
     if (change_screen) return SCREEN_CHANGE;
     return SCREEN_SAME;
@@ -100,6 +102,10 @@ ScreenChangeType menu_update(GlobalState *gs) {
 
 void menu_before_draw(GlobalState *gs) {
     UNUSED(gs);
+    bool dirty = false;
+    for (i32 i = 0; i < BUTTON_MAX; ++i) dirty |= button_is_dirty(&buttons[i]);
+    if (!dirty) return;
+
     BeginTextureMode(target);
 
     ClearBackground(bg);
@@ -153,20 +159,25 @@ static void on_nfa_button_clicked(GlobalState *gs) {
 }
 
 static void on_load_button_clicked(GlobalState *gs) {
-    const char *filters[] = {"*.fsm"};
-    char *file_name = tinyfd_openFileDialog("Open the FSM file", NULL, 1,
+    const char *filters[] = {"*.fsm", "*" FSM_TEXT_FILE_EXTENSION};
+    char *file_name = tinyfd_openFileDialog("Open the FSM file", NULL, 2,
                                             filters, "FSM files", 0);
 
     if (!file_name) return;
 
-    if (load_fsm_from_file(gs, file_name)) {
-        gs->next_screen = &editor;
-        change_screen = true;
-    }
+    // The menu moves on to the editor once the model is swapped in
+    if (!fsm_io_load(gs, file_name))
+        TraceLog(LOG_ERROR, "%s: Failed to start loading", file_name);
+}
+
+static bool menu_is_active(GlobalState *gs) {
+    UNUSED(gs);
+    return false;
 }
 
 Screen menu = {.load = menu_load,
                .unload = menu_unload,
                .draw = menu_draw,
                .before_draw = menu_before_draw,
+               .is_active = menu_is_active,
                .update = menu_update};
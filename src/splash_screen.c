@@ -89,7 +89,6 @@ ScreenChangeType splash_screen_update(GlobalState *gs) {
 }
 
 void splash_screen_before_draw(GlobalState *gs) {
-    UNUSED(gs);
     BeginTextureMode(target);
 
     ClearBackground(bg);
@@ -115,7 +114,7 @@ void splash_screen_before_draw(GlobalState *gs) {
             DrawRectangle(logo_x + 32, logo_y + 32, 512 - (2 * 32),
                           512 - (2 * 32), bg);
 
-            DrawText(TextSubtext("raylib", 0, letters_count),
+            DrawText(arena_format(&gs->frame, "%.*s", letters_count, "raylib"),
                      (target.texture.width / 2) - 88,
                      (target.texture.height / 2) + 96 + 128, 100, BLACK);
 
@@ -4,22 +4,51 @@
 #include <stdlib.h>
 
 #include "utils/darray.h"
+#include "utils/fsm_io.h"
+#include "utils/funcs.h"
+#include "utils/journal.h"
+#include "utils/memory.h"
+
+// Analysis jobs are mostly memory bound, more threads do not pay off
+#define STATEFLOW_WORKER_THREADS 2
+
+// Grows to the peak of a frame on the first reset after it is exceeded
+#define STATEFLOW_FRAME_ARENA_SIZE (16 * 1024)
+
+#if defined(STATEFLOW_GLFW)
+// raylib is built with GLFW on the desktop, which it does not expose
+void glfwPostEmptyEvent(void);
+
+// Ends the wait for input of EndDrawing, safe from any thread
+static void stateflow_wake(void) {
+    glfwPostEmptyEvent();
+}
+#endif
 
 typedef struct State {
         Screen *current_screen;
         u64 frame_count;
         bool transitioning;
         bool fade_out;
+        bool waiting_events;
         float alpha;
+        u64 reported_frame_peak;
+        bool show_memory;  // Per-subsystem memory overlay, toggled with F2
 } State;
 
 static State state = {0};
 static GlobalState gs = {0};
+static Screen *screens[] = {&splash_screen, &menu, &editor, &animation};
 
 static void stateflow_change_screen(void);
 static void stateflow_fade_screen(void);
 static void stateflow_update_fading(void);
 static void stateflow_draw_fade(void);
+static void stateflow_update_event_waiting(void);
+static void stateflow_reset_frame_arena(void);
+static void stateflow_draw_memory_overlay(void);
+static void stateflow_report_leaks(void);
+static void stateflow_release_jobs(Screen *shown);
 
 void stateflow_initialize(void) {
     InitWindow(800, 600, STATEFLOW_NAME);
@@ -32,10 +61,23 @@ void stateflow_initialize(void) {
         // LoadFont("assets/JetBrainsMonoNerdFont-Medium.ttf");
         LoadFontEx("assets/FiraCodeNerdFontMono-Bold.ttf", 144, NULL, 0);
     gs.fsm_type = FSM_TYPE_MAX;
-    gs.nodes = darray_create(Node);
-    gs.tlines = darray_create(TLine);
+    gs.nodes = darray_create_tagged(Node, MEMORY_TAG_NODES);
+    gs.tlines = darray_create_tagged(TLine, MEMORY_TAG_TLINES);
+    arena_create(&gs.strings, ARENA_DEFAULT_BLOCK_SIZE, MEMORY_TAG_STRINGS);
+    arena_create(&gs.frame, STATEFLOW_FRAME_ARENA_SIZE, MEMORY_TAG_UI);
     gs.alphabet = NULL;
     gs.alphabet_len = 0;
+    snapshot_store_create(&gs.snapshots);
+    fsm_table_create(&gs.table);
+    history_create(&gs.history);
+    if (!worker_pool_create(&gs.workers, STATEFLOW_WORKER_THREADS))
+        TraceLog(LOG_FATAL, "Failed to start the worker threads");
+#if defined(STATEFLOW_GLFW)
+    // The watched file is then reloaded while the loop waits for input
+    fsm_io_set_wake(stateflow_wake);
+#endif
+    // The menu opens what a crash left behind in the editor
+    journal_recover(&gs);
 
     state.current_screen = &splash_screen;
     state.transitioning = false;
@@ -101,19 +143,45 @@ void stateflow_initialize(void) {
 
 void stateflow_shutdown(void) {
     state.current_screen->unload(&gs);
-
+    // Unloading cancels the jobs of the screen, so this does not block long
+    fsm_io_cancel();
+    worker_pool_destroy(&gs.workers);
+    // The pool hands back every job it did not run
+    stateflow_release_jobs(NULL);
+    fsm_io_shutdown();
+    journal_shutdown();
+    snapshot_store_destroy(&gs.snapshots);
+    fsm_table_destroy(&gs.table);
+    history_destroy(&gs.history);
+
+    for (u64 i = 0; i < darray_get_size(gs.nodes); ++i)
+        node_destroy(&gs.nodes[i]);
+    for (u64 i = 0; i < darray_get_size(gs.tlines); ++i)
+        tline_destroy(&gs.tlines[i]);
     darray_destroy(gs.nodes);
     darray_destroy(gs.tlines);
-    free(gs.alphabet);
+    arena_destroy(&gs.strings);
+    TraceLog(LOG_INFO, "Frame arena peak: %llu bytes",
+             (unsigned long long)MAX(gs.frame.peak, gs.frame.used));
+    arena_destroy(&gs.frame);
+    memory_free(gs.alphabet);
     gs.alphabet = NULL;
 
     UnloadFont(gs.font);
+    unload_grid_shader();
+
+    stateflow_report_leaks();
 
     CloseWindow();
 }
 
 void stateflow_run(void) {
     while (!WindowShouldClose()) {
+        stateflow_reset_frame_arena();
+        fsm_io_update(&gs);
+        journal_update(&gs);
+        stateflow_release_jobs(state.current_screen);
+
         if (state.transitioning) {
             stateflow_update_fading();
         } else {
@@ -129,6 +197,10 @@ void stateflow_run(void) {
             }
         }
 
+        if (IsKeyPressed(KEY_F2)) state.show_memory = !state.show_memory;
+
+        stateflow_update_event_waiting();
+
         if (state.current_screen->before_draw)
             state.current_screen->before_draw(&gs);
 
@@ -139,7 +211,9 @@ void stateflow_run(void) {
         //                GetScreenHeight(), GetRenderWidth(),
         //                GetRenderHeight()),
         //     50, 50, 50, GREEN);
+        fsm_io_draw_progress(&gs);
         if (state.transitioning) stateflow_draw_fade();
+        if (state.show_memory) stateflow_draw_memory_overlay();
 
         EndDrawing();
     }
@@ -196,3 +270,76 @@ static void stateflow_draw_fade(void) {
     DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(),
                   Fade(BLACK, state.alpha));
 }
+
+static void stateflow_update_event_waiting(void) {
+    // Frames keep running while a file job reports its progress and until
+    // the autosave has caught up
+    bool active = state.transitioning || fsm_io_is_busy() || journal_is_busy()
+               || !state.current_screen->is_active
+               || state.current_screen->is_active(&gs);
+
+    // EndDrawing() blocks until the next input event while waiting
+    if (active && state.waiting_events) {
+        DisableEventWaiting();
+        state.waiting_events = false;
+    } else if (!active && !state.waiting_events) {
+        EnableEventWaiting();
+        state.waiting_events = true;
+    }
+}
+
+static void stateflow_reset_frame_arena(void) {
+    arena_reset(&gs.frame);
+#ifndef NDEBUG
+    if (gs.frame.peak > state.reported_frame_peak) {
+        state.reported_frame_peak = gs.frame.peak;
+        TraceLog(LOG_DEBUG, "Frame arena peak: %llu bytes",
+                 (unsigned long long)gs.frame.peak);
+    }
+#endif
+}
+
+static void stateflow_draw_memory_overlay(void) {
+    const float font_size = 20;
+    const float line_height = font_size + 4;
+    Vector2 position = {10, 10};
+
+    DrawRectangle(0, 0, 420, (MEMORY_TAG_MAX + 1) * line_height + 16,
+                  Fade(BLACK, 0.7f));
+    DrawTextEx(gs.font, "Tag       Live KB   Peak KB   Blocks", position,
+               font_size, 1.0f, RAYWHITE);
+    for (MemoryTag tag = 0; tag < MEMORY_TAG_MAX; ++tag) {
+        MemoryStats stats = memory_get_stats(tag);
+        position.y += line_height;
+        const char *text = arena_format(
+            &gs.frame, "%-8s %8.1f  %8.1f  %7llu", memory_get_tag_name(tag),
+            stats.live_bytes / 1024.0, stats.peak_bytes / 1024.0,
+            (unsigned long long)stats.live_allocations);
+        if (text)
+            DrawTextEx(gs.font, text, position, font_size, 1.0f, RAYWHITE);
+    }
+}
+
+// Everything counted is released by now, what is left was leaked
+static void stateflow_report_leaks(void) {
+    for (MemoryTag tag = 0; tag < MEMORY_TAG_MAX; ++tag) {
+        MemoryStats stats = memory_get_stats(tag);
+        TraceLog(LOG_INFO, "Memory %s: peak %llu bytes, %llu allocations",
+                 memory_get_tag_name(tag),
+                 (unsigned long long)stats.peak_bytes,
+                 (unsigned long long)stats.total_allocations);
+        if (stats.live_allocations)
+            TraceLog(LOG_WARNING, "Memory %s: %llu bytes in %llu blocks leaked",
+                     memory_get_tag_name(tag),
+                     (unsigned long long)stats.live_bytes,
+                     (unsigned long long)stats.live_allocations);
+    }
+}
+
+// Jobs of the screen that is shown are taken in by its update
+static void stateflow_release_jobs(Screen *shown) {
+    u32 length = sizeof(screens) / sizeof(screens[0]);
+    for (u32 i = 0; i < length; ++i)
+        if (screens[i] != shown && screens[i]->release_jobs)
+            screens[i]->release_jobs(&gs);
+}
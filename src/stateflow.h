@@ -3,7 +3,12 @@
 #include <raylib.h>
 
 #include "defines.h"
+#include "utils/arena.h"
+#include "utils/history.h"
+#include "utils/snapshot.h"
+#include "utils/table.h"
 #include "utils/tline.h"
+#include "utils/worker.h"
 
 typedef struct Screen Screen;
 
@@ -20,9 +25,16 @@ typedef struct GlobalState {
         Font font;
         Node *nodes;  // Darray
         TLine *tlines;  // Darray
+        Arena strings;  // Long node names and tline inputs, reset on unload
+        Arena frame;  // Scratch memory, reset at the start of every frame
         FSMType fsm_type;
         char *alphabet;
         u64 alphabet_len;
+        u64 version;  // Incremented on every edit of the automaton
+        WorkerPool workers;  // Runs analysis jobs off the render thread
+        SnapshotStore snapshots;  // Versions of the automaton for the jobs
+        FsmTable table;  // Compiled automaton, patched on every edit
+        History history;  // Undo and redo of the editor
         // i32 virtual_width;
         // i32 virtual_height;
         // Camera2D camera;
@@ -34,6 +46,12 @@ struct Screen {
         ScreenChangeType (*update)(GlobalState *gs);
         void (*draw)(GlobalState *gs);
         void (*before_draw)(GlobalState *gs);
+        // Optional, while it returns false frames only run on input events
+        bool (*is_active)(GlobalState *gs);
+        // Optional, frees the jobs the screen cancelled as they come back.
+        // Called every frame while another screen is shown and once more
+        // after the worker pool is destroyed
+        void (*release_jobs)(GlobalState *gs);
 };
 
 extern Screen splash_screen;
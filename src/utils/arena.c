@@ -0,0 +1,117 @@
+#include "arena.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock {
+        ArenaBlock *next;
+        u64 capacity;
+        u64 used;
+        u8 data[];
+};
+
+static ArenaBlock *arena_block_create(Arena *a, u64 capacity,
+                                      ArenaBlock *next) {
+    ArenaBlock *block =
+        (ArenaBlock *)memory_alloc(sizeof(ArenaBlock) + capacity, a->tag);
+    if (!block) return NULL;
+    block->next = next;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+void arena_create(Arena *a, u64 block_size, MemoryTag tag) {
+    a->blocks = NULL;
+    a->block_size = block_size;
+    a->initial_block_size = block_size;
+    a->used = 0;
+    a->peak = 0;
+    a->tag = tag;
+}
+
+static void arena_free_blocks(Arena *a) {
+    while (a->blocks) {
+        ArenaBlock *next = a->blocks->next;
+        memory_free(a->blocks);
+        a->blocks = next;
+    }
+}
+
+void arena_destroy(Arena *a) {
+    arena_free_blocks(a);
+    a->used = 0;
+}
+
+void *arena_alloc(Arena *a, u64 size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(u64)(ARENA_ALIGNMENT - 1);
+
+    ArenaBlock *block = a->blocks;
+    if (block && block->capacity - block->used >= size) {
+        void *ptr = &block->data[block->used];
+        block->used += size;
+        a->used += size;
+        return ptr;
+    }
+
+    if (size > a->block_size / 4) {
+        // Kept behind the current block, which still has room left
+        block = arena_block_create(a, size, NULL);
+        if (!block) return NULL;
+        if (a->blocks) {
+            block->next = a->blocks->next;
+            a->blocks->next = block;
+        } else {
+            a->blocks = block;
+        }
+    } else {
+        block = arena_block_create(a, a->block_size, a->blocks);
+        if (!block) return NULL;
+        a->blocks = block;
+    }
+
+    block->used = size;
+    a->used += size;
+    return block->data;
+}
+
+void arena_reset(Arena *a) {
+    a->peak = MAX(a->peak, a->used);
+
+    if (a->blocks && a->blocks->next) {
+        a->block_size = MAX(a->block_size, a->used);
+        arena_free_blocks(a);
+    } else if (a->blocks) {
+#ifndef NDEBUG
+        memset(a->blocks->data, ARENA_POISON, a->blocks->used);
+#endif
+        a->blocks->used = 0;
+    }
+    a->used = 0;
+}
+
+void arena_clear(Arena *a) {
+    a->peak = MAX(a->peak, a->used);
+    arena_free_blocks(a);
+    a->block_size = a->initial_block_size;
+    a->used = 0;
+}
+
+char *arena_format(Arena *a, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len < 0) return NULL;
+
+    char *text = (char *)arena_alloc(a, (u64)len + 1);
+    if (!text) return NULL;
+
+    va_start(args, format);
+    vsnprintf(text, (u64)len + 1, format, args);
+    va_end(args);
+
+    return text;
+}
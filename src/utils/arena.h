@@ -0,0 +1,45 @@
+#pragma once
+
+#include "defines.h"
+#include "memory.h"
+
+#ifndef ARENA_DEFAULT_BLOCK_SIZE
+    #define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#endif
+
+#define ARENA_ALIGNMENT 8
+
+// Debug builds fill the memory with this on reset, so reads of memory from
+// before the reset stand out
+#define ARENA_POISON 0xCD
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator, the memory is only given back all at once
+typedef struct Arena {
+        ArenaBlock *blocks;  // Most recent first
+        u64 block_size;  // Of the regular blocks, larger requests get their own
+        u64 initial_block_size;  // Given to arena_create
+        u64 used;  // Bytes handed out since the last reset
+        u64 peak;  // Most bytes handed out between two resets
+        MemoryTag tag;  // The blocks are counted under it
+} Arena;
+
+void arena_create(Arena *a, u64 block_size, MemoryTag tag);
+
+void arena_destroy(Arena *a);
+
+// Aligned to ARENA_ALIGNMENT, NULL on failure
+void *arena_alloc(Arena *a, u64 size);
+
+// For scratch memory that is refilled the same way over and over. When
+// everything fit in one block it is kept for reuse, otherwise the blocks are
+// freed and the next block is made large enough for all of it
+void arena_reset(Arena *a);
+
+// Frees every block and goes back to the initial block size, for arenas
+// whose next contents may be much smaller than the last
+void arena_clear(Arena *a);
+
+// Like TextFormat, but the text stays valid until the arena is reset
+char *arena_format(Arena *a, const char *format, ...);
@@ -1,10 +1,13 @@
 #include "button.h"
 
+static i32 button_update_state(Button *btn, Vector2 mpos, u32 handled);
+
 void button_create(Button *btn, Rectangle rect) {
     text_box_create(&btn->text, rect);
     btn->state = BUTTON_STATE_NORMAL;
     btn->pressed = false;
     btn->clicked = false;
+    btn->dirty = true;
     button_set_colors(btn, (ButtonColors){.text = GREEN,
                                           .normal = BLUE,
                                           .down = DARKBLUE,
@@ -19,6 +22,7 @@ void button_destroy(Button *btn) {
 
 void button_set_colors(Button *btn, ButtonColors colors) {
     btn->colors = colors;
+    btn->dirty = true;
     text_box_set_color(&btn->text, colors.text);
 }
 
@@ -42,12 +46,25 @@ void button_draw(Button *btn) {
     DrawRectangleRec(btn->text.rect, color);
     // DrawRectangleRec(btn->text.rect, btn->color);
     text_box_draw(&btn->text);
+    btn->dirty = false;
+}
+
+bool button_is_dirty(Button *btn) {
+    return btn->dirty || btn->text.dirty;
 }
 
 i32 button_update(Button *btn, Vector2 mpos, u32 handled) {
     btn->clicked = false;
     if (btn->state == BUTTON_STATE_DISABLED) return handled;
 
+    ButtonState prev_state = btn->state;
+    handled = button_update_state(btn, mpos, handled);
+    if (btn->state != prev_state) btn->dirty = true;
+
+    return handled;
+}
+
+static i32 button_update_state(Button *btn, Vector2 mpos, u32 handled) {
     // Returns true if clicked
     if (CheckCollisionPointRec(mpos, btn->text.rect)
         && !IS_INPUT_HANDLED(handled, INPUT_MOUSE_POSITION)) {
@@ -81,11 +98,13 @@ i32 button_update(Button *btn, Vector2 mpos, u32 handled) {
 }
 
 void button_disable(Button *btn) {
+    if (btn->state == BUTTON_STATE_DISABLED) return;
     btn->state = BUTTON_STATE_DISABLED;
     text_box_set_color(&btn->text, btn->colors.disabled_text);
 }
 
 void button_enable(Button *btn) {
+    if (btn->state != BUTTON_STATE_DISABLED) return;
     btn->state = BUTTON_STATE_NORMAL;
     text_box_set_color(&btn->text, btn->colors.text);
 }
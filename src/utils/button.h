@@ -27,6 +27,7 @@ typedef struct Button {
         ButtonState state;
         bool pressed;
         bool clicked;
+        bool dirty;  // Changed since it was last drawn
 } Button;
 
 void button_create(Button *btn, Rectangle rect);
@@ -45,3 +46,5 @@ void button_disable(Button *btn);
 void button_enable(Button *btn);
 
 void button_draw(Button *btn);
+
+bool button_is_dirty(Button *btn);
@@ -2,6 +2,8 @@
 
 void check_box_create(CheckBox *cb, Rectangle rect) {
     cb->checked = false;
+    cb->generation = 0;
+    cb->dirty = true;
     cb->rect = rect;
     cb->inner_rect.width = rect.width * 0.8f;
     cb->inner_rect.height = rect.height * 0.8f;
@@ -19,6 +21,7 @@ void check_box_destroy(CheckBox *cb) {
 void check_box_draw(CheckBox *cb) {
     DrawRectangleRec(cb->rect, cb->colors.outer);
     if (cb->checked) DrawRectangleRec(cb->inner_rect, cb->colors.inner);
+    cb->dirty = false;
 }
 
 i32 check_box_update(CheckBox *cb, Vector2 mpos, i32 handled) {
@@ -30,6 +33,8 @@ i32 check_box_update(CheckBox *cb, Vector2 mpos, i32 handled) {
             && !IS_INPUT_HANDLED(handled, INPUT_LEFT_BUTTON)) {
             handled = MARK_INPUT_HANDLED(handled, INPUT_LEFT_BUTTON);
             cb->checked = !cb->checked;
+            cb->generation++;
+            cb->dirty = true;
         }
 
         return handled;
@@ -40,10 +45,14 @@ i32 check_box_update(CheckBox *cb, Vector2 mpos, i32 handled) {
 
 void check_box_set_colors(CheckBox *cb, CheckBoxColors colors) {
     cb->colors = colors;
+    cb->dirty = true;
 }
 
 void check_box_set_checked(CheckBox *cb, bool checked) {
+    if (cb->checked == checked) return;
     cb->checked = checked;
+    cb->generation++;
+    cb->dirty = true;
 }
 
 bool check_box_get_checked(CheckBox *cb) {
@@ -13,6 +13,8 @@ typedef struct CheckBox {
         Rectangle rect;
         Rectangle inner_rect;
         bool checked;
+        u32 generation;  // Incremented every time checked changes
+        bool dirty;  // Changed since it was last drawn
         CheckBoxColors colors;
 } CheckBox;
 
@@ -6,28 +6,48 @@
 
 #define HEADER_SIZE (sizeof(u64) * DARRAY_MAX_FIELDS)
 
+// The header sits right before the first element
+static u64 *darray_header(void *arr) {
+    return (u64 *)arr - DARRAY_MAX_FIELDS;
+}
+
+// First element of an allocation, leaving room for the header
+static u8 *darray_align(u8 *raw) {
+    u64 data = (u64)raw + HEADER_SIZE;
+    data = (data + DARRAY_ALIGNMENT - 1) & ~(u64)(DARRAY_ALIGNMENT - 1);
+    return (u8 *)data;
+}
+
+static u64 darray_allocation_size(u64 capacity, u64 stride) {
+    return (capacity * stride) + HEADER_SIZE + DARRAY_ALIGNMENT;
+}
+
 /**
  * @brief Create a darray.
  *
  * @param stride Size of each element
+ * @param tag Memory tag the array is counted under
  *
  * @return Pointer to the array or NULL on failure.
  */
-void *impl_darray_create(u64 capacity, u64 stride) {
-    u64 total = (capacity * stride) + HEADER_SIZE;
+void *impl_darray_create(u64 capacity, u64 stride, MemoryTag tag) {
+    u64 total = darray_allocation_size(capacity, stride);
 
     // Allocate memeory
-    u64 *ptr = (u64 *)malloc(total);
-    if (!ptr) return NULL;
+    u8 *raw = (u8 *)memory_alloc(total, tag);
+    if (!raw) return NULL;
 
-    memset(ptr, 0, total);
+    memset(raw, 0, total);
 
     // Store the header field values
-    ptr[DARRAY_CAPACITY] = capacity;
-    ptr[DARRAY_STRIDE] = stride;
-    ptr[DARRAY_SIZE] = 0;
+    u8 *data = darray_align(raw);
+    u64 *p = darray_header(data);
+    p[DARRAY_CAPACITY] = capacity;
+    p[DARRAY_STRIDE] = stride;
+    p[DARRAY_SIZE] = 0;
+    p[DARRAY_OFFSET] = data - raw;
 
-    return (void *)((u64)ptr + HEADER_SIZE);
+    return data;
 }
 
 /**
@@ -36,38 +56,91 @@ void *impl_darray_create(u64 capacity, u64 stride) {
  * @param arr The array
  */
 void impl_darray_destroy(void *arr) {
-    u64 ptr = (u64)arr;
-    ptr -= HEADER_SIZE;
-
-    free((void *)ptr);
+    if (!arr) return;
+    memory_free((u8 *)arr - darray_header(arr)[DARRAY_OFFSET]);
 }
 
 /**
  * @brief Resize the array to hold the given number of elements.
  *
  * After successfull execution of this function the array might be pointing to
- * some other address since it is using realloc.
+ * some other address since it is using realloc. Elements past the new
+ * capacity are dropped and the array keeps its memory tag.
  *
  * @param arr Pointer to the array.
  * @param capacity The new capacity
  */
 bool impl_darray_resize(void **arr, u64 capacity) {
-    u64 ptr = (u64)(*arr);
-    ptr -= HEADER_SIZE;
+    u64 *p = darray_header(*arr);
+    u64 stride = p[DARRAY_STRIDE];
+    u64 offset = p[DARRAY_OFFSET];
+    u64 size = MIN(p[DARRAY_SIZE], capacity);
+
+    u8 *raw = (u8 *)*arr - offset;
+    raw = (u8 *)memory_realloc(raw, darray_allocation_size(capacity, stride),
+                               MEMORY_TAG_ENGINE);
+    if (!raw) return false;
+
+    // realloc only keeps the alignment of malloc, move the elements back
+    u8 *data = darray_align(raw);
+    if ((u64)(data - raw) != offset)
+        memmove(data - HEADER_SIZE, raw + offset - HEADER_SIZE,
+                HEADER_SIZE + (size * stride));
+
+    p = darray_header(data);
+    p[DARRAY_CAPACITY] = capacity;
+    p[DARRAY_SIZE] = size;
+    p[DARRAY_OFFSET] = data - raw;
 
-    u64 *p = (u64 *)ptr;
+    *arr = data;
 
-    p = (u64 *)realloc(p, (capacity * p[DARRAY_STRIDE]) + HEADER_SIZE);
-    if (!p) return false;
+    return true;
+}
 
-    p[DARRAY_CAPACITY] = capacity;
+/**
+ * @brief Grow the array geometrically until it can hold the given number of
+ * elements.
+ *
+ * @param arr Pointer to the array
+ * @param needed Number of elements
+ *
+ * @return True on success else false.
+ */
+static bool darray_grow(void **arr, u64 needed) {
+    u64 capacity = darray_header(*arr)[DARRAY_CAPACITY];
+    if (capacity >= needed) return true;
 
-    ptr = (u64)p;
-    ptr += HEADER_SIZE;
+    capacity *= DARRAY_GROWTH_FACTOR;
+    capacity = MAX(capacity, needed);
+    capacity = MAX(capacity, DARRAY_DEFAULT_CAPACITY);
 
-    *arr = (void *)ptr;
+    return impl_darray_resize(arr, capacity);
+}
 
-    return true;
+/**
+ * @brief Make sure the array can hold the given number of elements.
+ *
+ * @param arr Pointer to the array
+ * @param capacity The minimum capacity
+ *
+ * @return True on success else false.
+ */
+bool impl_darray_reserve(void **arr, u64 capacity) {
+    if (darray_header(*arr)[DARRAY_CAPACITY] >= capacity) return true;
+    return impl_darray_resize(arr, capacity);
+}
+
+/**
+ * @brief Release the unused capacity of the array.
+ *
+ * @param arr Pointer to the array
+ *
+ * @return True on success else false.
+ */
+bool impl_darray_shrink_to_fit(void **arr) {
+    u64 *p = darray_header(*arr);
+    if (p[DARRAY_CAPACITY] == p[DARRAY_SIZE]) return true;
+    return impl_darray_resize(arr, p[DARRAY_SIZE]);
 }
 
 /**
@@ -101,8 +174,7 @@ bool impl_darray_push(void **arr, void *element) {
     u64 *p = (u64 *)ptr;
 
     if (p[DARRAY_CAPACITY] <= p[DARRAY_SIZE]) {
-        if (!darray_resize(arr, p[DARRAY_CAPACITY] + DARRAY_RESIZE_FACTOR))
-            return false;
+        if (!darray_grow(arr, p[DARRAY_SIZE] + 1)) return false;
 
         ptr = (u64)(*arr);
         ptr -= HEADER_SIZE;
@@ -116,6 +188,30 @@ bool impl_darray_push(void **arr, void *element) {
     return true;
 }
 
+/**
+ * @brief Push count elements to the end of the array.
+ *
+ * Grows the array at most once.
+ *
+ * @param arr Pointer to the array
+ * @param elements Pointer to the first element to insert
+ * @param count Number of elements
+ *
+ * @return True on success else fail.
+ */
+bool impl_darray_push_n(void **arr, const void *elements, u64 count) {
+    if (!count) return true;
+    if (!darray_grow(arr, darray_header(*arr)[DARRAY_SIZE] + count))
+        return false;
+
+    u64 *p = darray_header(*arr);
+    void *dest = ((u8 *)*arr) + (p[DARRAY_SIZE] * p[DARRAY_STRIDE]);
+    memcpy(dest, elements, count * p[DARRAY_STRIDE]);
+    p[DARRAY_SIZE] += count;
+
+    return true;
+}
+
 /**
  * @brief Pop the element at the end of the array.
  *
@@ -161,7 +257,7 @@ bool impl_darray_push_at(void **arr, u64 index, void *element) {
     if (index > p[DARRAY_SIZE]) {
         // No need to move any elements, just put the given element
         if (p[DARRAY_CAPACITY] <= index + 1) {
-            if (!darray_resize(arr, index + 1)) return false;
+            if (!darray_grow(arr, index + 1)) return false;
 
             ptr = (u64)(*arr);
             ptr -= HEADER_SIZE;
@@ -183,7 +279,7 @@ bool impl_darray_push_at(void **arr, u64 index, void *element) {
     }
 
     if (p[DARRAY_CAPACITY] <= p[DARRAY_SIZE]) {
-        if (!darray_resize(arr, index + 1)) return false;
+        if (!darray_grow(arr, p[DARRAY_SIZE] + 1)) return false;
 
         ptr = (u64)(*arr);
         ptr -= HEADER_SIZE;
@@ -234,6 +330,33 @@ bool impl_darray_pop_at(void **arr, u64 index, void *element) {
     return true;
 }
 
+/**
+ * @brief Removes the element at the given index, the last element takes its
+ * place.
+ *
+ * @param arr Pointer to the array
+ * @param index The index to remove the element from
+ * @param element Pointer to store the removed element (can be NULL)
+ *
+ * @return Returns true on success, else false.
+ */
+bool impl_darray_swap_remove(void **arr, u64 index, void *element) {
+    u64 *p = darray_header(*arr);
+
+    assert(index < p[DARRAY_SIZE]);
+
+    u64 last = p[DARRAY_SIZE] - 1;
+    void *dest = ((u8 *)*arr) + (index * p[DARRAY_STRIDE]);
+    void *src = ((u8 *)*arr) + (last * p[DARRAY_STRIDE]);
+
+    if (element) memcpy(element, dest, p[DARRAY_STRIDE]);
+    if (index != last) memcpy(dest, src, p[DARRAY_STRIDE]);
+
+    --p[DARRAY_SIZE];
+
+    return true;
+}
+
 /**
  * @brief Clear the darray.
  *
@@ -249,3 +372,17 @@ void impl_darray_clear(void *arr) {
     u64 *p = (u64 *)ptr;
     p[DARRAY_SIZE] = 0;
 }
+
+/**
+ * @brief Drop the elements from the given size to the end of the array.
+ *
+ * @param arr The array
+ * @param size The new size
+ */
+void impl_darray_truncate(void *arr, u64 size) {
+    u64 ptr = (u64)arr;
+    ptr -= HEADER_SIZE;
+
+    u64 *p = (u64 *)ptr;
+    if (size < p[DARRAY_SIZE]) p[DARRAY_SIZE] = size;
+}
@@ -1,40 +1,58 @@
 #pragma once
 
 #include "defines.h"
+#include "memory.h"
 
 #ifndef DARRAY_DEFAULT_CAPACITY
     #define DARRAY_DEFAULT_CAPACITY 3
 #endif
 
-#ifndef DARRAY_RESIZE_FACTOR
-    #define DARRAY_RESIZE_FACTOR 3
+// The capacity is multiplied by this when a push needs more room
+#ifndef DARRAY_GROWTH_FACTOR
+    #define DARRAY_GROWTH_FACTOR 2
+#endif
+
+// Alignment of the first element, enough for any SIMD load
+#ifndef DARRAY_ALIGNMENT
+    #define DARRAY_ALIGNMENT 64
 #endif
 
 typedef enum DArrayHeaderField {
     DARRAY_CAPACITY,
     DARRAY_SIZE,
     DARRAY_STRIDE,
+    DARRAY_OFFSET,  // From the start of the allocation to the first element
     DARRAY_MAX_FIELDS
 } DArrayHeaderField;
 
-void *impl_darray_create(u64 capacity, u64 stride);
+void *impl_darray_create(u64 capacity, u64 stride, MemoryTag tag);
 
 void impl_darray_destroy(void *arr);
 
 bool impl_darray_resize(void **arr, u64 capacity);
 
+bool impl_darray_reserve(void **arr, u64 capacity);
+
 u64 impl_darray_get_header_field(void *arr, DArrayHeaderField field);
 
 bool impl_darray_push(void **arr, void *element);
 
+bool impl_darray_push_n(void **arr, const void *elements, u64 count);
+
 bool impl_darray_pop(void **arr, void *element);
 
 bool impl_darray_push_at(void **arr, u64 index, void *element);
 
 bool impl_darray_pop_at(void **arr, u64 index, void *element);
 
+bool impl_darray_swap_remove(void **arr, u64 index, void *element);
+
+bool impl_darray_shrink_to_fit(void **arr);
+
 void impl_darray_clear(void *arr);
 
+void impl_darray_truncate(void *arr, u64 size);
+
 /**
  * @brief Create darray with given type and capacity.
  *
@@ -44,7 +62,8 @@ void impl_darray_clear(void *arr);
  * @return The array or NULL on failure.
  */
 #define darray_create_with_capacity(capacity, type) \
-    (type *)impl_darray_create(capacity, sizeof(type))
+    (type *)impl_darray_create(capacity, sizeof(type), MEMORY_TAG_ENGINE)
+
 
 /**
  * @brief Create a darray of given type.
@@ -56,6 +75,19 @@ void impl_darray_clear(void *arr);
 #define darray_create(type) \
     darray_create_with_capacity(DARRAY_DEFAULT_CAPACITY, type)
 
+/**
+ * @brief Create a darray of given type, counted under the memory tag.
+ *
+ * Arrays made by the other create macros are counted as MEMORY_TAG_ENGINE.
+ *
+ * @param type Type of the elements of the array
+ * @param tag Memory tag the array is counted under
+ *
+ * @return The array or NULL on failure.
+ */
+#define darray_create_tagged(type, tag) \
+    (type *)impl_darray_create(DARRAY_DEFAULT_CAPACITY, sizeof(type), tag)
+
 /**
  * @brief Destroy the darray.
  *
@@ -74,6 +106,29 @@ void impl_darray_clear(void *arr);
 #define darray_resize(parr, capacity) \
     impl_darray_resize((void **)parr, capacity)
 
+/**
+ * @brief Make room for at least the given number of elements.
+ *
+ * Does nothing if the capacity is already large enough, so pushes up to the
+ * capacity do not move the array.
+ *
+ * @param parr Pointer to the array
+ * @param capacity The minimum capacity (number of elements)
+ *
+ * @return Returns true on success else false.
+ */
+#define darray_reserve(parr, capacity) \
+    impl_darray_reserve((void **)parr, capacity)
+
+/**
+ * @brief Release the capacity that is not used by any element.
+ *
+ * @param parr Pointer to the array
+ *
+ * @return Returns true on success else false.
+ */
+#define darray_shrink_to_fit(parr) impl_darray_shrink_to_fit((void **)parr)
+
 /**
  * @brief Get the size of the darray (number of elements).
  *
@@ -103,6 +158,16 @@ void impl_darray_clear(void *arr);
  */
 #define darray_clear(arr) impl_darray_clear(arr)
 
+/**
+ * @brief Drop the elements from the given size to the end of the array.
+ *
+ * Does nothing if the array is not larger than the size.
+ *
+ * @param arr The array
+ * @param size The new size
+ */
+#define darray_truncate(arr, size) impl_darray_truncate(arr, size)
+
 /**
  * @brief Push the given element to the end of the array.
  *
@@ -115,6 +180,18 @@ void impl_darray_clear(void *arr);
 #define darray_push(parr, element) \
     impl_darray_push((void **)parr, (__typeof__(element)[]){element})
 
+/**
+ * @brief Push count elements to the end of the array with a single copy.
+ *
+ * @param parr Pointer to the array
+ * @param elements Pointer to the first element
+ * @param count Number of elements
+ *
+ * @return Returns true on success, else false.
+ */
+#define darray_push_n(parr, elements, count) \
+    impl_darray_push_n((void **)parr, elements, count)
+
 /**
  * @brief Pop the element from the end of the array.
  *
@@ -148,3 +225,17 @@ void impl_darray_clear(void *arr);
  */
 #define darray_pop_at(parr, index, element) \
     impl_darray_pop_at((void **)parr, index, element)
+
+/**
+ * @brief Remove the element at given index by moving the last one into it.
+ *
+ * Unlike darray_pop_at this does not keep the order of the elements.
+ *
+ * @param parr Pointer to the array
+ * @param index Index to remove the element from
+ * @param element Pointer to store the removed element (can be NULL)
+ *
+ * @return Returns true on success, else false.
+ */
+#define darray_swap_remove(parr, index, element) \
+    impl_darray_swap_remove((void **)parr, index, element)
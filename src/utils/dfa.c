@@ -35,7 +35,7 @@ DfaState is_dfa_valid(Node *nodes, TLine *tlines, const char *alphabet) {
     u64 tlines_length = darray_get_size(tlines);
 
     for (u64 i = 0; i < tlines_length; ++i)
-        if (!all_chars_present(alphabet, tlines[i].inputs))
+        if (!all_chars_present(alphabet, small_string_get(&tlines[i].inputs)))
             return DFA_STATE_INPUT_INVALID;
 
     for (u64 i = 0; i < nodes_length; ++i) {
@@ -44,9 +44,10 @@ DfaState is_dfa_valid(Node *nodes, TLine *tlines, const char *alphabet) {
         u32 buf[128] = {0};
         for (u64 j = 0; j < tlines_length; ++j) {
             if (tlines[j].start == &nodes[i]) {
-                for (u64 k = 0; k < tlines[j].len; ++k) {
-                    buf[(int)tlines[j].inputs[k]]++;
-                    if (buf[(int)tlines[j].inputs[k]] > 1)
+                const char *inputs = small_string_get(&tlines[j].inputs);
+                for (u64 k = 0; k < tlines[j].inputs.len; ++k) {
+                    buf[(int)inputs[k]]++;
+                    if (buf[(int)inputs[k]] > 1)
                         return DFA_STATE_MULTIPLE_TRANSITIONS_DEFINED;
                 }
             }
@@ -80,9 +81,20 @@ Node *dfa_transition(Node *current_state, TLine *tlines, u64 tlines_length,
     char input_str[2] = {input, 0};
     for (u64 i = 0; i < tlines_length; ++i) {
         if (tlines[i].start == current_state
-            && all_chars_present(tlines[i].inputs, input_str))
+            && all_chars_present(small_string_get(&tlines[i].inputs),
+                                 input_str))
             return tlines[i].end;
     }
 
     return NULL;
 }
+
+Node *dfa_run(Node *initial_state, TLine *tlines, const char *input,
+              u64 len) {
+    u64 tlines_length = darray_get_size(tlines);
+    Node *state = initial_state;
+    for (u64 i = 0; i < len && state; ++i)
+        state = dfa_transition(state, tlines, tlines_length, input[i]);
+
+    return state;
+}
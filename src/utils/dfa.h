@@ -18,4 +18,8 @@ typedef enum DfaState {
 Node *dfa_transition(Node *current_state, TLine *tlines, u64 tlines_length,
                      char input);
 
+// Final state after consuming the whole input, NULL if a transition is missing
+Node *dfa_run(Node *initial_state, TLine *tlines, const char *input,
+              u64 len);
+
 DfaState is_dfa_valid(Node *nodes, TLine *tlines, const char *alphabet);
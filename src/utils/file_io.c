@@ -0,0 +1,196 @@
+#include "file_io.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "memory.h"
+
+#if defined(_WIN32)
+// windows.h must stay out of files that include raylib.h
+#define WIN32_LEAN_AND_MEAN
+#include <io.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__APPLE__)
+#define FILE_MODIFIED_TIME(st) ((st).st_mtimespec)
+#elif !defined(_WIN32)
+#define FILE_MODIFIED_TIME(st) ((st).st_mtim)
+#endif
+
+bool mapped_file_open(MappedFile *mf, const char *file_name) {
+    mf->data = NULL;
+    mf->size = 0;
+    mf->mapping = NULL;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    mf->size = size.QuadPart;
+    if (!mf->size) {
+        CloseHandle(file);
+        return true;
+    }
+
+    // The mapping keeps the file open
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    mf->data = (const u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mf->data) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mf->mapping = mapping;
+#else
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0) {
+        close(fd);
+        return false;
+    }
+    mf->size = st.st_size;
+    if (!mf->size) {
+        close(fd);
+        return true;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void *data = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    // Loading reads everything front to back
+    madvise(data, mf->size, MADV_SEQUENTIAL);
+    mf->data = (const u8 *)data;
+#endif
+
+    return true;
+}
+
+void mapped_file_close(MappedFile *mf) {
+    if (mf->data) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mf->data);
+        CloseHandle((HANDLE)mf->mapping);
+#else
+        munmap((void *)mf->data, mf->size);
+#endif
+    }
+
+    mf->data = NULL;
+    mf->size = 0;
+    mf->mapping = NULL;
+}
+
+FileStamp file_get_stamp(const char *file_name) {
+    FileStamp stamp = {0};
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(file_name, GetFileExInfoStandard, &data))
+        return stamp;
+    stamp.modified = ((u64)data.ftLastWriteTime.dwHighDateTime << 32)
+                   | data.ftLastWriteTime.dwLowDateTime;
+    stamp.size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+    struct stat st;
+    if (stat(file_name, &st) != 0) return stamp;
+    struct timespec modified = FILE_MODIFIED_TIME(st);
+    stamp.modified = (u64)modified.tv_sec * 1000000000 + modified.tv_nsec;
+    stamp.size = st.st_size;
+    stamp.id = st.st_ino;
+#endif
+    stamp.exists = true;
+    return stamp;
+}
+
+bool file_stamp_equal(FileStamp a, FileStamp b) {
+    return a.exists == b.exists && a.modified == b.modified
+        && a.size == b.size && a.id == b.id;
+}
+
+bool file_sync(FILE *file) {
+    if (fflush(file) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool file_write_atomic(const char *file_name, const void *data, u64 size) {
+    static const char suffix[] = ".tmp";
+    u64 len = strlen(file_name);
+    char *temp_name =
+        (char *)memory_alloc(len + sizeof(suffix), MEMORY_TAG_STRINGS);
+    if (!temp_name) return false;
+    memcpy(temp_name, file_name, len);
+    memcpy(temp_name + len, suffix, sizeof(suffix));
+
+    bool written = false;
+    FILE *file = fopen(temp_name, "wb");
+    if (file) {
+        written = fwrite(data, 1, size, file) == size && file_sync(file);
+        if (fclose(file) != 0) written = false;
+    }
+
+#if defined(_WIN32)
+    // rename() does not replace existing files on Windows
+    if (written)
+        written = MoveFileExA(temp_name, file_name,
+                              MOVEFILE_REPLACE_EXISTING
+                                  | MOVEFILE_WRITE_THROUGH);
+#else
+    if (written) written = rename(temp_name, file_name) == 0;
+#endif
+
+    if (!written) remove(temp_name);
+    memory_free(temp_name);
+    return written;
+}
+
+static bool file_make_one_directory(const char *path) {
+#if defined(_WIN32)
+    return CreateDirectoryA(path, NULL)
+        || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+bool file_make_directory(const char *path) {
+    u64 len = strlen(path);
+    char *partial = (char *)memory_alloc(len + 1, MEMORY_TAG_STRINGS);
+    if (!partial) return false;
+    memcpy(partial, path, len + 1);
+
+    // Every parent is made in turn, the root and drive letters already exist
+    bool made = true;
+    for (u64 i = 1; i < len && made; ++i) {
+        if (partial[i] != '/' && partial[i] != '\\') continue;
+        if (partial[i - 1] == ':' || partial[i - 1] == '/') continue;
+        partial[i] = 0;
+        made = file_make_one_directory(partial);
+        partial[i] = path[i];
+    }
+    if (made) made = file_make_one_directory(path);
+
+    memory_free(partial);
+    return made;
+}
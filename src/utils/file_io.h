@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "defines.h"
+
+// Read only view of a whole file, the pages are loaded on first access
+typedef struct MappedFile {
+        const u8 *data;  // NULL for empty files
+        u64 size;
+        void *mapping;  // Mapping handle on Windows
+} MappedFile;
+
+bool mapped_file_open(MappedFile *mf, const char *file_name);
+
+void mapped_file_close(MappedFile *mf);
+
+// Tells versions of a file apart without reading it
+typedef struct FileStamp {
+        u64 modified;  // Nanoseconds on POSIX, 100 nanosecond ticks on Windows
+        u64 size;
+        u64 id;  // Inode on POSIX, a rename over the file changes it
+        bool exists;
+} FileStamp;
+
+FileStamp file_get_stamp(const char *file_name);
+
+bool file_stamp_equal(FileStamp a, FileStamp b);
+
+// Flushes the file and makes sure the data is on the disk
+bool file_sync(FILE *file);
+
+// Writes the data to a temporary file next to the target and renames it over
+// the target, so the target is either the old or the complete new file
+bool file_write_atomic(const char *file_name, const void *data, u64 size);
+
+// Creates the directory and its missing parents, existing ones are fine
+bool file_make_directory(const char *path);
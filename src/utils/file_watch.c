@@ -0,0 +1,267 @@
+#include "file_watch.h"
+
+#include <raylib.h>
+#include <string.h>
+
+#include "memory.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Large enough for a few events with the longest name
+#define FILE_WATCH_EVENT_BUFFER_SIZE 4096
+
+#if defined(__linux__)
+static const char *file_watch_base_name(const char *file_name) {
+    const char *slash = strrchr(file_name, '/');
+    return slash ? slash + 1 : file_name;
+}
+
+// Written files are reported once they are closed or renamed into place
+static bool file_watch_start_inotify(FileWatch *fw) {
+    fw->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fw->fd < 0) return false;
+
+    const char *base_name = file_watch_base_name(fw->file_name);
+    u64 len = base_name - fw->file_name;
+    char *directory = (char *)memory_alloc(len + 2, MEMORY_TAG_STRINGS);
+    if (directory) {
+        if (len) memcpy(directory, fw->file_name, len);
+        else directory[len++] = '.';
+        directory[len] = 0;
+
+        fw->wd = inotify_add_watch(fw->fd, directory,
+                                   IN_CLOSE_WRITE | IN_MOVED_TO
+                                       | IN_DELETE_SELF | IN_MOVE_SELF);
+        memory_free(directory);
+        if (fw->wd >= 0) return true;
+    }
+
+    close(fw->fd);
+    fw->fd = -1;
+    return false;
+}
+
+// True when one of the events is about the file
+static bool file_watch_read_events(FileWatch *fw) {
+    const char *base_name = file_watch_base_name(fw->file_name);
+    _Alignas(struct inotify_event) char buffer[FILE_WATCH_EVENT_BUFFER_SIZE];
+
+    bool changed = false;
+    bool lost = false;
+    for (;;) {
+        ssize_t size = read(fw->fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            if (size < 0 && errno == EINTR) continue;
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + size;) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            // The directory went away or moved, its path no longer leads to
+            // the file. Dropped events might have been about the file
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+                lost = true;
+            if (event->mask & IN_Q_OVERFLOW) changed = true;
+            else if (event->len && !strcmp(event->name, base_name))
+                changed = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (lost) {
+        TraceLog(LOG_WARNING, "%s: Lost the inotify watch, polling the file",
+                 fw->file_name);
+        close(fw->fd);
+        fw->fd = -1;
+        fw->wd = -1;
+        changed = true;
+    }
+
+    return changed;
+}
+
+// Blocks until inotify has events or the watch is stopped
+static void file_watch_wait_inotify(FileWatch *fw) {
+    struct pollfd fds[2] = {
+        {.fd = fw->fd, .events = POLLIN},
+        {.fd = fw->stop_pipe[0], .events = POLLIN},
+    };
+    if (poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) return;
+        // Waiting again would fail the same way
+        TraceLog(LOG_WARNING, "%s: Cannot wait for inotify, polling the file",
+                 fw->file_name);
+        close(fw->fd);
+        fw->fd = -1;
+        return;
+    }
+
+    if ((fds[0].revents & POLLIN) && file_watch_read_events(fw)) {
+        sync_store_u64(&fw->changed, 1);
+        fw->wake();
+    }
+}
+#endif
+
+// Runs until the watch is stopped, so the loop can wait for input between
+// two changes of the file
+static void file_watch_run(void *arg) {
+    FileWatch *fw = (FileWatch *)arg;
+
+    while (!sync_load_u64(&fw->stopping)) {
+#if defined(__linux__)
+        if (fw->fd >= 0) {
+            file_watch_wait_inotify(fw);
+            continue;
+        }
+#endif
+
+        mutex_lock(&fw->mutex);
+        if (!sync_load_u64(&fw->stopping))
+            cond_wait_timeout(&fw->cond, &fw->mutex, FILE_WATCH_POLL_INTERVAL);
+        mutex_unlock(&fw->mutex);
+        if (sync_load_u64(&fw->stopping)) break;
+
+        // A file that is still being written changes between two polls
+        FileStamp stamp = file_get_stamp(fw->file_name);
+        bool settled = file_stamp_equal(stamp, fw->polled);
+        fw->polled = stamp;
+        if (!settled || file_stamp_equal(stamp, fw->reported)) continue;
+
+        fw->reported = stamp;
+        sync_store_u64(&fw->changed, 1);
+        fw->wake();
+    }
+}
+
+// Without a thread the watch is polled on the frames instead
+static void file_watch_start_thread(FileWatch *fw) {
+#if defined(__linux__)
+    if (fw->fd >= 0 && pipe(fw->stop_pipe) != 0) {
+        fw->stop_pipe[0] = fw->stop_pipe[1] = -1;
+        return;
+    }
+#endif
+
+    if (mutex_create(&fw->mutex) && cond_create(&fw->cond)
+        && thread_create(&fw->thread, file_watch_run, fw))
+        return;
+
+    TraceLog(LOG_WARNING, "%s: No watch thread, frames keep running",
+             fw->file_name);
+    mutex_destroy(&fw->mutex);
+    cond_destroy(&fw->cond);
+}
+
+bool file_watch_start(FileWatch *fw, const char *file_name,
+                      FileWatchWake wake) {
+    u64 len = strlen(file_name);
+    fw->file_name = (char *)memory_alloc(len + 1, MEMORY_TAG_STRINGS);
+    if (!fw->file_name) return false;
+    memcpy(fw->file_name, file_name, len + 1);
+
+    fw->stamp = fw->polled = fw->reported = file_get_stamp(file_name);
+    fw->next_poll = GetTime() + FILE_WATCH_POLL_INTERVAL;
+    fw->fd = -1;
+    fw->wd = -1;
+    fw->stop_pipe[0] = fw->stop_pipe[1] = -1;
+    fw->wake = wake;
+    fw->thread = (Thread){0};
+    fw->mutex = (Mutex){0};
+    fw->cond = (Cond){0};
+    fw->changed = 0;
+    fw->stopping = 0;
+
+#if defined(__linux__)
+    if (!file_watch_start_inotify(fw))
+        TraceLog(LOG_WARNING, "%s: No inotify watch, polling the file",
+                 file_name);
+#endif
+
+    if (wake) file_watch_start_thread(fw);
+
+    return true;
+}
+
+void file_watch_stop(FileWatch *fw) {
+    if (!fw->file_name) return;
+
+    if (fw->thread.running) {
+        sync_store_u64(&fw->stopping, 1);
+        mutex_lock(&fw->mutex);
+        cond_broadcast(&fw->cond);
+        mutex_unlock(&fw->mutex);
+#if defined(__linux__)
+        char byte = 0;
+        if (fw->stop_pipe[1] >= 0)
+            UNUSED(write(fw->stop_pipe[1], &byte, 1));
+#endif
+        thread_join(&fw->thread);
+    }
+    mutex_destroy(&fw->mutex);
+    cond_destroy(&fw->cond);
+
+#if defined(__linux__)
+    if (fw->fd >= 0) close(fw->fd);
+    if (fw->stop_pipe[0] >= 0) close(fw->stop_pipe[0]);
+    if (fw->stop_pipe[1] >= 0) close(fw->stop_pipe[1]);
+    fw->stop_pipe[0] = fw->stop_pipe[1] = -1;
+#endif
+    fw->fd = -1;
+    fw->wd = -1;
+    memory_free(fw->file_name);
+    fw->file_name = NULL;
+}
+
+bool file_watch_is_active(FileWatch *fw) {
+    return fw->file_name != NULL;
+}
+
+bool file_watch_needs_polling(FileWatch *fw) {
+    return fw->file_name && !fw->thread.running;
+}
+
+bool file_watch_poll(FileWatch *fw) {
+    if (!fw->file_name) return false;
+
+    FileStamp stamp;
+    if (fw->thread.running) {
+        // The thread has already waited for the file to settle
+        if (!sync_cas_u64(&fw->changed, 1, 0)) return false;
+        stamp = file_get_stamp(fw->file_name);
+    }
+#if defined(__linux__)
+    else if (fw->fd >= 0) {
+        if (!file_watch_read_events(fw)) return false;
+        stamp = file_get_stamp(fw->file_name);
+    }
+#endif
+    else {
+        // A file that is still being written changes between two polls
+        double now = GetTime();
+        if (now < fw->next_poll) return false;
+        fw->next_poll = now + FILE_WATCH_POLL_INTERVAL;
+
+        stamp = file_get_stamp(fw->file_name);
+        bool settled = file_stamp_equal(stamp, fw->polled);
+        fw->polled = stamp;
+        if (!settled) return false;
+    }
+
+    // Deleted files are left alone, the next version is reported instead
+    if (!stamp.exists || file_stamp_equal(stamp, fw->stamp)) return false;
+    fw->stamp = stamp;
+    return true;
+}
+
+void file_watch_sync(FileWatch *fw) {
+    if (!fw->file_name) return;
+    // The thread owns the polled stamp while it runs
+    fw->stamp = file_get_stamp(fw->file_name);
+    if (!fw->thread.running) fw->polled = fw->stamp;
+}
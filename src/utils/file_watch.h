@@ -0,0 +1,53 @@
+#pragma once
+
+#include "defines.h"
+#include "file_io.h"
+#include "thread.h"
+
+// Seconds between two looks at the file when there is no inotify
+#define FILE_WATCH_POLL_INTERVAL 0.5
+
+// Called from the watch thread once a change is ready to be polled, it has to
+// be safe to call from any thread
+typedef void (*FileWatchWake)(void);
+
+// Notices when a file is changed by someone else. On Linux the directory is
+// watched with inotify, so files replaced by a rename are followed too.
+// Elsewhere, or when inotify is out of watches, the file is polled.
+// With a wake function both are done on a thread of the watch, which calls
+// it for every change, so the frames do not have to keep running
+typedef struct FileWatch {
+        char *file_name;
+        FileStamp stamp;  // Of the version that was last read or written
+        FileStamp polled;  // Polled changes are reported once this settles
+        FileStamp reported;  // Last settled version seen by the thread
+        double next_poll;
+        i32 fd;  // Inotify instance, -1 while polling
+        i32 wd;
+        i32 stop_pipe[2];  // Interrupts the thread waiting for inotify
+        FileWatchWake wake;
+        Thread thread;
+        Mutex mutex;
+        Cond cond;  // Interrupts the thread waiting between two polls
+        volatile u64 changed;  // Set by the thread, taken by file_watch_poll
+        volatile u64 stopping;
+} FileWatch;
+
+// The wake function may be NULL, the file is then only looked at while
+// polling
+bool file_watch_start(FileWatch *fw, const char *file_name,
+                      FileWatchWake wake);
+
+void file_watch_stop(FileWatch *fw);
+
+bool file_watch_is_active(FileWatch *fw);
+
+// Changes are only noticed when file_watch_poll runs, so frames have to keep
+// running. False while a thread wakes the loop instead
+bool file_watch_needs_polling(FileWatch *fw);
+
+// True once for every version of the file that differs from the stamp
+bool file_watch_poll(FileWatch *fw);
+
+// The file as it is now was written by us, it is not reported
+void file_watch_sync(FileWatch *fw);
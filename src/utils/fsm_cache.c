@@ -0,0 +1,155 @@
+#include "fsm_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "file_io.h"
+#include "hash.h"
+#include "memory.h"
+#include "table.h"
+
+#define FSM_CACHE_PATH_SIZE 1024
+#define FSM_CACHE_ALIGN(size) (((size) + 7) & ~(u64)7)
+
+static u64 fsm_cache_hash_u32(u64 hash, u32 value) {
+    return fnv1a_64(hash, &value, sizeof(value));
+}
+
+u64 fsm_cache_hash(GlobalState *gs) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    u64 tlines_length = darray_get_size(gs->tlines);
+
+    u64 hash = FNV1A_64_OFFSET;
+    hash = fsm_cache_hash_u32(hash, FSM_CACHE_VERSION);
+    hash = fsm_cache_hash_u32(hash, gs->alphabet_len);
+    if (gs->alphabet_len)
+        hash = fnv1a_64(hash, gs->alphabet, gs->alphabet_len);
+
+    hash = fsm_cache_hash_u32(hash, nodes_length);
+    for (u64 i = 0; i < nodes_length; ++i) {
+        u8 flags = (gs->nodes[i].initial_state ? FSM_STATE_INITIAL : 0)
+                 | (gs->nodes[i].accepting_state ? FSM_STATE_ACCEPTING : 0);
+        hash = fnv1a_64(hash, &flags, sizeof(flags));
+    }
+
+    // Endpoints outside of the nodes are hashed like the table sees them
+    hash = fsm_cache_hash_u32(hash, tlines_length);
+    for (u64 i = 0; i < tlines_length; ++i) {
+        TLine *tline = &gs->tlines[i];
+        u32 start = FSM_TABLE_NONE;
+        u32 end = FSM_TABLE_NONE;
+        Node *nodes_end = gs->nodes + nodes_length;
+        if (tline->start >= gs->nodes && tline->start < nodes_end)
+            start = tline->start - gs->nodes;
+        if (tline->end >= gs->nodes && tline->end < nodes_end)
+            end = tline->end - gs->nodes;
+        hash = fsm_cache_hash_u32(hash, start);
+        hash = fsm_cache_hash_u32(hash, end);
+        hash = fsm_cache_hash_u32(hash, tline->inputs.len);
+        hash = fnv1a_64(hash, small_string_get(&tline->inputs),
+                        tline->inputs.len);
+    }
+
+    return hash;
+}
+
+// The XDG cache directory, or the local application data on Windows
+static bool fsm_cache_get_directory(char *path, u64 size) {
+    const char *base;
+    const char *suffix;
+#if defined(_WIN32)
+    base = getenv("LOCALAPPDATA");
+    suffix = "\\StateFlow\\cache";
+#else
+    base = getenv("XDG_CACHE_HOME");
+    suffix = "/stateflow";
+    if (!base || !*base) {
+        base = getenv("HOME");
+        suffix = "/.cache/stateflow";
+    }
+#endif
+    if (!base || !*base) return false;
+
+    int len = snprintf(path, size, "%s%s", base, suffix);
+    return len > 0 && (u64)len < size;
+}
+
+static bool fsm_cache_get_path(char *path, u64 size, u64 hash) {
+    char directory[FSM_CACHE_PATH_SIZE];
+    if (!fsm_cache_get_directory(directory, sizeof(directory))) return false;
+
+    int len = snprintf(path, size, "%s/%016llx.table", directory,
+                       (unsigned long long)hash);
+    return len > 0 && (u64)len < size;
+}
+
+bool fsm_cache_load(GlobalState *gs, u64 hash) {
+    char path[FSM_CACHE_PATH_SIZE];
+    if (!fsm_cache_get_path(path, sizeof(path), hash)) return false;
+
+    MappedFile mf;
+    if (!mapped_file_open(&mf, path)) return false;
+
+    bool loaded = false;
+    FsmCacheHeader header;
+    u64 image_offset = FSM_CACHE_ALIGN(sizeof(header));
+    if (mf.size < image_offset) goto done;
+    memcpy(&header, mf.data, sizeof(header));
+
+    // The hash is checked again in case the file was renamed
+    if (memcmp(header.magic, FSM_CACHE_MAGIC, sizeof(header.magic))
+        || header.version != FSM_CACHE_VERSION || header.hash != hash
+        || header.state_count != darray_get_size(gs->nodes)
+        || header.tline_count != darray_get_size(gs->tlines))
+        goto done;
+
+    FsmTable view;
+    FsmTable table;
+    if (!fsm_table_view_image(&view, mf.data + image_offset,
+                              mf.size - image_offset)
+        || !fsm_table_matches(&view, gs->nodes, gs->tlines)
+        || !fsm_table_copy(&table, &view))
+        goto done;
+
+    fsm_table_destroy(&gs->table);
+    gs->table = table;
+    gs->table.version = gs->version;
+    loaded = true;
+
+done:
+    mapped_file_close(&mf);
+    return loaded;
+}
+
+bool fsm_cache_store(GlobalState *gs, u64 hash) {
+    FsmTable *ft = &gs->table;
+    if (!ft->built || ft->version != gs->version) return false;
+
+    char directory[FSM_CACHE_PATH_SIZE];
+    char path[FSM_CACHE_PATH_SIZE];
+    if (!fsm_cache_get_directory(directory, sizeof(directory))
+        || !fsm_cache_get_path(path, sizeof(path), hash)
+        || !file_make_directory(directory))
+        return false;
+
+    u64 image_offset = FSM_CACHE_ALIGN(sizeof(FsmCacheHeader));
+    u64 size = image_offset + fsm_table_image_size(ft);
+    u8 *buffer = (u8 *)memory_calloc(size, 1, MEMORY_TAG_ENGINE);
+    if (!buffer) return false;
+
+    FsmCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FSM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = FSM_CACHE_VERSION;
+    header.hash = hash;
+    header.state_count = ft->state_count;
+    header.tline_count = ft->tline_count;
+    memcpy(buffer, &header, sizeof(header));
+    fsm_table_write_image(ft, buffer + image_offset);
+
+    bool stored = file_write_atomic(path, buffer, size);
+    memory_free(buffer);
+    return stored;
+}
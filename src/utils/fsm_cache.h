@@ -0,0 +1,28 @@
+#pragma once
+
+#include "defines.h"
+#include "stateflow.h"
+
+#define FSM_CACHE_MAGIC "SFSC"
+#define FSM_CACHE_VERSION 1
+
+// A cache entry is this header followed by an FsmTableImage
+typedef struct FsmCacheHeader {
+        char magic[4];
+        u32 version;
+        u64 hash;
+        u32 state_count;
+        u32 tline_count;
+} FsmCacheHeader;
+
+// Hash of what the compiled table is made from: the alphabet, the flags of
+// the nodes and the endpoints and inputs of the tlines. Positions and names
+// are left out, moving a node does not change the hash
+u64 fsm_cache_hash(GlobalState *gs);
+
+// Copies the cached table into gs->table for the current version, false when
+// there is no entry for the hash or it does not fit the model
+bool fsm_cache_load(GlobalState *gs, u64 hash);
+
+// Stores gs->table, which must match the current version
+bool fsm_cache_store(GlobalState *gs, u64 hash);
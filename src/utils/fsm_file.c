@@ -0,0 +1,286 @@
+#include "fsm_file.h"
+
+#include <string.h>
+
+#include "darray.h"
+#include "file_io.h"
+#include "memory.h"
+#include "table.h"
+
+#define FSM_FILE_ALIGN(size) (((size) + 7) & ~(u64)7)
+// Records between progress updates and cancellation checks
+#define FSM_FILE_REPORT_INTERVAL 4096
+
+bool fsm_file_is_binary(const u8 *data, u64 size) {
+    return size >= sizeof(FsmFileHeader)
+        && !memcmp(data, FSM_FILE_MAGIC, sizeof(FSM_FILE_MAGIC) - 1);
+}
+
+static bool fsm_file_node_index(GlobalState *gs, Node *node, u32 *index) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    if (!node || node < gs->nodes || node >= gs->nodes + nodes_length)
+        return false;
+    *index = node - gs->nodes;
+    return true;
+}
+
+// Copies the text to the end of the string table and returns its offset
+static u32 fsm_file_push_string(u8 *strings, u32 *strings_len,
+                                const char *text, u32 len) {
+    u32 offset = *strings_len;
+    memcpy(strings + offset, text, len);
+    *strings_len += len;
+    return offset;
+}
+
+bool fsm_file_store(GlobalState *gs, const char *file_name, Job *job) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    u64 tlines_length = darray_get_size(gs->tlines);
+    if (nodes_length >= UINT32_MAX || tlines_length >= UINT32_MAX)
+        return false;
+
+    bool stored = false;
+    u8 *buffer = NULL;
+    TLine *sorted = NULL;
+    FsmTable table;
+    fsm_table_create(&table);
+    u32 *rows = (u32 *)memory_calloc(nodes_length + 1, sizeof(u32),
+                                     MEMORY_TAG_ENGINE);
+    u32 *starts = (u32 *)memory_alloc(CLAMP_MIN(tlines_length, 1) * sizeof(u32),
+                                      MEMORY_TAG_ENGINE);
+    if (!rows || !starts) goto done;
+
+    u64 strings_size = gs->alphabet_len;
+    for (u64 i = 0; i < nodes_length; ++i)
+        strings_size += gs->nodes[i].name.len;
+
+    // Counting sort by start node, rows[i + 1] counts the tlines of node i
+    for (u64 i = 0; i < tlines_length; ++i) {
+        if (!fsm_file_node_index(gs, gs->tlines[i].start, &starts[i]))
+            goto done;
+        rows[starts[i] + 1]++;
+        strings_size += gs->tlines[i].inputs.len;
+    }
+    if (strings_size > UINT32_MAX) goto done;
+    for (u64 i = 0; i < nodes_length; ++i) rows[i + 1] += rows[i];
+
+    // Placing the tlines of node i moves rows[i] to where the next node
+    // starts, so afterwards the rows are shifted back by one
+    sorted = darray_create_with_capacity(CLAMP_MIN(tlines_length, 1), TLine);
+    if (!sorted) goto done;
+    darray_push_n(&sorted, gs->tlines, tlines_length);
+    for (u64 i = 0; i < tlines_length; ++i)
+        sorted[rows[starts[i]]++] = gs->tlines[i];
+    memmove(rows + 1, rows, nodes_length * sizeof(u32));
+    rows[0] = 0;
+
+    // The table is compiled for the sorted tlines, so its indices match
+    if (!fsm_table_rebuild(&table, gs->nodes, sorted, gs->version)) goto done;
+
+    FsmFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FSM_FILE_MAGIC, sizeof(header.magic));
+    header.version = FSM_FILE_VERSION;
+    header.fsm_type = gs->fsm_type;
+    header.alphabet_len = gs->alphabet_len;
+    header.node_count = nodes_length;
+    header.tline_count = tlines_length;
+
+    u64 sizes[FSM_FILE_SECTION_MAX] = {
+        [FSM_FILE_SECTION_STRINGS] = strings_size,
+        [FSM_FILE_SECTION_NODES] = nodes_length * sizeof(FsmFileNode),
+        [FSM_FILE_SECTION_ROWS] = (nodes_length + 1) * sizeof(u32),
+        [FSM_FILE_SECTION_TLINES] = tlines_length * sizeof(FsmFileTLine),
+        [FSM_FILE_SECTION_TABLE] = fsm_table_image_size(&table),
+    };
+    u64 offset = FSM_FILE_ALIGN(sizeof(header));
+    for (u32 i = 0; i < FSM_FILE_SECTION_MAX; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = FSM_FILE_ALIGN(offset + sizes[i]);
+    }
+
+    // Zeroed, so the padding between the sections is written as zeros
+    buffer = (u8 *)memory_calloc(offset, 1, MEMORY_TAG_ENGINE);
+    if (!buffer) goto done;
+    memcpy(buffer, &header, sizeof(header));
+
+    u8 *strings = buffer + header.sections[FSM_FILE_SECTION_STRINGS].offset;
+    u32 strings_len = 0;
+    if (gs->alphabet_len)
+        fsm_file_push_string(strings, &strings_len, gs->alphabet,
+                             gs->alphabet_len);
+
+    FsmFileNode *nodes =
+        (FsmFileNode *)(buffer
+                        + header.sections[FSM_FILE_SECTION_NODES].offset);
+    for (u64 i = 0; i < nodes_length; ++i) {
+        Node *node = &gs->nodes[i];
+        nodes[i].name_len = node->name.len;
+        nodes[i].name =
+            fsm_file_push_string(strings, &strings_len,
+                                 small_string_get(&node->name), node->name.len);
+        nodes[i].x = node->center.x;
+        nodes[i].y = node->center.y;
+        nodes[i].flags = (node->initial_state ? FSM_STATE_INITIAL : 0)
+                       | (node->accepting_state ? FSM_STATE_ACCEPTING : 0);
+    }
+
+    memcpy(buffer + header.sections[FSM_FILE_SECTION_ROWS].offset, rows,
+           sizes[FSM_FILE_SECTION_ROWS]);
+
+    FsmFileTLine *tlines =
+        (FsmFileTLine *)(buffer
+                         + header.sections[FSM_FILE_SECTION_TLINES].offset);
+    for (u64 i = 0; i < tlines_length; ++i) {
+        if (job && !(i % FSM_FILE_REPORT_INTERVAL))
+            job_set_progress_of(job, i, tlines_length);
+
+        TLine *tline = &sorted[i];
+        if (!fsm_file_node_index(gs, tline->end, &tlines[i].end)) goto done;
+        tlines[i].inputs_len = tline->inputs.len;
+        tlines[i].inputs = fsm_file_push_string(
+            strings, &strings_len, small_string_get(&tline->inputs),
+            tline->inputs.len);
+    }
+
+    fsm_table_write_image(
+        &table, buffer + header.sections[FSM_FILE_SECTION_TABLE].offset);
+
+    stored = file_write_atomic(file_name, buffer, offset);
+
+done:
+    memory_free(buffer);
+    memory_free(rows);
+    memory_free(starts);
+    darray_destroy(sorted);
+    fsm_table_destroy(&table);
+    return stored;
+}
+
+static bool fsm_file_check_string(u64 strings_size, u32 offset, u32 len) {
+    return (u64)offset + len <= strings_size;
+}
+
+bool fsm_file_load(GlobalState *gs, const u8 *data, u64 size, Job *job) {
+    if (!fsm_file_is_binary(data, size)) return false;
+
+    FsmFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != FSM_FILE_VERSION || header.fsm_type >= FSM_TYPE_MAX)
+        return false;
+
+    FsmFileSection *sections = header.sections;
+    for (u32 i = 0; i < FSM_FILE_SECTION_MAX; ++i) {
+        if (sections[i].offset % 8 || sections[i].offset > size
+            || sections[i].size > size - sections[i].offset)
+            return false;
+    }
+
+    u64 strings_size = sections[FSM_FILE_SECTION_STRINGS].size;
+    if (header.alphabet_len > strings_size
+        || sections[FSM_FILE_SECTION_NODES].size
+               != (u64)header.node_count * sizeof(FsmFileNode)
+        || sections[FSM_FILE_SECTION_ROWS].size
+               != ((u64)header.node_count + 1) * sizeof(u32)
+        || sections[FSM_FILE_SECTION_TLINES].size
+               != (u64)header.tline_count * sizeof(FsmFileTLine))
+        return false;
+
+    const char *strings =
+        (const char *)(data + sections[FSM_FILE_SECTION_STRINGS].offset);
+    const FsmFileNode *nodes =
+        (const FsmFileNode *)(data + sections[FSM_FILE_SECTION_NODES].offset);
+    const u32 *rows =
+        (const u32 *)(data + sections[FSM_FILE_SECTION_ROWS].offset);
+    const FsmFileTLine *tlines =
+        (const FsmFileTLine *)(data
+                               + sections[FSM_FILE_SECTION_TLINES].offset);
+
+    // Everything is checked before the model is touched
+    if (rows[0] != 0 || rows[header.node_count] != header.tline_count)
+        return false;
+    for (u32 i = 0; i < header.node_count; ++i) {
+        if (rows[i] > rows[i + 1]
+            || !fsm_file_check_string(strings_size, nodes[i].name,
+                                      nodes[i].name_len))
+            return false;
+    }
+    for (u32 i = 0; i < header.tline_count; ++i) {
+        if (tlines[i].end >= header.node_count
+            || !fsm_file_check_string(strings_size, tlines[i].inputs,
+                                      tlines[i].inputs_len))
+            return false;
+    }
+
+    if (header.alphabet_len) {
+        char *new_alphabet = memory_realloc(
+            gs->alphabet, (header.alphabet_len + 1) * sizeof(char),
+            MEMORY_TAG_STRINGS);
+        if (!new_alphabet) return false;
+        memcpy(new_alphabet, strings, header.alphabet_len);
+        new_alphabet[header.alphabet_len] = 0;
+        gs->alphabet = new_alphabet;
+    }
+    gs->alphabet_len = header.alphabet_len;
+    gs->fsm_type = header.fsm_type;
+
+    // Reserved up front, so the tlines can point into the nodes right away
+    if (!darray_reserve(&gs->nodes, header.node_count)
+        || !darray_reserve(&gs->tlines, header.tline_count))
+        return false;
+
+    u64 records = (u64)header.node_count + header.tline_count;
+    for (u32 i = 0; i < header.node_count; ++i) {
+        if (job && !(i % FSM_FILE_REPORT_INTERVAL)) {
+            if (job_is_cancelled(job)) return false;
+            job_set_progress_of(job, i, records);
+        }
+
+        Node node;
+        node_create(&node, (Vector2){nodes[i].x, nodes[i].y});
+        node_set_name(&node, &gs->strings, strings + nodes[i].name,
+                      nodes[i].name_len);
+        node_set_font(&node, gs->font, 32);
+        node.editing = true;
+        node.initial_state = nodes[i].flags & FSM_STATE_INITIAL;
+        node.accepting_state = nodes[i].flags & FSM_STATE_ACCEPTING;
+        darray_push(&gs->nodes, node);
+    }
+
+    for (u32 i = 0; i < header.node_count; ++i) {
+        for (u32 j = rows[i]; j < rows[i + 1]; ++j) {
+            if (job && !(j % FSM_FILE_REPORT_INTERVAL)) {
+                if (job_is_cancelled(job)) return false;
+                job_set_progress_of(job, header.node_count + j, records);
+            }
+
+            TLine tline;
+            tline_create(&tline);
+            tline_set_start_node(&tline, &gs->nodes[i]);
+            tline_set_end_node(&tline, &gs->nodes[tlines[j].end]);
+            tline_set_inputs(&tline, &gs->strings, strings + tlines[j].inputs,
+                             tlines[j].inputs_len);
+            tline_set_font(&tline, gs->font);
+            tline.editing = true;
+            darray_push(&gs->tlines, tline);
+        }
+    }
+
+    // A table that does not fit the model is left out, the editor rebuilds it
+    FsmTable view;
+    if (sections[FSM_FILE_SECTION_TABLE].size
+        && fsm_table_view_image(&view,
+                                data + sections[FSM_FILE_SECTION_TABLE].offset,
+                                sections[FSM_FILE_SECTION_TABLE].size)
+        && fsm_table_matches(&view, gs->nodes, gs->tlines)) {
+        FsmTable table;
+        if (fsm_table_copy(&table, &view)) {
+            fsm_table_destroy(&gs->table);
+            gs->table = table;
+            gs->table.version = gs->version;
+        }
+    }
+
+    return true;
+}
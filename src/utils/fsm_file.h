@@ -0,0 +1,60 @@
+#pragma once
+
+#include "defines.h"
+#include "stateflow.h"
+#include "worker.h"
+
+#define FSM_FILE_MAGIC "SFSM"
+#define FSM_FILE_VERSION 1
+
+// Every section starts at a multiple of 8 bytes from the start of the file
+typedef enum FsmFileSectionType {
+    FSM_FILE_SECTION_STRINGS,  // The alphabet, node names and tline inputs
+    FSM_FILE_SECTION_NODES,
+    FSM_FILE_SECTION_ROWS,  // First tline of each node and the tline count
+    FSM_FILE_SECTION_TLINES,  // Sorted by start node
+    FSM_FILE_SECTION_TABLE,  // FsmTableImage of the nodes and tlines
+    FSM_FILE_SECTION_MAX
+} FsmFileSectionType;
+
+typedef struct FsmFileSection {
+        u64 offset;
+        u64 size;
+} FsmFileSection;
+
+// Values are stored in the byte order of the machine that wrote the file
+typedef struct FsmFileHeader {
+        char magic[4];
+        u32 version;
+        u32 fsm_type;
+        u32 alphabet_len;  // The string table starts with the alphabet
+        u32 node_count;
+        u32 tline_count;
+        FsmFileSection sections[FSM_FILE_SECTION_MAX];
+} FsmFileHeader;
+
+typedef struct FsmFileNode {
+        u32 name;  // Offset into the string table
+        u32 name_len;
+        float x;
+        float y;
+        u32 flags;  // FsmStateFlags
+} FsmFileNode;
+
+// The start node is given by the row the tline is in
+typedef struct FsmFileTLine {
+        u32 end;
+        u32 inputs;  // Offset into the string table
+        u32 inputs_len;
+} FsmFileTLine;
+
+// Anything without the magic is treated as the text format
+bool fsm_file_is_binary(const u8 *data, u64 size);
+
+// The job is optional and receives the progress
+bool fsm_file_store(GlobalState *gs, const char *file_name, Job *job);
+
+// Reads a mapped file into the empty model. The compiled table is copied
+// from the file, so it does not have to be rebuilt for the loaded version.
+// The optional job receives the progress and can cancel the load
+bool fsm_file_load(GlobalState *gs, const u8 *data, u64 size, Job *job);
@@ -0,0 +1,240 @@
+#include "fsm_io.h"
+
+#include <string.h>
+
+#include "file_watch.h"
+#include "funcs.h"
+#include "memory.h"
+#include "worker.h"
+
+#define FSM_IO_PROGRESS_STEPS 1000
+#define FSM_IO_BAR_HEIGHT 28
+#define FSM_IO_FONT_SIZE 20
+
+typedef enum FsmIoJobType {
+    FSM_IO_JOB_LOAD,
+    FSM_IO_JOB_SAVE,
+    FSM_IO_JOB_RELOAD,
+} FsmIoJobType;
+
+typedef struct FsmIoJob {
+        Job job;
+        GlobalState model;  // Only the automaton, the table and the font
+        char *file_name;
+        FsmIoJobType type;
+        bool succeeded;
+} FsmIoJob;
+
+static const char *job_names[] = {"Loading", "Saving", "Reloading"};
+
+static CompletionQueue completed_jobs;
+static FsmIoJob *loading = NULL;
+static FsmIoJob *saving = NULL;
+static FsmIoJob *reloading = NULL;
+static FsmIoJob *reloaded = NULL;  // Waits for the editor to apply it
+static bool loaded = false;
+static FileWatch watch;  // The file the model was read from or written to
+static FileWatchWake wake = NULL;
+
+static void fsm_io_run(Job *job) {
+    FsmIoJob *fj = (FsmIoJob *)job->data;
+
+    if (fj->type == FSM_IO_JOB_SAVE)
+        fj->succeeded = store_fsm_to_file(&fj->model, fj->file_name, job);
+    else
+        fj->succeeded = load_fsm_from_file(&fj->model, fj->file_name, job);
+
+    job_set_progress(job, job->total);
+}
+
+static FsmIoJob *fsm_io_create_job(const char *file_name, FsmIoJobType type) {
+    FsmIoJob *fj = (FsmIoJob *)memory_calloc(1, sizeof(FsmIoJob),
+                                              MEMORY_TAG_ENGINE);
+    if (!fj) return NULL;
+
+    u64 len = strlen(file_name);
+    fj->file_name = (char *)memory_alloc(len + 1, MEMORY_TAG_STRINGS);
+    if (!fj->file_name) {
+        memory_free(fj);
+        return NULL;
+    }
+    memcpy(fj->file_name, file_name, len + 1);
+    fj->type = type;
+
+    job_init(&fj->job, fsm_io_run, fj, &completed_jobs);
+    fj->job.total = FSM_IO_PROGRESS_STEPS;
+
+    return fj;
+}
+
+static void fsm_io_destroy_job(FsmIoJob *fj) {
+    destroy_fsm(&fj->model);
+    memory_free(fj->file_name);
+    memory_free(fj);
+}
+
+bool fsm_io_load(GlobalState *gs, const char *file_name) {
+    if (loading) return false;
+
+    // Changes of the previous file no longer apply
+    if (reloading) job_cancel(&reloading->job);
+    reloading = NULL;
+    fsm_io_finish_reload();
+
+    FsmIoJob *fj = fsm_io_create_job(file_name, FSM_IO_JOB_LOAD);
+    if (!fj) return false;
+    if (!create_fsm(&fj->model, gs)) {
+        fsm_io_destroy_job(fj);
+        return false;
+    }
+
+    loading = fj;
+    worker_pool_submit(&gs->workers, &fj->job);
+    return true;
+}
+
+bool fsm_io_save(GlobalState *gs, const char *file_name) {
+    if (saving) return false;
+
+    FsmIoJob *fj = fsm_io_create_job(file_name, FSM_IO_JOB_SAVE);
+    if (!fj) return false;
+    if (!copy_fsm(&fj->model, gs)) {
+        fsm_io_destroy_job(fj);
+        return false;
+    }
+
+    saving = fj;
+    worker_pool_submit(&gs->workers, &fj->job);
+    return true;
+}
+
+// Follows the file the model now lives in
+static void fsm_io_watch(const char *file_name) {
+    if (file_watch_is_active(&watch) && !strcmp(watch.file_name, file_name)) {
+        file_watch_sync(&watch);
+        return;
+    }
+
+    file_watch_stop(&watch);
+    if (!file_watch_start(&watch, file_name, wake))
+        TraceLog(LOG_WARNING, "%s: Changes will not be reloaded", file_name);
+}
+
+void fsm_io_update(GlobalState *gs) {
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        FsmIoJob *fj = (FsmIoJob *)job->data;
+
+        // Cancelled jobs were already let go of
+        if (fj == loading) {
+            loading = NULL;
+            if (fj->succeeded) {
+                replace_fsm(gs, &fj->model);
+                fsm_io_watch(fj->file_name);
+                loaded = true;
+            }
+        } else if (fj == saving) {
+            saving = NULL;
+            if (fj->succeeded) fsm_io_watch(fj->file_name);
+            else TraceLog(LOG_ERROR, "%s: Failed to save!", fj->file_name);
+        } else if (fj == reloading) {
+            reloading = NULL;
+            if (fj->succeeded) {
+                reloaded = fj;
+                continue;
+            }
+        }
+
+        fsm_io_destroy_job(fj);
+    }
+}
+
+void fsm_io_poll_watch(GlobalState *gs) {
+    // Our own saves are not changes, the stamp is taken once they are done
+    if (reloading || reloaded || saving || loading) return;
+    if (!file_watch_poll(&watch)) return;
+
+    FsmIoJob *fj = fsm_io_create_job(watch.file_name, FSM_IO_JOB_RELOAD);
+    if (!fj) return;
+    if (!create_fsm(&fj->model, gs)) {
+        fsm_io_destroy_job(fj);
+        return;
+    }
+
+    TraceLog(LOG_INFO, "%s: Changed on disk, reloading", watch.file_name);
+    reloading = fj;
+    worker_pool_submit(&gs->workers, &fj->job);
+}
+
+GlobalState *fsm_io_get_reload(void) {
+    return reloaded ? &reloaded->model : NULL;
+}
+
+void fsm_io_finish_reload(void) {
+    if (!reloaded) return;
+    fsm_io_destroy_job(reloaded);
+    reloaded = NULL;
+}
+
+bool fsm_io_take_loaded(void) {
+    bool result = loaded;
+    loaded = false;
+    return result;
+}
+
+bool fsm_io_is_loading(void) {
+    return loading != NULL;
+}
+
+bool fsm_io_is_busy(void) {
+    return loading || saving || reloading;
+}
+
+void fsm_io_set_wake(FileWatchWake wake_loop) {
+    wake = wake_loop;
+}
+
+bool fsm_io_needs_polling(void) {
+    return file_watch_needs_polling(&watch);
+}
+
+void fsm_io_draw_progress(GlobalState *gs) {
+    FsmIoJob *fj = loading ? loading : saving ? saving : reloading;
+    if (!fj) return;
+
+    float progress = job_get_progress(&fj->job);
+    float width = GetScreenWidth();
+    Rectangle bar = {0, GetScreenHeight() - FSM_IO_BAR_HEIGHT, width,
+                     FSM_IO_BAR_HEIGHT};
+
+    DrawRectangleRec(bar, Fade(BLACK, 0.7f));
+    DrawRectangleRec((Rectangle){bar.x, bar.y, width * progress, bar.height},
+                     Fade(SKYBLUE, 0.6f));
+
+    const char *text = arena_format(
+        &gs->frame, "%s %s %d%%", job_names[fj->type],
+        GetFileName(fj->file_name), (i32)(progress * 100));
+    if (!text) return;
+
+    Vector2 position = {8, bar.y + (bar.height - FSM_IO_FONT_SIZE) / 2};
+    DrawTextEx(gs->font, text, position, FSM_IO_FONT_SIZE, 1.0f, WHITE);
+}
+
+void fsm_io_cancel(void) {
+    if (loading) job_cancel(&loading->job);
+    if (reloading) job_cancel(&reloading->job);
+    loading = NULL;
+    reloading = NULL;
+}
+
+void fsm_io_shutdown(void) {
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs)))
+        fsm_io_destroy_job((FsmIoJob *)job->data);
+    fsm_io_finish_reload();
+    file_watch_stop(&watch);
+    loading = NULL;
+    saving = NULL;
+    reloading = NULL;
+    loaded = false;
+}
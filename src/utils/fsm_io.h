@@ -0,0 +1,54 @@
+#pragma once
+
+#include "defines.h"
+#include "file_watch.h"
+#include "stateflow.h"
+
+// Loads and saves run on the worker pool, one of each at a time. They work
+// on a model of their own, so frames keep running while a file is read or
+// written and the machine can still be edited during a save
+
+// The loaded model replaces the current one in fsm_io_update
+bool fsm_io_load(GlobalState *gs, const char *file_name);
+
+// Writes a copy of the current model
+bool fsm_io_save(GlobalState *gs, const char *file_name);
+
+// Takes in the finished jobs, called once per frame
+void fsm_io_update(GlobalState *gs);
+
+// The file that was last loaded or saved is watched. When someone else
+// changes it, it is read again in the background and handed out by
+// fsm_io_get_reload. Called by the screen that applies the changes
+void fsm_io_poll_watch(GlobalState *gs);
+
+// The newly read model, NULL when there is none. It is the file's version of
+// the machine and stays valid until fsm_io_finish_reload
+GlobalState *fsm_io_get_reload(void);
+
+void fsm_io_finish_reload(void);
+
+// True once after a load replaced the model
+bool fsm_io_take_loaded(void);
+
+bool fsm_io_is_loading(void);
+
+bool fsm_io_is_busy(void);
+
+// Wakes a loop that waits for input once the watched file has changed. Only
+// files watched from then on use it
+void fsm_io_set_wake(FileWatchWake wake_loop);
+
+// A file is watched for changes, which are only noticed by polling, so the
+// loop must not wait for input
+bool fsm_io_needs_polling(void);
+
+// Progress bar along the bottom of the window while a job runs
+void fsm_io_draw_progress(GlobalState *gs);
+
+// Stops running loads and reloads, the model is kept as it is. Saves are
+// finished
+void fsm_io_cancel(void);
+
+// Frees the jobs, the worker pool must be destroyed first
+void fsm_io_shutdown(void);
@@ -0,0 +1,474 @@
+#include "fsm_text.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "darray.h"
+#include "file_io.h"
+#include "memory.h"
+
+// Room for the punctuation and numbers of one record
+#define FSM_TEXT_RECORD_SIZE 96
+// Records between progress updates and cancellation checks
+#define FSM_TEXT_REPORT_INTERVAL 4096
+
+typedef struct FsmTextWriter {
+        char *data;
+        u64 size;
+        u64 capacity;
+        bool failed;  // Out of memory, everything after it is dropped
+} FsmTextWriter;
+
+typedef struct FsmTextParser {
+        const char *start;
+        const char *cursor;
+        const char *end;
+        const char *line_start;
+        u32 line;
+        FsmTextError *error;
+        Job *job;
+        u64 records;
+} FsmTextParser;
+
+static bool fsm_text_reserve(FsmTextWriter *w, u64 size) {
+    if (w->failed) return false;
+    if (w->size + size <= w->capacity) return true;
+
+    u64 capacity = MAX(w->capacity * 2, w->size + size);
+    char *data = (char *)memory_realloc(w->data, capacity, MEMORY_TAG_ENGINE);
+    if (!data) {
+        w->failed = true;
+        return false;
+    }
+    w->data = data;
+    w->capacity = capacity;
+    return true;
+}
+
+static void fsm_text_write(FsmTextWriter *w, const char *text, u64 len) {
+    if (!fsm_text_reserve(w, len)) return;
+    memcpy(w->data + w->size, text, len);
+    w->size += len;
+}
+
+#define fsm_text_write_literal(w, literal) \
+    fsm_text_write(w, literal, sizeof(literal) - 1)
+
+static void fsm_text_write_u64(FsmTextWriter *w, u64 value) {
+    char digits[20];
+    u32 count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    if (!fsm_text_reserve(w, count)) return;
+    while (count) w->data[w->size++] = digits[--count];
+}
+
+static void fsm_text_write_float(FsmTextWriter *w, float value) {
+    char text[64];
+    int len = snprintf(text, sizeof(text), "%f", value);
+    if (len > 0) fsm_text_write(w, text, MIN((u64)len, sizeof(text) - 1));
+}
+
+// Empty strings are written as NULL, the length tells them apart
+static void fsm_text_write_string(FsmTextWriter *w, const char *text,
+                                  u64 len) {
+    fsm_text_write_literal(w, "\"");
+    if (len) fsm_text_write(w, text, len);
+    else fsm_text_write_literal(w, "NULL");
+    fsm_text_write_literal(w, "\" ");
+    fsm_text_write_u64(w, len);
+}
+
+static bool fsm_text_node_index(GlobalState *gs, Node *node, u64 *index) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    if (!node || node < gs->nodes || node >= gs->nodes + nodes_length)
+        return false;
+    *index = node - gs->nodes;
+    return true;
+}
+
+bool fsm_text_store(GlobalState *gs, const char *file_name, Job *job) {
+    u64 nodes_length = darray_get_size(gs->nodes);
+    u64 tlines_length = darray_get_size(gs->tlines);
+
+    // One allocation for the usual case
+    u64 capacity = gs->alphabet_len + FSM_TEXT_RECORD_SIZE;
+    for (u64 i = 0; i < nodes_length; ++i)
+        capacity += gs->nodes[i].name.len + FSM_TEXT_RECORD_SIZE;
+    for (u64 i = 0; i < tlines_length; ++i)
+        capacity += gs->tlines[i].inputs.len + FSM_TEXT_RECORD_SIZE;
+
+    FsmTextWriter w = {0};
+    fsm_text_reserve(&w, capacity);
+
+    if (gs->fsm_type == FSM_TYPE_DFA)
+        fsm_text_write_literal(&w, "FSM_TYPE: DFA\n");
+    else if (gs->fsm_type == FSM_TYPE_NFA)
+        fsm_text_write_literal(&w, "FSM_TYPE: NFA\n");
+
+    fsm_text_write_literal(&w, "Alphabet: ");
+    fsm_text_write_string(&w, gs->alphabet,
+                          gs->alphabet ? gs->alphabet_len : 0);
+    fsm_text_write_literal(&w, "\nNODES:\n");
+
+    for (u64 i = 0; i < nodes_length; ++i) {
+        if (job && !(i % FSM_TEXT_REPORT_INTERVAL))
+            job_set_progress_of(job, i, nodes_length + tlines_length);
+
+        Node *node = &gs->nodes[i];
+        fsm_text_write_string(&w, small_string_get(&node->name),
+                              node->name.len);
+        fsm_text_write_literal(&w, ", ");
+        fsm_text_write_float(&w, node->center.x);
+        fsm_text_write_literal(&w, " ");
+        fsm_text_write_float(&w, node->center.y);
+        fsm_text_write_literal(&w, ", ");
+        fsm_text_write_u64(&w, node->initial_state);
+        fsm_text_write_literal(&w, " ");
+        fsm_text_write_u64(&w, node->accepting_state);
+        fsm_text_write_literal(&w, "\n");
+    }
+
+    fsm_text_write_literal(&w, "TLINES:\n");
+    for (u64 i = 0; i < tlines_length; ++i) {
+        if (job && !(i % FSM_TEXT_REPORT_INTERVAL))
+            job_set_progress_of(job, nodes_length + i,
+                                nodes_length + tlines_length);
+
+        TLine *tline = &gs->tlines[i];
+        u64 start_idx, end_idx;
+        if (!fsm_text_node_index(gs, tline->start, &start_idx)
+            || !fsm_text_node_index(gs, tline->end, &end_idx)) {
+            w.failed = true;
+            break;
+        }
+
+        fsm_text_write_string(&w, small_string_get(&tline->inputs),
+                              tline->inputs.len);
+        fsm_text_write_literal(&w, ", ");
+        fsm_text_write_u64(&w, start_idx);
+        fsm_text_write_literal(&w, " ");
+        fsm_text_write_u64(&w, end_idx);
+        fsm_text_write_literal(&w, "\n");
+    }
+
+    bool stored = !w.failed && file_write_atomic(file_name, w.data, w.size);
+    memory_free(w.data);
+    return stored;
+}
+
+static bool fsm_text_fail(FsmTextParser *p, const char *message) {
+    p->error->line = p->line;
+    p->error->column = p->cursor - p->line_start + 1;
+    p->error->message = message;
+    return false;
+}
+
+static int fsm_text_peek(FsmTextParser *p) {
+    return p->cursor < p->end ? (u8)*p->cursor : EOF;
+}
+
+static void fsm_text_skip_spaces(FsmTextParser *p) {
+    while (p->cursor < p->end && (*p->cursor == ' ' || *p->cursor == '\t'))
+        p->cursor++;
+}
+
+static bool fsm_text_at_line_end(FsmTextParser *p) {
+    int c = fsm_text_peek(p);
+    return c == '\n' || c == '\r' || c == EOF;
+}
+
+static bool fsm_text_end_line(FsmTextParser *p) {
+    fsm_text_skip_spaces(p);
+    if (fsm_text_peek(p) == '\r') p->cursor++;
+    if (fsm_text_peek(p) == EOF) return true;
+    if (fsm_text_peek(p) != '\n')
+        return fsm_text_fail(p, "Expected a new line");
+
+    p->cursor++;
+    p->line++;
+    p->line_start = p->cursor;
+    return true;
+}
+
+static void fsm_text_skip_empty_lines(FsmTextParser *p) {
+    while (true) {
+        const char *cursor = p->cursor;
+        fsm_text_skip_spaces(p);
+        if (fsm_text_peek(p) == EOF) return;
+        if (!fsm_text_at_line_end(p)) {
+            p->cursor = cursor;
+            return;
+        }
+        fsm_text_end_line(p);
+    }
+}
+
+static bool fsm_text_accept(FsmTextParser *p, const char *literal) {
+    u64 len = strlen(literal);
+    if ((u64)(p->end - p->cursor) < len || memcmp(p->cursor, literal, len))
+        return false;
+    p->cursor += len;
+    return true;
+}
+
+static bool fsm_text_expect(FsmTextParser *p, const char *literal,
+                            const char *message) {
+    fsm_text_skip_spaces(p);
+    return fsm_text_accept(p, literal) || fsm_text_fail(p, message);
+}
+
+static bool fsm_text_parse_u64(FsmTextParser *p, u64 *value) {
+    fsm_text_skip_spaces(p);
+    int c = fsm_text_peek(p);
+    if (c < '0' || c > '9') return fsm_text_fail(p, "Expected a number");
+
+    u64 result = 0;
+    const char *start = p->cursor;
+    for (; (c = fsm_text_peek(p)) >= '0' && c <= '9'; p->cursor++) {
+        if (result > (UINT64_MAX - (c - '0')) / 10) {
+            p->cursor = start;
+            return fsm_text_fail(p, "Number is too large");
+        }
+        result = result * 10 + (c - '0');
+    }
+
+    *value = result;
+    return true;
+}
+
+static bool fsm_text_parse_u32(FsmTextParser *p, u32 *value) {
+    const char *start = p->cursor;
+    u64 result;
+    if (!fsm_text_parse_u64(p, &result)) return false;
+    if (result > UINT32_MAX) {
+        p->cursor = start;
+        fsm_text_skip_spaces(p);
+        return fsm_text_fail(p, "Number is too large");
+    }
+    *value = result;
+    return true;
+}
+
+// Decimal numbers with an optional exponent, like the ones printf writes
+static bool fsm_text_parse_float(FsmTextParser *p, float *value) {
+    fsm_text_skip_spaces(p);
+    const char *start = p->cursor;
+    bool negative = false;
+    if (fsm_text_peek(p) == '-' || fsm_text_peek(p) == '+')
+        negative = *p->cursor++ == '-';
+
+    // Digits past what fits in the mantissa only move the exponent
+    u64 mantissa = 0;
+    i64 exponent = 0;
+    u32 digits = 0;
+    bool fraction = false;
+    for (int c;; p->cursor++) {
+        c = fsm_text_peek(p);
+        if (c == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (c < '0' || c > '9') break;
+
+        digits++;
+        if (mantissa < UINT64_MAX / 10 - 9) {
+            mantissa = mantissa * 10 + (c - '0');
+            if (fraction) exponent--;
+        } else if (!fraction) {
+            exponent++;
+        }
+    }
+
+    if (!digits) {
+        p->cursor = start;
+        return fsm_text_fail(p, "Expected a number");
+    }
+
+    if (fsm_text_peek(p) == 'e' || fsm_text_peek(p) == 'E') {
+        p->cursor++;
+        bool negative_exponent = false;
+        if (fsm_text_peek(p) == '-' || fsm_text_peek(p) == '+')
+            negative_exponent = *p->cursor++ == '-';
+        u32 e;
+        if (!fsm_text_parse_u32(p, &e)) return false;
+        exponent += negative_exponent ? -(i64)e : (i64)e;
+    }
+
+    double result = (double)mantissa * pow(10.0, (double)exponent);
+    if (!(fabs(result) <= FLT_MAX)) {
+        p->cursor = start;
+        return fsm_text_fail(p, "Number is out of range");
+    }
+
+    *value = negative ? -result : result;
+    return true;
+}
+
+// The text is not copied, it points into the parsed text
+static bool fsm_text_parse_string(FsmTextParser *p, const char **text,
+                                  u32 *len) {
+    if (!fsm_text_expect(p, "\"", "Expected a quoted string")) return false;
+
+    const char *start = p->cursor;
+    while (p->cursor < p->end && *p->cursor != '"' && *p->cursor != '\n')
+        p->cursor++;
+    if (fsm_text_peek(p) != '"')
+        return fsm_text_fail(p, "Missing the closing quote");
+    const char *quote = p->cursor++;
+
+    // The length is the part of the string that is used, "NULL" has 0
+    const char *len_start = p->cursor;
+    if (!fsm_text_parse_u32(p, len)) return false;
+    if (*len > (u64)(quote - start)) {
+        p->cursor = len_start;
+        fsm_text_skip_spaces(p);
+        return fsm_text_fail(p, "Length is longer than the string");
+    }
+
+    *text = start;
+    return true;
+}
+
+// Publishes how far parsing got and stops it once the job is cancelled
+static bool fsm_text_report(FsmTextParser *p) {
+    if (!p->job || ++p->records % FSM_TEXT_REPORT_INTERVAL) return true;
+    if (job_is_cancelled(p->job)) return fsm_text_fail(p, "Cancelled");
+    job_set_progress_of(p->job, p->cursor - p->start, p->end - p->start);
+    return true;
+}
+
+static bool fsm_text_parse_header(GlobalState *gs, FsmTextParser *p) {
+    if (!fsm_text_expect(p, "FSM_TYPE:", "Expected FSM_TYPE:")) return false;
+    fsm_text_skip_spaces(p);
+    if (fsm_text_accept(p, "DFA")) gs->fsm_type = FSM_TYPE_DFA;
+    else if (fsm_text_accept(p, "NFA")) gs->fsm_type = FSM_TYPE_NFA;
+    else return fsm_text_fail(p, "Expected DFA or NFA");
+    if (!fsm_text_end_line(p)) return false;
+
+    const char *alphabet;
+    u32 alphabet_len;
+    fsm_text_skip_empty_lines(p);
+    if (!fsm_text_expect(p, "Alphabet:", "Expected Alphabet:")
+        || !fsm_text_parse_string(p, &alphabet, &alphabet_len)
+        || !fsm_text_end_line(p))
+        return false;
+
+    if (alphabet_len) {
+        char *new_alphabet =
+            memory_realloc(gs->alphabet, (alphabet_len + 1) * sizeof(char),
+                           MEMORY_TAG_STRINGS);
+        if (!new_alphabet) return fsm_text_fail(p, "Out of memory");
+        memcpy(new_alphabet, alphabet, alphabet_len);
+        new_alphabet[alphabet_len] = 0;
+        gs->alphabet = new_alphabet;
+    }
+    gs->alphabet_len = alphabet_len;
+
+    return true;
+}
+
+static bool fsm_text_parse_node(GlobalState *gs, FsmTextParser *p) {
+    const char *name;
+    u32 len;
+    Vector2 center;
+    u64 initial, accepting;
+    if (!fsm_text_parse_string(p, &name, &len)
+        || !fsm_text_expect(p, ",", "Expected a comma")
+        || !fsm_text_parse_float(p, &center.x)
+        || !fsm_text_parse_float(p, &center.y)
+        || !fsm_text_expect(p, ",", "Expected a comma")
+        || !fsm_text_parse_u64(p, &initial)
+        || !fsm_text_parse_u64(p, &accepting) || !fsm_text_end_line(p))
+        return false;
+
+    Node node;
+    node_create(&node, center);
+    node_set_name(&node, &gs->strings, name, len);
+    node_set_font(&node, gs->font, 32);
+    node.editing = true;
+    node.initial_state = initial;
+    node.accepting_state = accepting;
+    if (!darray_push(&gs->nodes, node))
+        return fsm_text_fail(p, "Out of memory");
+
+    return true;
+}
+
+static bool fsm_text_parse_tline(GlobalState *gs, FsmTextParser *p) {
+    const char *inputs;
+    u32 len;
+    if (!fsm_text_parse_string(p, &inputs, &len)
+        || !fsm_text_expect(p, ",", "Expected a comma"))
+        return false;
+
+    u64 nodes_length = darray_get_size(gs->nodes);
+    u64 indices[2];
+    for (u32 i = 0; i < 2; ++i) {
+        fsm_text_skip_spaces(p);
+        const char *index_start = p->cursor;
+        if (!fsm_text_parse_u64(p, &indices[i])) return false;
+        if (indices[i] >= nodes_length) {
+            p->cursor = index_start;
+            return fsm_text_fail(p, "There is no node with this index");
+        }
+    }
+    if (!fsm_text_end_line(p)) return false;
+
+    TLine tline;
+    tline_create(&tline);
+    tline_set_start_node(&tline, &gs->nodes[indices[0]]);
+    tline_set_end_node(&tline, &gs->nodes[indices[1]]);
+    tline_set_inputs(&tline, &gs->strings, inputs, len);
+    tline_set_font(&tline, gs->font);
+    tline.editing = true;
+    if (!darray_push(&gs->tlines, tline))
+        return fsm_text_fail(p, "Out of memory");
+
+    return true;
+}
+
+bool fsm_text_load(GlobalState *gs, const char *text, u64 size,
+                   FsmTextError *error, Job *job) {
+    FsmTextParser p = {.start = text,
+                       .cursor = text,
+                       .end = text + size,
+                       .line_start = text,
+                       .line = 1,
+                       .error = error,
+                       .job = job};
+
+    fsm_text_skip_empty_lines(&p);
+    if (!fsm_text_parse_header(gs, &p)) return false;
+
+    fsm_text_skip_empty_lines(&p);
+    if (!fsm_text_expect(&p, "NODES:", "Expected NODES:")
+        || !fsm_text_end_line(&p))
+        return false;
+
+    // The tlines point into the nodes, so every node must be read first
+    while (true) {
+        fsm_text_skip_empty_lines(&p);
+        fsm_text_skip_spaces(&p);
+        if (fsm_text_peek(&p) == EOF)
+            return fsm_text_fail(&p, "Expected TLINES:");
+        if (fsm_text_accept(&p, "TLINES:")) break;
+        if (!fsm_text_report(&p) || !fsm_text_parse_node(gs, &p))
+            return false;
+    }
+    if (!fsm_text_end_line(&p)) return false;
+
+    while (true) {
+        fsm_text_skip_empty_lines(&p);
+        if (fsm_text_peek(&p) == EOF) break;
+        if (!fsm_text_report(&p) || !fsm_text_parse_tline(gs, &p))
+            return false;
+    }
+
+    return true;
+}
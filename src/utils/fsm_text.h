@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defines.h"
+#include "stateflow.h"
+#include "worker.h"
+
+typedef struct FsmTextError {
+        u32 line;  // Both start at 1
+        u32 column;
+        const char *message;
+} FsmTextError;
+
+// Builds the whole file in memory and replaces the target with it at once.
+// The job is optional and receives the progress
+bool fsm_text_store(GlobalState *gs, const char *file_name, Job *job);
+
+// Parses the text into the empty model in a single pass. The text does not
+// have to be NUL terminated, on failure the error tells where parsing stopped.
+// The optional job receives the progress and can cancel the parsing
+bool fsm_text_load(GlobalState *gs, const char *text, u64 size,
+                   FsmTextError *error, Job *job);
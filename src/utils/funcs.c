@@ -1,13 +1,133 @@
 #include "funcs.h"
 
 #include <raymath.h>
+#include <rlgl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils/darray.h"
+#include "utils/fsm_cache.h"
+#include "utils/fsm_file.h"
+#include "utils/fsm_text.h"
+#include "utils/file_io.h"
+#include "utils/memory.h"
 #include "utils/strops.h"
 
+#if defined(STATEFLOW_GLES)
+static const char *grid_vertex_shader =
+    "#version 100\n"
+    "attribute vec3 vertexPosition;\n"
+    "attribute vec4 vertexColor;\n"
+    "uniform mat4 mvp;\n"
+    "varying vec2 fragWorld;\n"
+    "varying vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragWorld = vertexPosition.xy;\n"
+    "    fragColor = vertexColor;\n"
+    "    gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+static const char *grid_fragment_shader =
+    "#version 100\n"
+    "#extension GL_OES_standard_derivatives : enable\n"
+    "precision highp float;\n"
+    "varying vec2 fragWorld;\n"
+    "varying vec4 fragColor;\n"
+    "uniform float spacing;\n"
+    "uniform float thick;\n"
+    "void main() {\n"
+    "    vec2 dist = abs(fract((fragWorld / spacing) + 0.5) - 0.5) * spacing;\n"
+    "    vec2 px = fwidth(fragWorld);\n"
+    "    vec2 cover = 1.0 - smoothstep((thick - 1.0) * 0.5 * px,\n"
+    "                                  (thick + 1.0) * 0.5 * px, dist);\n"
+    "    float alpha = max(cover.x, cover.y);\n"
+    "    if (alpha <= 0.0) discard;\n"
+    "    gl_FragColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+    "}\n";
+#else
+static const char *grid_vertex_shader =
+    "#version 330\n"
+    "in vec3 vertexPosition;\n"
+    "in vec4 vertexColor;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragWorld;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragWorld = vertexPosition.xy;\n"
+    "    fragColor = vertexColor;\n"
+    "    gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+// Distance to the closest line in world units, compared against the line
+// width converted from pixels so it looks the same at every zoom level
+static const char *grid_fragment_shader =
+    "#version 330\n"
+    "in vec2 fragWorld;\n"
+    "in vec4 fragColor;\n"
+    "uniform float spacing;\n"
+    "uniform float thick;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    vec2 dist = abs(fract((fragWorld / spacing) + 0.5) - 0.5) * spacing;\n"
+    "    vec2 px = fwidth(fragWorld);\n"
+    "    vec2 cover = 1.0 - smoothstep((thick - 1.0) * 0.5 * px,\n"
+    "                                  (thick + 1.0) * 0.5 * px, dist);\n"
+    "    float alpha = max(cover.x, cover.y);\n"
+    "    if (alpha <= 0.0) discard;\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+    "}\n";
+#endif
+
+static Shader grid_shader;
+static i32 grid_spacing_loc, grid_thick_loc;
+static bool grid_shader_loaded = false;
+static bool grid_shader_failed = false;
+
+static void draw_grid_lines(Camera2D camera, float thick, float spacing,
+                            Color color);
+
 void draw_grid(Camera2D camera, float thick, float spacing, Color color) {
+    if (!grid_shader_loaded && !grid_shader_failed) {
+        grid_shader =
+            LoadShaderFromMemory(grid_vertex_shader, grid_fragment_shader);
+        if (grid_shader.id == rlGetShaderIdDefault()) {
+            TraceLog(LOG_WARNING, "Grid shader failed, drawing lines instead");
+            grid_shader_failed = true;
+        } else {
+            grid_spacing_loc = GetShaderLocation(grid_shader, "spacing");
+            grid_thick_loc = GetShaderLocation(grid_shader, "thick");
+            grid_shader_loaded = true;
+        }
+    }
+
+    if (grid_shader_failed) {
+        draw_grid_lines(camera, thick, spacing, color);
+        return;
+    }
+
+    // One quad covering the view, lines are computed per pixel
+    Vector2 top_left = GetScreenToWorld2D((Vector2){0, 0}, camera);
+    Vector2 bottom_right = GetScreenToWorld2D(
+        (Vector2){GetScreenWidth(), GetScreenHeight()}, camera);
+
+    SetShaderValue(grid_shader, grid_spacing_loc, &spacing,
+                   SHADER_UNIFORM_FLOAT);
+    SetShaderValue(grid_shader, grid_thick_loc, &thick, SHADER_UNIFORM_FLOAT);
+
+    BeginShaderMode(grid_shader);
+    DrawRectangleV(top_left, Vector2Subtract(bottom_right, top_left), color);
+    EndShaderMode();
+}
+
+void unload_grid_shader(void) {
+    if (grid_shader_loaded) UnloadShader(grid_shader);
+    grid_shader_loaded = false;
+    grid_shader_failed = false;
+}
+
+static void draw_grid_lines(Camera2D camera, float thick, float spacing,
+                            Color color) {
     i32 width = GetScreenWidth();
     i32 height = GetScreenHeight();
 
@@ -30,131 +150,216 @@ void draw_grid(Camera2D camera, float thick, float spacing, Color color) {
                    thick, color);
 }
 
-bool store_fsm_to_file(GlobalState *gs, const char *file_name) {
-    FILE *file = fopen(file_name, "w");
-    if (!file) return false;
-
-    if (gs->fsm_type == FSM_TYPE_DFA) fprintf(file, "FSM_TYPE: %s\n", "DFA");
-    else if (gs->fsm_type == FSM_TYPE_NFA)
-        fprintf(file, "FSM_TYPE: %s\n", "NFA");
-
-    fprintf(file, "Alphabet: \"%s\" %" SCNu64 "\n",
-            gs->alphabet ? gs->alphabet : "NULL", gs->alphabet_len);
-
-    u64 nodes_length = darray_get_size(gs->nodes);
-    fprintf(file, "NODES:\n");
-    for (u64 i = 0; i < nodes_length; ++i) {
-        fprintf(file, "\"%s\" %" SCNu32 ", %f %f, %u %u\n",
-                gs->nodes[i].name ? gs->nodes[i].name : "NULL",
-                gs->nodes[i].name_length, gs->nodes[i].center.x,
-                gs->nodes[i].center.y, gs->nodes[i].initial_state,
-                gs->nodes[i].accepting_state);
+bool store_fsm_to_file(GlobalState *gs, const char *file_name, Job *job) {
+    if (!IsFileExtension(file_name, FSM_TEXT_FILE_EXTENSION))
+        return fsm_file_store(gs, file_name, job);
+
+    if (!fsm_text_store(gs, file_name, job)) return false;
+
+    // Text files have no table, it is cached for the next time they are loaded
+    if (fsm_table_sync(&gs->table, gs->nodes, gs->tlines, gs->version))
+        fsm_cache_store(gs, fsm_cache_hash(gs));
+
+    return true;
+}
+
+bool load_fsm_from_file(GlobalState *gs, const char *file_name, Job *job) {
+    // A table copied from a binary file is compiled for the new version
+    gs->version++;
+
+    MappedFile mf;
+    if (!mapped_file_open(&mf, file_name)) return false;
+
+    bool loaded;
+    if (fsm_file_is_binary(mf.data, mf.size)) {
+        loaded = fsm_file_load(gs, mf.data, mf.size, job);
+        if (!loaded) TraceLog(LOG_ERROR, "%s: Damaged FSM file", file_name);
+    } else {
+        FsmTextError error;
+        loaded =
+            fsm_text_load(gs, (const char *)mf.data, mf.size, &error, job);
+        if (!loaded)
+            TraceLog(LOG_ERROR, "%s:%u:%u: %s", file_name, error.line,
+                     error.column, error.message);
     }
+    mapped_file_close(&mf);
 
-    u64 tlines_length = darray_get_size(gs->tlines);
-    fprintf(file, "TLINES:\n");
-    for (u64 i = 0; i < tlines_length; ++i) {
-        u64 start_idx = 0;
-        u64 end_idx = 0;
-        for (u64 j = 0; j < nodes_length; ++j) {
-            if (&gs->nodes[j] == gs->tlines[i].start) start_idx = j;
-            if (&gs->nodes[j] == gs->tlines[i].end) end_idx = j;
-        }
-        fprintf(file, "\"%s\" %" SCNu32 ", %" SCNu64 " %" SCNu64 "\n",
-                gs->tlines[i].inputs, gs->tlines[i].len, start_idx, end_idx);
+    // Nothing of a file that failed half way is kept
+    if (!loaded) {
+        clear_fsm(gs);
+        return false;
     }
 
-    fclose(file);
+    // Machines without a stored table are only compiled the first time
+    if (!gs->table.built || gs->table.version != gs->version) {
+        u64 hash = fsm_cache_hash(gs);
+        if (!fsm_cache_load(gs, hash)
+            && fsm_table_rebuild(&gs->table, gs->nodes, gs->tlines,
+                                 gs->version))
+            fsm_cache_store(gs, hash);
+    }
 
     return true;
 }
 
-bool load_fsm_from_file(GlobalState *gs, const char *file_name) {
-    FILE *file = fopen(file_name, "r");
-    if (!file) return false;
-    char buf[1024];
+void clear_fsm(GlobalState *gs) {
+    u64 length = darray_get_size(gs->nodes);
+    for (u64 i = 0; i < length; ++i) node_destroy(&gs->nodes[i]);
+    darray_clear(gs->nodes);
+    length = darray_get_size(gs->tlines);
+    for (u64 i = 0; i < length; ++i) tline_destroy(&gs->tlines[i]);
+    darray_clear(gs->tlines);
+    arena_clear(&gs->strings);
 
-    if (fscanf(file, "FSM_TYPE: %s\n", buf) != 1) goto failed;
+    memory_free(gs->alphabet);
+    gs->alphabet = NULL;
+    gs->alphabet_len = 0;
+    snapshot_store_mark_all(&gs->snapshots);
+    gs->version++;
+}
 
-    if (!strcmp(buf, "DFA")) gs->fsm_type = FSM_TYPE_DFA;
-    else if (!strcmp(buf, "NFA")) gs->fsm_type = FSM_TYPE_NFA;
-    else goto failed;
+bool create_fsm(GlobalState *model, GlobalState *gs) {
+    memset(model, 0, sizeof(*model));
+    model->font = gs->font;
+    model->fsm_type = gs->fsm_type;
+    model->version = gs->version;
+    arena_create(&model->strings, ARENA_DEFAULT_BLOCK_SIZE, MEMORY_TAG_STRINGS);
+    fsm_table_create(&model->table);
 
-    if (fscanf(file, "Alphabet: \"%[^\"]\" %" SCNu64 "\n", buf,
-               &gs->alphabet_len)
-        != 2)
-        goto failed;
+    model->nodes = darray_create_tagged(Node, MEMORY_TAG_NODES);
+    model->tlines = darray_create_tagged(TLine, MEMORY_TAG_TLINES);
+    if (!model->nodes || !model->tlines) {
+        destroy_fsm(model);
+        return false;
+    }
+
+    return true;
+}
+
+bool copy_fsm(GlobalState *model, GlobalState *gs) {
+    if (!create_fsm(model, gs)) return false;
+
+    u64 node_count = darray_get_size(gs->nodes);
+    u64 tline_count = darray_get_size(gs->tlines);
+    if (!darray_reserve(&model->nodes, node_count)
+        || !darray_reserve(&model->tlines, tline_count))
+        goto fail;
 
     if (gs->alphabet_len) {
-        char *new_alphabet =
-            realloc(gs->alphabet, (gs->alphabet_len + 1) * sizeof(char));
-        if (!new_alphabet) goto failed;
-        gs->alphabet = new_alphabet;
-        for (u64 i = 0; i < gs->alphabet_len; ++i) gs->alphabet[i] = buf[i];
+        model->alphabet =
+            (char *)memory_alloc(gs->alphabet_len + 1, MEMORY_TAG_STRINGS);
+        if (!model->alphabet) goto fail;
+        memcpy(model->alphabet, gs->alphabet, gs->alphabet_len + 1);
+        model->alphabet_len = gs->alphabet_len;
     }
 
-    // TODO: Can we validate?
-    fscanf(file, "NODES:\n");
-
-    while (true) {
-        int c = fgetc(file);
-        if (c == EOF) goto failed;  // Unexpected EOF
-        ungetc(c, file);
-
-        if (c == 'T') break;  // TLINES
-
-        u32 len;
-        Vector2 center;
-        Node node;
-        u8 initial, accepting;
-        if (fscanf(file,
-                   "\"%[^\"]\" %" SCNu32 ", %f %f, %" SCNu8 " %" SCNu8 "\n",
-                   buf, &len, &center.x, &center.y, &initial, &accepting)
-            != 6)
-            goto failed;
-        node_create(&node, center);
-        node_set_name(&node, buf, len);
-        node_set_font(&node, gs->font, 32);
-        node.editing = true;
-        node.initial_state = initial;
-        node.accepting_state = accepting;
-        darray_push(&gs->nodes, node);
+    // Strings are copied into the arena of the model, the nodes are reserved
+    // up front so the tlines can point into them
+    for (u64 i = 0; i < node_count; ++i) {
+        Node node = gs->nodes[i];
+        const SmallString *name = &gs->nodes[i].name;
+        if (!small_string_set(&node.name, &model->strings,
+                              small_string_get(name), name->len))
+            goto fail;
+        darray_push(&model->nodes, node);
     }
 
-    // TODO: Can we validate?
-    fscanf(file, "TLINES:\n");
-
-    u64 nodes_length = darray_get_size(gs->nodes);
-    while (true) {
-        int c = fgetc(file);
-        // Well, we can have nothing at the tlines
-        if (c == EOF) break;
-        ungetc(c, file);
-
-        i64 start_idx, end_idx;
-        u32 len;
-        if (fscanf(file, "\"%[^\"]\" %" SCNu32 ", %" SCNi64 " %" SCNi64 "\n",
-                   buf, &len, &start_idx, &end_idx)
-            != 4)
-            goto failed;
-
-        if (start_idx < 0 || start_idx >= (i64)nodes_length) goto failed;
-        if (end_idx < 0 || end_idx >= (i64)nodes_length) goto failed;
-
-        TLine tline;
-        tline_create(&tline);
-        tline_set_start_node(&tline, &gs->nodes[start_idx]);
-        tline_set_end_node(&tline, &gs->nodes[end_idx]);
-        tline_set_inputs(&tline, buf, len);
-        tline_set_font(&tline, gs->font);
-        tline.editing = true;
-
-        darray_push(&gs->tlines, tline);
+    for (u64 i = 0; i < tline_count; ++i) {
+        TLine tline = gs->tlines[i];
+        const SmallString *inputs = &gs->tlines[i].inputs;
+        if (!small_string_set(&tline.inputs, &model->strings,
+                              small_string_get(inputs), inputs->len))
+            goto fail;
+        if (tline.start) tline.start = &model->nodes[tline.start - gs->nodes];
+        if (tline.end) tline.end = &model->nodes[tline.end - gs->nodes];
+        darray_push(&model->tlines, tline);
     }
 
-    fclose(file);
+    // A current table saves the worker from compiling it again
+    if (gs->table.built && gs->table.version == gs->version)
+        fsm_table_copy(&model->table, &gs->table);
+
     return true;
-failed:
-    fclose(file);
+
+fail:
+    destroy_fsm(model);
     return false;
 }
+
+void destroy_fsm(GlobalState *model) {
+    u64 length = model->nodes ? darray_get_size(model->nodes) : 0;
+    for (u64 i = 0; i < length; ++i) node_destroy(&model->nodes[i]);
+    darray_destroy(model->nodes);
+    length = model->tlines ? darray_get_size(model->tlines) : 0;
+    for (u64 i = 0; i < length; ++i) tline_destroy(&model->tlines[i]);
+    darray_destroy(model->tlines);
+    arena_destroy(&model->strings);
+    fsm_table_destroy(&model->table);
+    memory_free(model->alphabet);
+
+    model->nodes = NULL;
+    model->tlines = NULL;
+    model->alphabet = NULL;
+    model->alphabet_len = 0;
+}
+
+void replace_fsm(GlobalState *gs, GlobalState *model) {
+    GlobalState old = *gs;
+    destroy_fsm(&old);
+
+    gs->nodes = model->nodes;
+    gs->tlines = model->tlines;
+    gs->strings = model->strings;
+    gs->alphabet = model->alphabet;
+    gs->alphabet_len = model->alphabet_len;
+    gs->fsm_type = model->fsm_type;
+
+    // The table stays valid when it was compiled for the model
+    bool current =
+        model->table.built && model->table.version == model->version;
+    gs->table = model->table;
+    snapshot_store_mark_all(&gs->snapshots);
+    history_clear(&gs->history);
+    gs->version++;
+    gs->table.version = gs->version;
+    gs->table.built = current;
+
+    model->nodes = NULL;
+    model->tlines = NULL;
+    model->alphabet = NULL;
+    model->alphabet_len = 0;
+    arena_create(&model->strings, ARENA_DEFAULT_BLOCK_SIZE, MEMORY_TAG_STRINGS);
+    fsm_table_create(&model->table);
+}
+
+char *load_text_file(const char *file_name, u32 *len) {
+    FILE *file = fopen(file_name, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < 0 || (u64)size >= UINT32_MAX) {
+        fclose(file);
+        return NULL;
+    }
+
+    char *text = (char *)memory_alloc(size + 1, MEMORY_TAG_STRINGS);
+    if (!text) {
+        fclose(file);
+        return NULL;
+    }
+
+    u64 length = fread(text, sizeof(char), size, file);
+    fclose(file);
+
+    while (length && (text[length - 1] == '\n' || text[length - 1] == '\r'))
+        length--;
+    text[length] = 0;
+
+    // Stops at an embedded NUL, the rest could not be shown or validated
+    *len = strlen(text);
+
+    return text;
+}
@@ -7,6 +7,34 @@
 
 void draw_grid(Camera2D camera, float thick, float spacing, Color color);
 
-bool store_fsm_to_file(GlobalState *gs, const char *file_name);
+void unload_grid_shader(void);
 
-bool load_fsm_from_file(GlobalState *gs, const char *file_name);
+// Files with this extension are stored in the text format, which is meant
+// for interchange. Everything else is stored in the binary format
+#define FSM_TEXT_FILE_EXTENSION ".fsmt"
+
+// The job is optional, it is given the progress and can cancel the store
+bool store_fsm_to_file(GlobalState *gs, const char *file_name, Job *job);
+
+// Reads both formats into the empty model, loading counts as an edit of it.
+// Errors are logged and the model is left empty
+bool load_fsm_from_file(GlobalState *gs, const char *file_name, Job *job);
+
+// Removes every node and tline and the alphabet
+void clear_fsm(GlobalState *gs);
+
+// An empty model apart from the one in gs, to be built or written by a
+// worker. Only the automaton, the table and the font are used
+bool create_fsm(GlobalState *model, GlobalState *gs);
+
+// Creates the model as a deep copy of the automaton in gs
+bool copy_fsm(GlobalState *model, GlobalState *gs);
+
+void destroy_fsm(GlobalState *model);
+
+// Moves the automaton out of the model into gs, which counts as an edit.
+// The model is left empty but must still be destroyed
+void replace_fsm(GlobalState *gs, GlobalState *model);
+
+// Reads the whole file without trailing line breaks, memory_free() the result
+char *load_text_file(const char *file_name, u32 *len);
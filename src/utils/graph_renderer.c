@@ -0,0 +1,686 @@
+#include "graph_renderer.h"
+
+// raymath.h should be included after raylib.h
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+
+#define NODE_DISC_SEGMENTS 24
+#define NODE_MINIMAL_DISC_SEGMENTS 8
+// Accepting ring + inner disc + initial state marker
+#define NODE_SLOT_VERTICES ((2 * NODE_DISC_SEGMENTS * 3) + 3)
+// Line quad + arrowhead
+#define TLINE_SLOT_VERTICES (6 + 3)
+#define GRAPH_BUFFER_MIN_CAPACITY 64
+// Widest bundle stroke relative to a single tline
+#define TLINE_BUNDLE_MAX_SCALE 3.0f
+#define TLINE_BUNDLE_EMPTY UINT32_MAX
+
+// Style bits of a node instance, the low two bits are the NodeState
+#define NODE_STYLE_ACCEPTING 4
+#define NODE_STYLE_INITIAL 8
+
+#if !defined(STATEFLOW_GLES)
+// Quad corners in units of the radius, wide enough for the initial marker
+static const Vector2 node_quad[6] = {
+    {-1.6f, -1.1f},
+    { 1.1f, -1.1f},
+    { 1.1f,  1.1f},
+    {-1.6f, -1.1f},
+    { 1.1f,  1.1f},
+    {-1.6f,  1.1f},
+};
+
+static const char *node_vertex_shader =
+    "#version 330\n"
+    "in vec2 vertexCorner;\n"
+    "in vec4 instanceNode;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragLocal;\n"
+    "flat out int fragStyle;\n"
+    "void main() {\n"
+    "    fragLocal = vertexCorner;\n"
+    "    fragStyle = int(instanceNode.w + 0.5);\n"
+    "    vec2 world = instanceNode.xy + (vertexCorner * instanceNode.z);\n"
+    "    gl_Position = mvp * vec4(world, 0.0, 1.0);\n"
+    "}\n";
+
+// Distances are in units of the radius, fwidth keeps the edges one pixel
+// wide at every zoom level
+static const char *node_fragment_shader =
+    "#version 330\n"
+    "in vec2 fragLocal;\n"
+    "flat in int fragStyle;\n"
+    "uniform vec4 palette[4];\n"
+    "out vec4 finalColor;\n"
+    "float coverage(float d) {\n"
+    "    float aa = fwidth(d);\n"
+    "    return 1.0 - smoothstep(-aa, aa, d);\n"
+    "}\n"
+    "void main() {\n"
+    "    vec4 fill = palette[fragStyle & 3];\n"
+    "    float r = length(fragLocal);\n"
+    "    if ((fragStyle & 4) != 0)\n"
+    "        fill = mix(vec4(0.0, 0.0, 0.0, 1.0), fill, coverage(r - 0.9));\n"
+    "    vec4 color = vec4(fill.rgb, fill.a * coverage(r - 1.0));\n"
+    "    if ((fragStyle & 8) != 0) {\n"
+    "        vec2 p = fragLocal;\n"
+    "        float d = max(-1.5 - p.x, (abs(p.y) + p.x + 1.0) * 0.7071);\n"
+    "        color = mix(color, vec4(0.0, 0.0, 0.0, 1.0), coverage(d));\n"
+    "    }\n"
+    "    if (color.a <= 0.0) discard;\n"
+    "    finalColor = color;\n"
+    "}\n";
+#endif
+
+typedef struct SlotWriter {
+        Vector2 *positions;
+        Color *colors;
+        u32 index;
+} SlotWriter;
+
+static bool node_instance_buffer_create(NodeInstanceBuffer *b);
+static void node_instance_buffer_destroy(NodeInstanceBuffer *b);
+static void node_instance_buffer_reserve(NodeInstanceBuffer *b, u32 count);
+static void node_instance_buffer_upload(NodeInstanceBuffer *b, u32 count);
+static void node_instance_buffer_draw(NodeInstanceBuffer *b, u32 count,
+                                      NodeColors colors);
+
+static void graph_ranges_mark_dirty(GraphBufferRange **ranges, u32 slot);
+
+static void graph_buffer_create(GraphBuffer *b, u32 slot_vertices);
+static void graph_buffer_destroy(GraphBuffer *b);
+static void graph_buffer_reserve(GraphBuffer *b, u32 slots);
+static void graph_buffer_load(GraphBuffer *b);
+static void graph_buffer_bind(GraphBuffer *b);
+static void graph_buffer_mark_dirty(GraphBuffer *b, u32 slot);
+static void graph_buffer_upload(GraphBuffer *b, u32 slots);
+static void graph_buffer_draw(GraphBuffer *b, u32 slots);
+static SlotWriter graph_buffer_get_writer(GraphBuffer *b, u32 slot);
+
+static void slot_triangle(SlotWriter *w, Vector2 a, Vector2 b, Vector2 c,
+                          Color color);
+static void slot_disc(SlotWriter *w, Vector2 center, float radius,
+                      u32 segments, Color color);
+static void slot_line(SlotWriter *w, Vector2 start, Vector2 end, float thick,
+                      Color color);
+static void slot_finish(SlotWriter *w, u32 slot_vertices);
+
+static void graph_renderer_update_node_slots(GraphRenderer *gr, Node *nodes,
+                                             u32 nodes_length, float zoom);
+static void graph_renderer_update_node_instances(GraphRenderer *gr,
+                                                 Node *nodes,
+                                                 u32 nodes_length);
+static void graph_renderer_bundle_tlines(GraphRenderer *gr, Node *nodes,
+                                         TLine *tlines, u32 tlines_length,
+                                         float zoom);
+static void graph_renderer_build_node(GraphRenderer *gr, u32 slot);
+static void graph_renderer_build_tline(GraphRenderer *gr, u32 slot,
+                                       TLine *tl);
+
+void graph_renderer_create(GraphRenderer *gr) {
+    gr->instanced = node_instance_buffer_create(&gr->node_instances);
+    graph_buffer_create(&gr->node_buffer, NODE_SLOT_VERTICES);
+    graph_buffer_create(&gr->tline_buffer, TLINE_SLOT_VERTICES);
+    gr->node_slots = darray_create_tagged(NodeSlot, MEMORY_TAG_UI);
+    gr->tline_slots = darray_create_tagged(TLineSlot, MEMORY_TAG_UI);
+    gr->bundles = darray_create_tagged(TLineBundle, MEMORY_TAG_UI);
+    gr->bundle_table = darray_create_tagged(u32, MEMORY_TAG_UI);
+    gr->node_count = 0;
+    gr->tline_count = 0;
+}
+
+void graph_renderer_destroy(GraphRenderer *gr) {
+    if (gr->instanced) node_instance_buffer_destroy(&gr->node_instances);
+    graph_buffer_destroy(&gr->node_buffer);
+    graph_buffer_destroy(&gr->tline_buffer);
+    darray_destroy(gr->node_slots);
+    darray_destroy(gr->tline_slots);
+    darray_destroy(gr->bundles);
+    darray_destroy(gr->bundle_table);
+}
+
+void graph_renderer_invalidate(GraphRenderer *gr) {
+    gr->node_count = 0;
+    gr->tline_count = 0;
+}
+
+void graph_renderer_draw(GraphRenderer *gr, Node *nodes, TLine *tlines,
+                         float zoom) {
+    u32 nodes_length = darray_get_size(nodes);
+    u32 tlines_length = darray_get_size(tlines);
+
+    if (gr->instanced) {
+        node_instance_buffer_reserve(&gr->node_instances, nodes_length);
+        if (gr->node_instances.capacity < nodes_length) return;
+    } else {
+        graph_buffer_reserve(&gr->node_buffer, nodes_length);
+        if (gr->node_buffer.capacity < nodes_length) return;
+        if (!darray_reserve(&gr->node_slots, gr->node_buffer.capacity))
+            return;
+    }
+
+    graph_buffer_reserve(&gr->tline_buffer, tlines_length);
+    if (gr->tline_buffer.capacity < tlines_length) return;
+    if (!darray_reserve(&gr->tline_slots, gr->tline_buffer.capacity)
+        || !darray_reserve(&gr->bundles, gr->tline_buffer.capacity))
+        return;
+
+    graph_renderer_bundle_tlines(gr, nodes, tlines, tlines_length, zoom);
+
+    // Only elements whose drawn shape changed are rebuilt and uploaded
+    for (u32 i = 0; i < tlines_length; ++i) {
+        TLine *tl = &tlines[i];
+        TLineSlot slot;
+        memset(&slot, 0, sizeof(slot));
+        if (tl->start && tl->end) {
+            slot.start = tl->start->center;
+            slot.end = tl->end->center;
+            slot.start_radius = tl->start->radius;
+            slot.end_radius = tl->end->radius;
+            slot.color = tline_get_color(tl);
+            slot.detail = node_get_detail_level(
+                fminf(slot.start_radius, slot.end_radius), zoom);
+            slot.self_loop = tl->start == tl->end;
+
+            TLineBundle *b = &gr->bundles[i];
+            slot.bundle_size = b->lead == i ? b->size : 0;
+            if (slot.bundle_size) slot.color = b->color;
+        }
+
+        if (i < gr->tline_count
+            && !memcmp(&slot, &gr->tline_slots[i], sizeof(slot)))
+            continue;
+
+        gr->tline_slots[i] = slot;
+        graph_renderer_build_tline(gr, i, tl);
+        graph_buffer_mark_dirty(&gr->tline_buffer, i);
+    }
+    gr->tline_count = tlines_length;
+
+    if (gr->instanced)
+        graph_renderer_update_node_instances(gr, nodes, nodes_length);
+    else graph_renderer_update_node_slots(gr, nodes, nodes_length, zoom);
+    gr->node_count = nodes_length;
+
+    // Whatever was drawn before has to reach the screen first
+    rlDrawRenderBatchActive();
+
+    graph_buffer_upload(&gr->tline_buffer, tlines_length);
+    graph_buffer_draw(&gr->tline_buffer, tlines_length);
+
+    // Self loops are rare, their splines go through the regular batch
+    for (u32 i = 0; i < tlines_length; ++i) {
+        if (gr->tline_slots[i].self_loop) tline_draw(&tlines[i], zoom);
+        else tline_draw_label(&tlines[i], zoom);
+    }
+    rlDrawRenderBatchActive();
+
+    if (gr->instanced) {
+        node_instance_buffer_upload(&gr->node_instances, nodes_length);
+        if (nodes_length)
+            node_instance_buffer_draw(&gr->node_instances, nodes_length,
+                                      nodes[0].colors);
+    } else {
+        graph_buffer_upload(&gr->node_buffer, nodes_length);
+        graph_buffer_draw(&gr->node_buffer, nodes_length);
+    }
+
+    for (u32 i = 0; i < nodes_length; ++i) node_draw_label(&nodes[i], zoom);
+}
+
+static void graph_renderer_update_node_slots(GraphRenderer *gr, Node *nodes,
+                                             u32 nodes_length, float zoom) {
+    for (u32 i = 0; i < nodes_length; ++i) {
+        Node *n = &nodes[i];
+        NodeSlot slot;
+        memset(&slot, 0, sizeof(slot));
+        slot.center = n->center;
+        slot.radius = n->radius;
+        slot.color = node_get_color(n);
+        slot.detail = node_get_detail_level(n->radius, zoom);
+        slot.accepting_state = n->accepting_state;
+        slot.initial_state = n->initial_state;
+
+        if (i < gr->node_count
+            && !memcmp(&slot, &gr->node_slots[i], sizeof(slot)))
+            continue;
+
+        gr->node_slots[i] = slot;
+        graph_renderer_build_node(gr, i);
+        graph_buffer_mark_dirty(&gr->node_buffer, i);
+    }
+}
+
+static void graph_renderer_update_node_instances(GraphRenderer *gr,
+                                                 Node *nodes,
+                                                 u32 nodes_length) {
+    NodeInstanceBuffer *b = &gr->node_instances;
+    for (u32 i = 0; i < nodes_length; ++i) {
+        Node *n = &nodes[i];
+        u32 style = (u32)n->state;
+        if (n->accepting_state) style |= NODE_STYLE_ACCEPTING;
+        if (n->initial_state) style |= NODE_STYLE_INITIAL;
+
+        Vector4 instance = {n->center.x, n->center.y, n->radius, (float)style};
+        if (i < gr->node_count
+            && !memcmp(&instance, &b->instances[i], sizeof(instance)))
+            continue;
+
+        b->instances[i] = instance;
+        graph_ranges_mark_dirty(&b->dirty, i);
+    }
+}
+
+// Bundles are looked up by start and end node. Every tline is its own lead at
+// the full detail level, or when the table does not fit in memory
+static void graph_renderer_bundle_tlines(GraphRenderer *gr, Node *nodes,
+                                         TLine *tlines, u32 tlines_length,
+                                         float zoom) {
+    u32 table_size = 1;
+    while (table_size < tlines_length * 2) table_size *= 2;
+    bool hashed = darray_reserve(&gr->bundle_table, table_size);
+    if (hashed)
+        memset(gr->bundle_table, 0xff, (u64)table_size * sizeof(u32));
+
+    for (u32 i = 0; i < tlines_length; ++i) {
+        TLine *tl = &tlines[i];
+        u32 rank = tl->selected ? TLINE_STATE_HIGHLIGHTED + 1 : tl->state;
+        gr->bundles[i] = (TLineBundle){
+            .lead = i, .size = 1, .rank = rank, .color = tline_get_color(tl)};
+
+        if (!hashed || !tl->start || !tl->end || tl->start == tl->end)
+            continue;
+        if (node_get_detail_level(fminf(tl->start->radius, tl->end->radius),
+                                  zoom)
+            == DETAIL_LEVEL_FULL)
+            continue;
+
+        u64 key = ((u64)(tl->start - nodes) << 32) | (u64)(tl->end - nodes);
+        u32 h = (u32)((key * 0x9e3779b97f4a7c15ULL) >> 32) & (table_size - 1);
+        for (;; h = (h + 1) & (table_size - 1)) {
+            u32 lead = gr->bundle_table[h];
+            if (lead == TLINE_BUNDLE_EMPTY) {
+                gr->bundle_table[h] = i;
+                break;
+            }
+            if (tlines[lead].start != tl->start || tlines[lead].end != tl->end)
+                continue;
+
+            TLineBundle *b = &gr->bundles[lead];
+            b->size++;
+            if (rank > b->rank) {
+                b->rank = rank;
+                b->color = gr->bundles[i].color;
+            }
+            gr->bundles[i].lead = lead;
+            break;
+        }
+    }
+}
+
+static void graph_renderer_build_node(GraphRenderer *gr, u32 slot) {
+    NodeSlot *ns = &gr->node_slots[slot];
+    SlotWriter w = graph_buffer_get_writer(&gr->node_buffer, slot);
+
+    if (ns->detail == DETAIL_LEVEL_MINIMAL && ns->accepting_state) {
+        slot_disc(&w, ns->center, ns->radius, NODE_MINIMAL_DISC_SEGMENTS,
+                  BLACK);
+        slot_disc(&w, ns->center, ns->radius * NODE_MINIMAL_RING_INNER,
+                  NODE_MINIMAL_DISC_SEGMENTS, ns->color);
+    } else if (ns->detail == DETAIL_LEVEL_MINIMAL) {
+        slot_disc(&w, ns->center, ns->radius, NODE_MINIMAL_DISC_SEGMENTS,
+                  ns->color);
+    } else if (ns->accepting_state) {
+        slot_disc(&w, ns->center, ns->radius, NODE_DISC_SEGMENTS, BLACK);
+        slot_disc(&w, ns->center, ns->radius * 0.9f, NODE_DISC_SEGMENTS,
+                  ns->color);
+    } else {
+        slot_disc(&w, ns->center, ns->radius, NODE_DISC_SEGMENTS, ns->color);
+    }
+
+    if (ns->initial_state) {
+        Vector2 c = ns->center;
+        float r = ns->radius;
+        slot_triangle(&w, (Vector2){c.x - (r * 1.5f), c.y + (r * 0.5f)},
+                      (Vector2){c.x - r, c.y},
+                      (Vector2){c.x - (r * 1.5f), c.y - (r * 0.5f)}, BLACK);
+    }
+
+    slot_finish(&w, gr->node_buffer.slot_vertices);
+}
+
+static void graph_renderer_build_tline(GraphRenderer *gr, u32 slot,
+                                       TLine *tl) {
+    TLineSlot *ts = &gr->tline_slots[slot];
+    SlotWriter w = graph_buffer_get_writer(&gr->tline_buffer, slot);
+
+    if (!tl->start || !tl->end || ts->self_loop || !ts->bundle_size) {
+        slot_finish(&w, gr->tline_buffer.slot_vertices);
+        return;
+    }
+
+    float scale = fminf(sqrtf(ts->bundle_size), TLINE_BUNDLE_MAX_SCALE);
+    if (ts->detail == DETAIL_LEVEL_MINIMAL) {
+        // Edges shorter than the discs they join are fully covered
+        float radius = fminf(ts->start_radius, ts->end_radius);
+        if (Vector2Distance(ts->start, ts->end)
+            > ts->start_radius + ts->end_radius)
+            slot_line(&w, ts->start, ts->end,
+                      fmaxf(3.0f, radius / NODE_DETAIL_MIN_SCREEN_RADIUS)
+                          * scale,
+                      ts->color);
+    } else {
+        Vector2 points[3];
+        tline_get_arrow_points(tl, points);
+        slot_line(&w, ts->start, ts->end, 3.0f * scale, ts->color);
+        slot_triangle(&w, points[0], points[1], points[2], ts->color);
+    }
+
+    slot_finish(&w, gr->tline_buffer.slot_vertices);
+}
+
+static bool node_instance_buffer_create(NodeInstanceBuffer *b) {
+#if defined(STATEFLOW_GLES)
+    // No instancing without extensions, the slot buffer is used instead
+    UNUSED(b);
+    return false;
+#else
+    b->shader = LoadShaderFromMemory(node_vertex_shader, node_fragment_shader);
+    if (b->shader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "Node shader failed, not using instancing");
+        return false;
+    }
+
+    b->corner_loc = GetShaderLocationAttrib(b->shader, "vertexCorner");
+    b->instance_loc = GetShaderLocationAttrib(b->shader, "instanceNode");
+    b->palette_loc = GetShaderLocation(b->shader, "palette");
+    b->capacity = 0;
+    b->instances = NULL;
+    b->instance_vbo = 0;
+    b->dirty = darray_create_tagged(GraphBufferRange, MEMORY_TAG_UI);
+
+    b->vao = rlLoadVertexArray();
+    rlEnableVertexArray(b->vao);
+    b->quad_vbo = rlLoadVertexBuffer(node_quad, sizeof(node_quad), false);
+    rlSetVertexAttribute(b->corner_loc, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(b->corner_loc);
+    rlDisableVertexArray();
+
+    return true;
+#endif
+}
+
+static void node_instance_buffer_destroy(NodeInstanceBuffer *b) {
+    if (b->instance_vbo) rlUnloadVertexBuffer(b->instance_vbo);
+    rlUnloadVertexBuffer(b->quad_vbo);
+    rlUnloadVertexArray(b->vao);
+    UnloadShader(b->shader);
+    memory_free(b->instances);
+    darray_destroy(b->dirty);
+}
+
+static void node_instance_buffer_reserve(NodeInstanceBuffer *b, u32 count) {
+    if (count <= b->capacity) return;
+
+    u32 capacity = MAX(count, MAX(b->capacity * 2, GRAPH_BUFFER_MIN_CAPACITY));
+    Vector4 *instances =
+        (Vector4 *)memory_realloc(b->instances, capacity * sizeof(Vector4),
+                                  MEMORY_TAG_UI);
+    if (!instances) return;
+    memset(&instances[b->capacity], 0,
+           (capacity - b->capacity) * sizeof(Vector4));
+    b->instances = instances;
+    b->capacity = capacity;
+
+    // The new GPU buffer gets the whole CPU copy, nothing is pending
+    rlEnableVertexArray(b->vao);
+    if (b->instance_vbo) rlUnloadVertexBuffer(b->instance_vbo);
+    b->instance_vbo =
+        rlLoadVertexBuffer(b->instances, capacity * sizeof(Vector4), true);
+    rlSetVertexAttribute(b->instance_loc, 4, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(b->instance_loc);
+    rlSetVertexAttributeDivisor(b->instance_loc, 1);
+    rlDisableVertexArray();
+
+    darray_clear(b->dirty);
+}
+
+static void node_instance_buffer_upload(NodeInstanceBuffer *b, u32 count) {
+    u64 length = darray_get_size(b->dirty);
+    for (u64 i = 0; i < length; ++i) {
+        GraphBufferRange range = b->dirty[i];
+        if (range.first >= count) continue;
+        range.count = MIN(range.count, count - range.first);
+
+        rlUpdateVertexBuffer(b->instance_vbo, &b->instances[range.first],
+                             range.count * sizeof(Vector4),
+                             range.first * sizeof(Vector4));
+    }
+
+    darray_clear(b->dirty);
+}
+
+static void node_instance_buffer_draw(NodeInstanceBuffer *b, u32 count,
+                                      NodeColors colors) {
+    // Same order as NodeState
+    Color states[4] = {colors.normal, colors.down, colors.hovered,
+                       colors.highlighted};
+    Vector4 palette[4];
+    for (u32 i = 0; i < 4; ++i) palette[i] = ColorNormalize(states[i]);
+
+    Matrix mvp =
+        MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    SetShaderValueMatrix(b->shader, b->shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+    SetShaderValueV(b->shader, b->palette_loc, palette, SHADER_UNIFORM_VEC4, 4);
+
+    rlEnableShader(b->shader.id);
+    rlDisableBackfaceCulling();
+
+    rlEnableVertexArray(b->vao);
+    rlDrawVertexArrayInstanced(0, 6, count);
+    rlDisableVertexArray();
+
+    rlEnableBackfaceCulling();
+    rlDisableShader();
+}
+
+static void graph_ranges_mark_dirty(GraphBufferRange **ranges, u32 slot) {
+    u64 length = darray_get_size(*ranges);
+    if (length) {
+        GraphBufferRange *last = &(*ranges)[length - 1];
+        if (last->first + last->count == slot) {
+            last->count++;
+            return;
+        }
+    }
+
+    darray_push(ranges, ((GraphBufferRange){.first = slot, .count = 1}));
+}
+
+static void graph_buffer_create(GraphBuffer *b, u32 slot_vertices) {
+    b->slot_vertices = slot_vertices;
+    b->capacity = 0;
+    b->positions = NULL;
+    b->colors = NULL;
+    b->vao = 0;
+    b->position_vbo = 0;
+    b->color_vbo = 0;
+    b->dirty = darray_create_tagged(GraphBufferRange, MEMORY_TAG_UI);
+}
+
+static void graph_buffer_destroy(GraphBuffer *b) {
+    if (b->position_vbo) rlUnloadVertexBuffer(b->position_vbo);
+    if (b->color_vbo) rlUnloadVertexBuffer(b->color_vbo);
+    if (b->vao) rlUnloadVertexArray(b->vao);
+    memory_free(b->positions);
+    memory_free(b->colors);
+    darray_destroy(b->dirty);
+}
+
+static void graph_buffer_reserve(GraphBuffer *b, u32 slots) {
+    if (slots <= b->capacity) return;
+
+    u32 capacity = MAX(slots, MAX(b->capacity * 2, GRAPH_BUFFER_MIN_CAPACITY));
+    u64 vertices = (u64)capacity * b->slot_vertices;
+    u64 old_vertices = (u64)b->capacity * b->slot_vertices;
+
+    Vector2 *positions =
+        (Vector2 *)memory_realloc(b->positions, vertices * sizeof(Vector2),
+                                  MEMORY_TAG_UI);
+    if (!positions) return;
+    b->positions = positions;
+
+    Color *colors = (Color *)memory_realloc(
+        b->colors, vertices * sizeof(Color), MEMORY_TAG_UI);
+    if (!colors) return;
+    b->colors = colors;
+
+    memset(&b->positions[old_vertices], 0,
+           (vertices - old_vertices) * sizeof(Vector2));
+    memset(&b->colors[old_vertices], 0,
+           (vertices - old_vertices) * sizeof(Color));
+
+    b->capacity = capacity;
+
+    // The new GPU buffers get the whole CPU copy, nothing is pending
+    graph_buffer_load(b);
+    darray_clear(b->dirty);
+}
+
+static void graph_buffer_load(GraphBuffer *b) {
+    if (b->position_vbo) rlUnloadVertexBuffer(b->position_vbo);
+    if (b->color_vbo) rlUnloadVertexBuffer(b->color_vbo);
+    if (b->vao) rlUnloadVertexArray(b->vao);
+
+    u64 vertices = (u64)b->capacity * b->slot_vertices;
+
+    // Returns 0 when vertex arrays are not supported, attributes are then
+    // bound again before every draw
+    b->vao = rlLoadVertexArray();
+    rlEnableVertexArray(b->vao);
+    b->position_vbo =
+        rlLoadVertexBuffer(b->positions, vertices * sizeof(Vector2), true);
+    b->color_vbo =
+        rlLoadVertexBuffer(b->colors, vertices * sizeof(Color), true);
+    graph_buffer_bind(b);
+    rlDisableVertexArray();
+}
+
+static void graph_buffer_bind(GraphBuffer *b) {
+    int *locs = rlGetShaderLocsDefault();
+
+    // Separate buffers keep both attribute offsets at zero
+    rlEnableVertexBuffer(b->position_vbo);
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION], 2, RL_FLOAT,
+                         false, 0, 0);
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION]);
+
+    rlEnableVertexBuffer(b->color_vbo);
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR], 4,
+                         RL_UNSIGNED_BYTE, true, 0, 0);
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR]);
+}
+
+static void graph_buffer_mark_dirty(GraphBuffer *b, u32 slot) {
+    graph_ranges_mark_dirty(&b->dirty, slot);
+}
+
+static void graph_buffer_upload(GraphBuffer *b, u32 slots) {
+    u64 length = darray_get_size(b->dirty);
+    for (u64 i = 0; i < length; ++i) {
+        GraphBufferRange range = b->dirty[i];
+        if (range.first >= slots) continue;
+        range.count = MIN(range.count, slots - range.first);
+
+        u64 first = (u64)range.first * b->slot_vertices;
+        u64 count = (u64)range.count * b->slot_vertices;
+        rlUpdateVertexBuffer(b->position_vbo, &b->positions[first],
+                             count * sizeof(Vector2), first * sizeof(Vector2));
+        rlUpdateVertexBuffer(b->color_vbo, &b->colors[first],
+                             count * sizeof(Color), first * sizeof(Color));
+    }
+
+    darray_clear(b->dirty);
+}
+
+static void graph_buffer_draw(GraphBuffer *b, u32 slots) {
+    if (!slots || !b->capacity) return;
+
+    int *locs = rlGetShaderLocsDefault();
+    Matrix mvp =
+        MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    rlEnableShader(rlGetShaderIdDefault());
+    rlSetUniformMatrix(locs[RL_SHADER_LOC_MATRIX_MVP], mvp);
+    rlSetUniform(locs[RL_SHADER_LOC_COLOR_DIFFUSE], white,
+                 RL_SHADER_UNIFORM_VEC4, 1);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(rlGetTextureIdDefault());
+
+    // Triangles are emitted without caring about the winding order
+    rlDisableBackfaceCulling();
+
+    if (!rlEnableVertexArray(b->vao)) graph_buffer_bind(b);
+    rlDrawVertexArray(0, slots * b->slot_vertices);
+    rlDisableVertexArray();
+
+    rlEnableBackfaceCulling();
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+static SlotWriter graph_buffer_get_writer(GraphBuffer *b, u32 slot) {
+    u64 first = (u64)slot * b->slot_vertices;
+    return (SlotWriter){.positions = &b->positions[first],
+                        .colors = &b->colors[first],
+                        .index = 0};
+}
+
+static void slot_triangle(SlotWriter *w, Vector2 a, Vector2 b, Vector2 c,
+                          Color color) {
+    w->positions[w->index] = a;
+    w->colors[w->index++] = color;
+    w->positions[w->index] = b;
+    w->colors[w->index++] = color;
+    w->positions[w->index] = c;
+    w->colors[w->index++] = color;
+}
+
+static void slot_disc(SlotWriter *w, Vector2 center, float radius,
+                      u32 segments, Color color) {
+    float step = (2.0f * PI) / segments;
+    Vector2 prev = {center.x + radius, center.y};
+    for (u32 i = 1; i <= segments; ++i) {
+        Vector2 next = {center.x + (cosf(step * i) * radius),
+                        center.y + (sinf(step * i) * radius)};
+        slot_triangle(w, center, next, prev, color);
+        prev = next;
+    }
+}
+
+static void slot_line(SlotWriter *w, Vector2 start, Vector2 end, float thick,
+                      Color color) {
+    Vector2 dir = Vector2Normalize(Vector2Subtract(end, start));
+    Vector2 offset = {-dir.y * (thick / 2.0f), dir.x * (thick / 2.0f)};
+
+    Vector2 a = Vector2Add(start, offset);
+    Vector2 b = Vector2Subtract(start, offset);
+    Vector2 c = Vector2Subtract(end, offset);
+    Vector2 d = Vector2Add(end, offset);
+
+    slot_triangle(w, a, b, c, color);
+    slot_triangle(w, a, c, d, color);
+}
+
+static void slot_finish(SlotWriter *w, u32 slot_vertices) {
+    // Unused vertices collapse into zero area triangles
+    for (; w->index < slot_vertices; ++w->index) {
+        w->positions[w->index] = (Vector2){0};
+        w->colors[w->index] = BLANK;
+    }
+}
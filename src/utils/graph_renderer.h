@@ -0,0 +1,91 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "defines.h"
+#include "node.h"
+#include "tline.h"
+
+typedef struct GraphBufferRange {
+        u32 first;
+        u32 count;
+} GraphBufferRange;
+
+// Fixed size vertex slots per element, uploaded to the GPU in dirty ranges
+typedef struct GraphBuffer {
+        u32 vao;
+        u32 position_vbo;
+        u32 color_vbo;
+        u32 slot_vertices;
+        u32 capacity;  // Number of slots
+        Vector2 *positions;
+        Color *colors;
+        GraphBufferRange *dirty;  // Darray
+} GraphBuffer;
+
+// One instance per node: center, radius and style (color index and flags)
+typedef struct NodeInstanceBuffer {
+        Shader shader;
+        i32 corner_loc;
+        i32 instance_loc;
+        i32 palette_loc;
+        u32 vao;
+        u32 quad_vbo;
+        u32 instance_vbo;
+        u32 capacity;  // Number of instances
+        Vector4 *instances;
+        GraphBufferRange *dirty;  // Darray
+} NodeInstanceBuffer;
+
+typedef struct NodeSlot {
+        Vector2 center;
+        float radius;
+        Color color;
+        u8 detail;
+        bool accepting_state;
+        bool initial_state;
+} NodeSlot;
+
+typedef struct TLineSlot {
+        Vector2 start;
+        Vector2 end;
+        float start_radius;
+        float end_radius;
+        Color color;
+        u8 detail;
+        bool self_loop;
+        u32 bundle_size;  // Tlines drawn by the slot, 0 when another does it
+} TLineSlot;
+
+// Below the full detail level the tlines from one node to another are drawn
+// as a single stroke, its width grows with the number of tlines
+typedef struct TLineBundle {
+        u32 lead;  // First tline with the same start and end
+        u32 size;  // Tlines in the bundle, only valid for the lead
+        u32 rank;  // Of the color, the most prominent state is drawn
+        Color color;
+} TLineBundle;
+
+typedef struct GraphRenderer {
+        bool instanced;  // Nodes are drawn with one instanced draw call
+        NodeInstanceBuffer node_instances;
+        GraphBuffer node_buffer;
+        GraphBuffer tline_buffer;
+        NodeSlot *node_slots;  // Darray
+        TLineSlot *tline_slots;  // Darray
+        TLineBundle *bundles;  // Darray, one per tline
+        u32 *bundle_table;  // Darray, lead tlines hashed by their nodes
+        u32 node_count;  // Number of valid node slots
+        u32 tline_count;  // Number of valid tline slots
+} GraphRenderer;
+
+void graph_renderer_create(GraphRenderer *gr);
+
+void graph_renderer_destroy(GraphRenderer *gr);
+
+// Forces every element to be rebuilt and uploaded on the next draw
+void graph_renderer_invalidate(GraphRenderer *gr);
+
+// Must be called between BeginMode2D and EndMode2D
+void graph_renderer_draw(GraphRenderer *gr, Node *nodes, TLine *tlines,
+                         float zoom);
@@ -0,0 +1,19 @@
+#include "hash.h"
+
+u32 fnv1a_32(u32 hash, const void *data, u64 size) {
+    const u8 *bytes = (const u8 *)data;
+    for (u64 i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+u64 fnv1a_64(u64 hash, const void *data, u64 size) {
+    const u8 *bytes = (const u8 *)data;
+    for (u64 i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "defines.h"
+
+// Starting values, longer inputs are hashed in parts by passing the result
+// of one part as the hash of the next
+#define FNV1A_32_OFFSET 2166136261u
+#define FNV1A_64_OFFSET 14695981039346656037ULL
+
+// FNV-1a, quick for short keys and checksums but not collision resistant
+u32 fnv1a_32(u32 hash, const void *data, u64 size);
+
+u64 fnv1a_64(u64 hash, const void *data, u64 size);
@@ -0,0 +1,229 @@
+#include "history.h"
+
+#include <string.h>
+
+#include "darray.h"
+#include "memory.h"
+
+// Of the records, so headers can be read in place
+#define HISTORY_ALIGNMENT 4
+
+static void history_stack_create(HistoryStack *hs) {
+    hs->records = darray_create_tagged(u8, MEMORY_TAG_ENGINE);
+    hs->entries = darray_create_tagged(HistoryEntry, MEMORY_TAG_ENGINE);
+}
+
+static void history_stack_destroy(HistoryStack *hs) {
+    darray_destroy(hs->records);
+    darray_destroy(hs->entries);
+    hs->records = NULL;
+    hs->entries = NULL;
+}
+
+static void history_stack_clear(HistoryStack *hs) {
+    if (hs->records) darray_clear(hs->records);
+    if (hs->entries) darray_clear(hs->entries);
+}
+
+void history_create(History *h) {
+    history_stack_create(&h->undo);
+    history_stack_create(&h->redo);
+    h->target = &h->undo;
+    h->source = NULL;
+    h->done = false;
+    h->open = false;
+    h->failed = false;
+}
+
+void history_destroy(History *h) {
+    history_stack_destroy(&h->undo);
+    history_stack_destroy(&h->redo);
+}
+
+void history_clear(History *h) {
+    history_stack_clear(&h->undo);
+    history_stack_clear(&h->redo);
+    h->target = &h->undo;
+    h->source = NULL;
+    h->open = false;
+    h->failed = false;
+}
+
+// Drops the oldest entries in one go once the stack is over the limit, so
+// the records are moved down only every quarter of the limit
+static void history_trim(HistoryStack *hs) {
+    u64 size = darray_get_size(hs->records);
+    if (size <= HISTORY_MEMORY_LIMIT) return;
+
+    // The entry that is being written is kept whatever its size
+    u64 count = darray_get_size(hs->entries);
+    u64 dropped = 0;
+    u64 keep = HISTORY_MEMORY_LIMIT / 4 * 3;
+    while (dropped + 1 < count && size - hs->entries[dropped].offset > keep)
+        dropped++;
+    if (!dropped) return;
+
+    u64 cut = hs->entries[dropped].offset;
+    memmove(hs->records, hs->records + cut, size - cut);
+    darray_truncate(hs->records, size - cut);
+
+    for (u64 i = dropped; i < count; ++i) {
+        hs->entries[i - dropped].offset = hs->entries[i].offset - cut;
+        hs->entries[i - dropped].last = hs->entries[i].last - cut;
+    }
+    darray_truncate(hs->entries, count - dropped);
+}
+
+// A stack with a missing record would undo the wrong elements, so it is
+// better to lose the history
+static void history_fail(History *h) {
+    TraceLog(LOG_WARNING, "Out of memory, the undo history is cleared");
+    if (h->source) {
+        h->failed = true;
+        return;
+    }
+    history_clear(h);
+}
+
+static void history_push(History *h, u32 type, u32 index, const void *fixed,
+                         u32 fixed_size, const char *text, u32 len) {
+    if (!h->target || !h->target->records) return;
+    HistoryStack *hs = h->target;
+
+    // A new edit makes what was undone unreachable
+    if (!h->source) history_stack_clear(&h->redo);
+
+    HistoryRecord record = {.type = type, .index = index,
+                            .size = fixed_size + len};
+    u64 offset = darray_get_size(hs->records);
+    u64 count = darray_get_size(hs->entries);
+    if (h->open) record.previous = offset - hs->entries[count - 1].last;
+
+    static const u8 zeros[HISTORY_ALIGNMENT] = {0};
+    u32 padding = -record.size & (HISTORY_ALIGNMENT - 1);
+    if (!darray_reserve(&hs->records,
+                        offset + sizeof(record) + record.size + padding)
+        || (!h->open && !darray_reserve(&hs->entries, count + 1))) {
+        history_fail(h);
+        return;
+    }
+
+    darray_push_n(&hs->records, &record, sizeof(record));
+    if (fixed_size) darray_push_n(&hs->records, fixed, fixed_size);
+    if (len) darray_push_n(&hs->records, text, len);
+    if (padding) darray_push_n(&hs->records, zeros, padding);
+
+    if (h->open) {
+        hs->entries[count - 1].last = offset;
+    } else {
+        HistoryEntry entry = {.offset = offset, .last = offset};
+        darray_push(&hs->entries, entry);
+        h->open = true;
+    }
+
+    if (hs == &h->undo && !h->source) history_trim(hs);
+}
+
+void history_move_node(History *h, u32 index, Vector2 center) {
+    // The first center of a drag is the one to return to
+    HistoryStack *hs = h->target;
+    if (h->open && hs && hs->entries) {
+        u64 count = darray_get_size(hs->entries);
+        const HistoryRecord *last =
+            (const HistoryRecord *)(hs->records + hs->entries[count - 1].last);
+        if (last->type == HISTORY_RECORD_MOVE_NODE && last->index == index)
+            return;
+    }
+
+    history_push(h, HISTORY_RECORD_MOVE_NODE, index, &center, sizeof(center),
+                 NULL, 0);
+}
+
+void history_add_node(History *h, u32 index) {
+    history_push(h, HISTORY_RECORD_ADD_NODE, index, NULL, 0, NULL, 0);
+}
+
+void history_change_node(History *h, u32 index, const HistoryNode *node,
+                         const char *name) {
+    history_push(h, HISTORY_RECORD_CHANGE_NODE, index, node, sizeof(*node),
+                 name, node->name_len);
+}
+
+void history_remove_node(History *h, u32 index, const HistoryNode *node,
+                         const char *name) {
+    history_push(h, HISTORY_RECORD_REMOVE_NODE, index, node, sizeof(*node),
+                 name, node->name_len);
+}
+
+void history_add_tline(History *h, u32 index) {
+    history_push(h, HISTORY_RECORD_ADD_TLINE, index, NULL, 0, NULL, 0);
+}
+
+void history_change_tline(History *h, u32 index, const HistoryTLine *tline,
+                          const char *inputs) {
+    history_push(h, HISTORY_RECORD_CHANGE_TLINE, index, tline, sizeof(*tline),
+                 inputs, tline->inputs_len);
+}
+
+void history_remove_tline(History *h, u32 index, const HistoryTLine *tline,
+                          const char *inputs) {
+    history_push(h, HISTORY_RECORD_REMOVE_TLINE, index, tline, sizeof(*tline),
+                 inputs, tline->inputs_len);
+}
+
+void history_alphabet(History *h, u32 fsm_type, const char *alphabet,
+                      u32 len) {
+    HistoryAlphabet ha = {.fsm_type = fsm_type, .len = len};
+    history_push(h, HISTORY_RECORD_ALPHABET, 0, &ha, sizeof(ha), alphabet,
+                 len);
+}
+
+void history_seal(History *h) {
+    if (!h->source) h->open = false;
+}
+
+static bool history_begin(History *h, HistoryStack *source,
+                          HistoryStack *target) {
+    if (h->source || !source->entries || !darray_get_size(source->entries))
+        return false;
+
+    u64 count = darray_get_size(source->entries);
+    h->source = source;
+    h->target = target;
+    h->cursor = source->entries[count - 1].last;
+    h->done = false;
+    h->open = false;
+    return true;
+}
+
+bool history_begin_undo(History *h) {
+    return history_begin(h, &h->undo, &h->redo);
+}
+
+bool history_begin_redo(History *h) {
+    return history_begin(h, &h->redo, &h->undo);
+}
+
+const HistoryRecord *history_next(History *h) {
+    if (!h->source || h->done || h->failed) return NULL;
+
+    const HistoryRecord *record =
+        (const HistoryRecord *)(h->source->records + h->cursor);
+    if (record->previous) h->cursor -= record->previous;
+    else h->done = true;
+    return record;
+}
+
+void history_end(History *h) {
+    HistoryStack *hs = h->source;
+    if (!hs) return;
+
+    u64 count = darray_get_size(hs->entries);
+    darray_truncate(hs->records, hs->entries[count - 1].offset);
+    darray_truncate(hs->entries, count - 1);
+
+    h->source = NULL;
+    h->target = &h->undo;
+    h->open = false;
+    if (h->failed) history_clear(h);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "defines.h"
+
+// Bytes of records the undo stack keeps, the oldest entries are dropped
+#define HISTORY_MEMORY_LIMIT (4 * 1024 * 1024)
+
+// Undo and redo stacks of the editor. Every change records how to undo it
+// before it is made, so an entry costs as much as the edit and not a copy of
+// the model. Records name nodes and tlines by index, the stacks only stay
+// valid while every edit is recorded
+
+typedef enum HistoryRecordType {
+    HISTORY_RECORD_MOVE_NODE,  // The old center
+    HISTORY_RECORD_ADD_NODE,  // Undone by removing the node
+    HISTORY_RECORD_CHANGE_NODE,  // HistoryNode and the old name
+    HISTORY_RECORD_REMOVE_NODE,  // The last node took the index
+    HISTORY_RECORD_ADD_TLINE,
+    HISTORY_RECORD_CHANGE_TLINE,  // HistoryTLine and the old inputs
+    HISTORY_RECORD_REMOVE_TLINE,  // The last tline took the index
+    HISTORY_RECORD_ALPHABET,  // HistoryAlphabet and the old alphabet
+} HistoryRecordType;
+
+// The payload follows the record
+typedef struct HistoryRecord {
+        u32 type;
+        u32 index;  // Of the node or tline
+        u32 size;  // Of the payload
+        u32 previous;  // Bytes back to the previous record of the entry
+} HistoryRecord;
+
+typedef struct HistoryNode {
+        Vector2 center;
+        u32 flags;  // FsmStateFlags
+        u32 name_len;
+} HistoryNode;
+
+typedef struct HistoryTLine {
+        u32 start;  // Node indices or FSM_TABLE_NONE
+        u32 end;
+        u32 inputs_len;
+} HistoryTLine;
+
+typedef struct HistoryAlphabet {
+        u32 fsm_type;
+        u32 len;
+} HistoryAlphabet;
+
+// The records of one user action
+typedef struct HistoryEntry {
+        u64 offset;  // Of the first record
+        u64 last;  // Of the last record
+} HistoryEntry;
+
+typedef struct HistoryStack {
+        u8 *records;  // Darray
+        HistoryEntry *entries;  // Darray
+} HistoryStack;
+
+typedef struct History {
+        HistoryStack undo;
+        HistoryStack redo;
+        HistoryStack *target;  // Takes the records, redo while undoing
+        HistoryStack *source;  // Whose last entry is replayed, or NULL
+        u64 cursor;  // Offset of the next record to replay
+        bool done;  // The first record of the entry was replayed
+        bool open;  // The last entry of the target takes the next record
+        bool failed;  // A record was lost while replaying
+} History;
+
+void history_create(History *h);
+
+void history_destroy(History *h);
+
+// For when the whole model is replaced
+void history_clear(History *h);
+
+// Moves of the node that follow in the same entry are coalesced
+void history_move_node(History *h, u32 index, Vector2 center);
+
+void history_add_node(History *h, u32 index);
+
+// The state of the node before it changes
+void history_change_node(History *h, u32 index, const HistoryNode *node,
+                         const char *name);
+
+// The state of the node before it is removed, its tlines are removed before
+void history_remove_node(History *h, u32 index, const HistoryNode *node,
+                         const char *name);
+
+void history_add_tline(History *h, u32 index);
+
+void history_change_tline(History *h, u32 index, const HistoryTLine *tline,
+                          const char *inputs);
+
+void history_remove_tline(History *h, u32 index, const HistoryTLine *tline,
+                          const char *inputs);
+
+// The alphabet and the type of the machine before they change
+void history_alphabet(History *h, u32 fsm_type, const char *alphabet,
+                      u32 len);
+
+// Ends the entry, the next record starts a new one
+void history_seal(History *h);
+
+// Starts replaying the last entry of the stack. What the replay changes is
+// recorded as an entry of the other stack
+bool history_begin_undo(History *h);
+
+bool history_begin_redo(History *h);
+
+// The records of the replayed entry from the newest, NULL after the first
+const HistoryRecord *history_next(History *h);
+
+// Drops the replayed entry
+void history_end(History *h);
@@ -2,8 +2,12 @@
 
 #include <stdlib.h>
 
+#include "memory.h"
+
 static void take_input_text(InputBox *ib);
 
+static i32 input_box_update_state(InputBox *ib, Vector2 mpos, i32 handled);
+
 void input_box_create(InputBox *ib, Rectangle rect, u32 max_len) {
     ib->rect = rect;
     ib->font_size = rect.height;
@@ -11,7 +15,8 @@ void input_box_create(InputBox *ib, Rectangle rect, u32 max_len) {
     ib->pressed = false;
     ib->index = 0;
     ib->max_len = max_len;
-    ib->text = (char *)calloc((max_len + 1), sizeof(char));
+    ib->text =
+        (char *)memory_calloc((max_len + 1), sizeof(char), MEMORY_TAG_UI);
     if (!ib->text) {
         TraceLog(LOG_ERROR, "Failed to allocate memory");
         ib->max_len = 0;
@@ -23,7 +28,9 @@ void input_box_create(InputBox *ib, Rectangle rect, u32 max_len) {
     input_box_set_font(ib, GetFontDefault());
     ib->colors = (InputBoxColors){.box = BLACK, .text = WHITE};
     ib->frame_counter = 0;
+    ib->generation = 0;
     ib->disabled = false;
+    ib->dirty = true;
 }
 
 void input_box_set_font(InputBox *ib, Font font) {
@@ -43,7 +50,7 @@ void input_box_set_font(InputBox *ib, Font font) {
 }
 
 void input_box_destroy(InputBox *ib) {
-    free(ib->text);
+    memory_free(ib->text);
 }
 
 void input_box_set_colors(InputBox *ib, InputBoxColors colors) {
@@ -69,11 +76,26 @@ void input_box_draw(InputBox *ib) {
 
     DrawTextEx(ib->font, &ib->text[idx], ib->position, ib->font_size, 1.0f,
                Fade(ib->colors.text, alpha));
+    ib->dirty = false;
 }
 
 i32 input_box_update(InputBox *ib, Vector2 mpos, i32 handled) {
     if (ib->disabled) return handled;
-    ib->frame_counter++;
+
+    bool focused = ib->focused;
+    u32 generation = ib->generation;
+    u32 blink = (ib->frame_counter++ / 20) % 2;
+
+    handled = input_box_update_state(ib, mpos, handled);
+
+    if (ib->focused != focused || ib->generation != generation
+        || (ib->focused && (ib->frame_counter / 20) % 2 != blink))
+        ib->dirty = true;
+
+    return handled;
+}
+
+static i32 input_box_update_state(InputBox *ib, Vector2 mpos, i32 handled) {
     if (ib->focused && !IS_INPUT_HANDLED(handled, INPUT_KEYSTROKES)) {
         SetMouseCursor(MOUSE_CURSOR_IBEAM);
         // TraceLog(LOG_INFO, "Waiting for input!");
@@ -124,13 +146,16 @@ static void take_input_text(InputBox *ib) {
         if ((key >= 32 && key <= 126) && ib->index < ib->max_len) {
             ib->text[ib->index++] = key;
             ib->text[ib->index] = 0;
+            ib->generation++;
         }
     }
     if (IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE)) {
+        u32 index = ib->index;
         if (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))
             ib->index = 0;
         if (ib->index > 0) ib->index--;
         ib->text[ib->index] = 0;
+        if (ib->index != index) ib->generation++;
     }
 }
 
@@ -144,12 +169,16 @@ void input_box_set_text(InputBox *ib, const char *text, u32 len) {
     for (ib->index = 0; ib->index < len && ib->index < ib->max_len; ++ib->index)
         ib->text[ib->index] = text[ib->index];
     ib->text[ib->index] = 0;
+    ib->generation++;
+    ib->dirty = true;
 }
 
 void input_box_append_text(InputBox *ib, const char *text, u32 len) {
     for (u32 i = 0; i < len && ib->index < ib->max_len; ++ib->index, ++i)
         ib->text[ib->index] = text[i];
     ib->text[ib->index] = 0;
+    ib->generation++;
+    ib->dirty = true;
 }
 
 void input_box_append_text_at(InputBox *ib, const char *text, u32 len,
@@ -159,12 +188,16 @@ void input_box_append_text_at(InputBox *ib, const char *text, u32 len,
          ++i, ++ib->index)
         ib->text[ib->index] = text[i];
     ib->text[ib->index] = 0;
+    ib->generation++;
+    ib->dirty = true;
 }
 
 void input_box_disable(InputBox *ib) {
     ib->disabled = true;
+    ib->dirty = true;
 }
 
 void input_box_enable(InputBox *ib) {
     ib->disabled = false;
+    ib->dirty = true;
 }
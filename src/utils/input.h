@@ -23,6 +23,8 @@ typedef struct InputBox {
         char *text;
         u32 chars_to_show;
         u32 frame_counter;
+        u32 generation;  // Incremented every time the text changes
+        bool dirty;  // Changed since it was last drawn
 } InputBox;
 
 void input_box_create(InputBox *ib, Rectangle rect, u32 max_len);
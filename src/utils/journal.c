@@ -0,0 +1,571 @@
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "file_io.h"
+#include "fsm_file.h"
+#include "funcs.h"
+#include "hash.h"
+#include "memory.h"
+#include "table.h"
+#include "worker.h"
+
+#define JOURNAL_PATH_SIZE 1024
+
+typedef enum JournalJobType {
+    JOURNAL_JOB_FLUSH,
+    JOURNAL_JOB_COMPACT,
+} JournalJobType;
+
+typedef struct JournalJob {
+        Job job;
+        JournalJobType type;
+        FILE *file;  // The open journal, a compaction replaces it
+        u8 *records;  // Darray, appended to the journal by flushes
+        GlobalState model;  // Written as the snapshot by compactions
+        u64 generation;  // Of the snapshot that is written
+        u64 old_generation;  // Removed once the new journal is in place
+        bool succeeded;
+} JournalJob;
+
+static char directory[JOURNAL_PATH_SIZE];
+static bool enabled = false;  // The directory exists
+static bool started = false;  // Edits are recorded
+static bool recovered = false;
+static bool compact_requested = false;
+static FILE *file = NULL;  // Only touched by the job in flight
+static u64 generation = 0;  // Snapshots start at 1
+static u64 journal_size = 0;  // Bytes written since the snapshot
+static u8 *pending = NULL;  // Darray of records not handed to a job yet
+static u64 last_record;  // Offset of the last pending record
+static bool can_coalesce = false;
+static double flush_time;
+static JournalJob *running = NULL;
+static CompletionQueue completed_jobs;
+
+static u32 journal_checksum(const JournalRecord *record, const u8 *payload) {
+    JournalRecord header = *record;
+    header.checksum = 0;
+    u32 hash = fnv1a_32(FNV1A_32_OFFSET, &header, sizeof(header));
+    return fnv1a_32(hash, payload, record->size);
+}
+
+// The XDG state directory, or the local application data on Windows
+static bool journal_get_directory(char *path, u64 size) {
+    const char *base;
+    const char *suffix;
+#if defined(_WIN32)
+    base = getenv("LOCALAPPDATA");
+    suffix = "\\StateFlow\\autosave";
+#else
+    base = getenv("XDG_STATE_HOME");
+    suffix = "/stateflow";
+    if (!base || !*base) {
+        base = getenv("HOME");
+        suffix = "/.local/state/stateflow";
+    }
+#endif
+    if (!base || !*base) return false;
+
+    int len = snprintf(path, size, "%s%s", base, suffix);
+    return len > 0 && (u64)len < size;
+}
+
+static bool journal_get_path(char *path, u64 size) {
+    int len = snprintf(path, size, "%s/autosave.journal", directory);
+    return len > 0 && (u64)len < size;
+}
+
+static bool journal_get_snapshot_path(char *path, u64 size, u64 generation) {
+    int len = snprintf(path, size, "%s/autosave-%llu.fsm", directory,
+                       (unsigned long long)generation);
+    return len > 0 && (u64)len < size;
+}
+
+static bool journal_enable(void) {
+    if (enabled) return true;
+
+    if (!journal_get_directory(directory, sizeof(directory))
+        || !file_make_directory(directory)) {
+        TraceLog(LOG_WARNING, "No autosave directory, edits are not kept");
+        return false;
+    }
+
+    pending = darray_create_tagged(u8, MEMORY_TAG_ENGINE);
+    if (!pending) return false;
+
+    enabled = true;
+    return true;
+}
+
+// Consecutive changes of the same node or tline replace each other while
+// they wait, so dragging a node leaves a single record
+static void journal_append(u32 type, u32 index, const void *fixed,
+                           u32 fixed_size, const char *text, u32 len) {
+    if (!started) return;
+
+    JournalRecord record = {.type = type,
+                            .index = index,
+                            .size = fixed_size + len};
+    u32 hash = fnv1a_32(FNV1A_32_OFFSET, &record, sizeof(record));
+    hash = fnv1a_32(hash, fixed, fixed_size);
+    record.checksum = fnv1a_32(hash, text, len);
+
+    u64 count = darray_get_size(pending);
+    u64 size = sizeof(record) + record.size;
+    if (can_coalesce && count - last_record == size
+        && (type == JOURNAL_RECORD_NODE || type == JOURNAL_RECORD_TLINE)) {
+        JournalRecord last;
+        memcpy(&last, pending + last_record, sizeof(last));
+        if (last.type == type && last.index == index) {
+            u8 *dst = pending + last_record;
+            memcpy(dst, &record, sizeof(record));
+            memcpy(dst + sizeof(record), fixed, fixed_size);
+            if (len) memcpy(dst + sizeof(record) + fixed_size, text, len);
+            return;
+        }
+    }
+
+    // A lost record would break the replay, the snapshot covers it instead
+    if (!darray_reserve(&pending, count + size)) {
+        compact_requested = true;
+        return;
+    }
+
+    if (!count) flush_time = GetTime() + JOURNAL_FLUSH_INTERVAL;
+    darray_push_n(&pending, &record, sizeof(record));
+    darray_push_n(&pending, fixed, fixed_size);
+    if (len) darray_push_n(&pending, text, len);
+    last_record = count;
+    can_coalesce = true;
+}
+
+void journal_node(GlobalState *gs, u64 index) {
+    Node *node = &gs->nodes[index];
+    JournalNode jn = {
+        .x = node->center.x,
+        .y = node->center.y,
+        .flags = (node->initial_state ? FSM_STATE_INITIAL : 0)
+               | (node->accepting_state ? FSM_STATE_ACCEPTING : 0),
+        .name_len = node->name.len,
+    };
+    journal_append(JOURNAL_RECORD_NODE, index, &jn, sizeof(jn),
+                   small_string_get(&node->name), node->name.len);
+}
+
+void journal_remove_node(u64 index) {
+    journal_append(JOURNAL_RECORD_REMOVE_NODE, index, NULL, 0, NULL, 0);
+}
+
+void journal_tline(GlobalState *gs, u64 index) {
+    TLine *tl = &gs->tlines[index];
+    JournalTLine jt = {
+        .start = tl->start ? tl->start - gs->nodes : FSM_TABLE_NONE,
+        .end = tl->end ? tl->end - gs->nodes : FSM_TABLE_NONE,
+        .inputs_len = tl->inputs.len,
+    };
+    journal_append(JOURNAL_RECORD_TLINE, index, &jt, sizeof(jt),
+                   small_string_get(&tl->inputs), tl->inputs.len);
+}
+
+void journal_remove_tline(u64 index) {
+    journal_append(JOURNAL_RECORD_REMOVE_TLINE, index, NULL, 0, NULL, 0);
+}
+
+void journal_alphabet(GlobalState *gs) {
+    JournalAlphabet ja = {.fsm_type = gs->fsm_type,
+                          .len = gs->alphabet_len};
+    journal_append(JOURNAL_RECORD_ALPHABET, 0, &ja, sizeof(ja), gs->alphabet,
+                   gs->alphabet_len);
+}
+
+static bool journal_write_records(JournalJob *jj) {
+    u64 size = darray_get_size(jj->records);
+    return jj->file && fwrite(jj->records, 1, size, jj->file) == size
+        && file_sync(jj->file);
+}
+
+// The new journal replaces the old one before the old snapshot is removed,
+// so a crash at any point leaves a snapshot and a journal that belong
+// together
+static bool journal_write_snapshot(JournalJob *jj) {
+    char path[JOURNAL_PATH_SIZE];
+    if (!journal_get_snapshot_path(path, sizeof(path), jj->generation)
+        || !fsm_file_store(&jj->model, path, NULL))
+        return false;
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.generation = jj->generation;
+
+    char journal_path[JOURNAL_PATH_SIZE];
+    if (!journal_get_path(journal_path, sizeof(journal_path))
+        || !file_write_atomic(journal_path, &header, sizeof(header)))
+        return false;
+
+    if (jj->file) fclose(jj->file);
+    jj->file = fopen(journal_path, "ab");
+
+    if (jj->old_generation
+        && journal_get_snapshot_path(path, sizeof(path), jj->old_generation))
+        remove(path);
+
+    return jj->file != NULL;
+}
+
+static void journal_run(Job *job) {
+    JournalJob *jj = (JournalJob *)job->data;
+
+    if (jj->type == JOURNAL_JOB_COMPACT)
+        jj->succeeded = journal_write_snapshot(jj);
+    else
+        jj->succeeded = journal_write_records(jj);
+
+    job_set_progress(job, job->total);
+}
+
+static JournalJob *journal_create_job(JournalJobType type) {
+    JournalJob *jj = (JournalJob *)memory_calloc(1, sizeof(JournalJob),
+                                                 MEMORY_TAG_ENGINE);
+    if (!jj) return NULL;
+
+    jj->type = type;
+    job_init(&jj->job, journal_run, jj, &completed_jobs);
+    return jj;
+}
+
+static void journal_destroy_job(JournalJob *jj) {
+    darray_destroy(jj->records);
+    destroy_fsm(&jj->model);
+    memory_free(jj);
+}
+
+static void journal_submit(GlobalState *gs, JournalJob *jj) {
+    // The job owns the file until it comes back
+    jj->file = file;
+    file = NULL;
+    can_coalesce = false;
+    running = jj;
+    worker_pool_submit(&gs->workers, &jj->job);
+}
+
+static void journal_start_compaction(GlobalState *gs) {
+    JournalJob *jj = journal_create_job(JOURNAL_JOB_COMPACT);
+    if (!jj || !copy_fsm(&jj->model, gs)) {
+        if (jj) journal_destroy_job(jj);
+        TraceLog(LOG_ERROR, "Failed to copy the machine, autosave is off");
+        started = false;
+        return;
+    }
+
+    // Everything waiting is part of the snapshot
+    jj->generation = generation + 1;
+    jj->old_generation = generation;
+    darray_clear(pending);
+    compact_requested = false;
+    journal_submit(gs, jj);
+}
+
+static void journal_start_flush(GlobalState *gs) {
+    JournalJob *jj = journal_create_job(JOURNAL_JOB_FLUSH);
+    u8 *records = darray_create_tagged(u8, MEMORY_TAG_ENGINE);
+    if (!jj || !records) {
+        if (jj) journal_destroy_job(jj);
+        darray_destroy(records);
+        return;
+    }
+
+    jj->records = pending;
+    pending = records;
+    journal_submit(gs, jj);
+}
+
+void journal_start(GlobalState *gs) {
+    UNUSED(gs);
+    if (!journal_enable()) return;
+
+    started = true;
+    compact_requested = true;
+}
+
+void journal_update(GlobalState *gs) {
+    if (!enabled) return;
+
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        JournalJob *jj = (JournalJob *)job->data;
+        file = jj->file;
+        running = NULL;
+
+        if (jj->succeeded && jj->type == JOURNAL_JOB_COMPACT) {
+            generation = jj->generation;
+            journal_size = sizeof(JournalHeader);
+        } else if (jj->succeeded) {
+            journal_size += darray_get_size(jj->records);
+        } else if (jj->type == JOURNAL_JOB_FLUSH) {
+            // A torn record would hide the ones after it, start over
+            TraceLog(LOG_WARNING, "Failed to write the autosave journal");
+            compact_requested = true;
+        } else {
+            TraceLog(LOG_ERROR, "Failed to write the autosave, it is off");
+            started = false;
+        }
+
+        journal_destroy_job(jj);
+    }
+
+    if (running || !started) return;
+
+    if (compact_requested || journal_size > JOURNAL_COMPACT_SIZE)
+        journal_start_compaction(gs);
+    else if (darray_get_size(pending) && GetTime() >= flush_time)
+        journal_start_flush(gs);
+}
+
+bool journal_is_busy(void) {
+    return started && (running || darray_get_size(pending));
+}
+
+static bool journal_push_node(GlobalState *gs) {
+    Node node;
+    node_create(&node, (Vector2){0});
+    node_set_font(&node, gs->font, 32);
+
+    Node *old_nodes = gs->nodes;
+    if (!darray_push(&gs->nodes, node)) return false;
+    if (gs->nodes == old_nodes) return true;
+
+    u64 length = darray_get_size(gs->tlines);
+    for (u64 i = 0; i < length; ++i) {
+        TLine *tl = &gs->tlines[i];
+        if (tl->start) tl->start = gs->nodes + (tl->start - old_nodes);
+        if (tl->end) tl->end = gs->nodes + (tl->end - old_nodes);
+    }
+    return true;
+}
+
+static bool journal_apply_node(GlobalState *gs, const JournalRecord *record,
+                               const u8 *payload) {
+    JournalNode jn;
+    if (record->size < sizeof(jn)) return false;
+    memcpy(&jn, payload, sizeof(jn));
+
+    u64 count = darray_get_size(gs->nodes);
+    if (record->size - sizeof(jn) != jn.name_len || record->index > count)
+        return false;
+    if (record->index == count && !journal_push_node(gs)) return false;
+
+    Node *node = &gs->nodes[record->index];
+    const char *name = (const char *)payload + sizeof(jn);
+    node->position.x += jn.x - node->center.x;
+    node->position.y += jn.y - node->center.y;
+    node->center = (Vector2){jn.x, jn.y};
+    if (node->name.len != jn.name_len
+        || memcmp(small_string_get(&node->name), name, jn.name_len))
+        node_set_name(node, &gs->strings, name, jn.name_len);
+    node->initial_state = jn.flags & FSM_STATE_INITIAL;
+    node->accepting_state = jn.flags & FSM_STATE_ACCEPTING;
+    return true;
+}
+
+// The tlines of the node were removed by the records before
+static bool journal_apply_remove_node(GlobalState *gs, u32 index) {
+    u64 count = darray_get_size(gs->nodes);
+    if (index >= count) return false;
+
+    Node *node = &gs->nodes[index];
+    Node *moved = &gs->nodes[count - 1];
+    u64 length = darray_get_size(gs->tlines);
+    for (u64 i = 0; i < length; ++i) {
+        TLine *tl = &gs->tlines[i];
+        if (tl->start == node || tl->end == node) return false;
+        if (tl->start == moved) tl->start = node;
+        if (tl->end == moved) tl->end = node;
+    }
+
+    node_destroy(node);
+    darray_swap_remove(&gs->nodes, index, NULL);
+    return true;
+}
+
+static bool journal_apply_tline(GlobalState *gs, const JournalRecord *record,
+                                const u8 *payload) {
+    JournalTLine jt;
+    if (record->size < sizeof(jt)) return false;
+    memcpy(&jt, payload, sizeof(jt));
+
+    u64 count = darray_get_size(gs->tlines);
+    u64 node_count = darray_get_size(gs->nodes);
+    if (record->size - sizeof(jt) != jt.inputs_len || record->index > count
+        || (jt.start != FSM_TABLE_NONE && jt.start >= node_count)
+        || (jt.end != FSM_TABLE_NONE && jt.end >= node_count))
+        return false;
+
+    if (record->index == count) {
+        TLine tline;
+        tline_create(&tline);
+        tline_set_font(&tline, gs->font);
+        if (!darray_push(&gs->tlines, tline)) return false;
+    }
+
+    TLine *tl = &gs->tlines[record->index];
+    Node *start = jt.start == FSM_TABLE_NONE ? NULL : &gs->nodes[jt.start];
+    Node *end = jt.end == FSM_TABLE_NONE ? NULL : &gs->nodes[jt.end];
+    tline_set_start_node(tl, start);
+    tline_set_end_node(tl, end);
+    tline_set_inputs(tl, &gs->strings, (const char *)payload + sizeof(jt),
+                     jt.inputs_len);
+    return true;
+}
+
+static bool journal_apply_alphabet(GlobalState *gs,
+                                   const JournalRecord *record,
+                                   const u8 *payload) {
+    JournalAlphabet ja;
+    if (record->size < sizeof(ja)) return false;
+    memcpy(&ja, payload, sizeof(ja));
+    if (record->size - sizeof(ja) != ja.len || ja.fsm_type >= FSM_TYPE_MAX)
+        return false;
+
+    char *alphabet = NULL;
+    if (ja.len) {
+        alphabet = (char *)memory_alloc(ja.len + 1, MEMORY_TAG_STRINGS);
+        if (!alphabet) return false;
+        memcpy(alphabet, payload + sizeof(ja), ja.len);
+        alphabet[ja.len] = 0;
+    }
+
+    memory_free(gs->alphabet);
+    gs->alphabet = alphabet;
+    gs->alphabet_len = ja.len;
+    gs->fsm_type = ja.fsm_type;
+    return true;
+}
+
+static bool journal_apply(GlobalState *gs, const JournalRecord *record,
+                          const u8 *payload) {
+    switch (record->type) {
+        case JOURNAL_RECORD_NODE:
+            return journal_apply_node(gs, record, payload);
+        case JOURNAL_RECORD_REMOVE_NODE:
+            return !record->size
+                && journal_apply_remove_node(gs, record->index);
+        case JOURNAL_RECORD_TLINE:
+            return journal_apply_tline(gs, record, payload);
+        case JOURNAL_RECORD_REMOVE_TLINE:
+            if (record->size || record->index >= darray_get_size(gs->tlines))
+                return false;
+            tline_destroy(&gs->tlines[record->index]);
+            darray_swap_remove(&gs->tlines, record->index, NULL);
+            return true;
+        case JOURNAL_RECORD_ALPHABET:
+            return journal_apply_alphabet(gs, record, payload);
+        default:
+            return false;
+    }
+}
+
+// Stops at the first record that was cut off or does not fit the model
+static u64 journal_replay(GlobalState *gs, const u8 *data, u64 size) {
+    u64 offset = 0;
+    u64 count = 0;
+    while (size - offset >= sizeof(JournalRecord)) {
+        JournalRecord record;
+        memcpy(&record, data + offset, sizeof(record));
+        const u8 *payload = data + offset + sizeof(record);
+        if (record.size > size - offset - sizeof(record)
+            || journal_checksum(&record, payload) != record.checksum
+            || !journal_apply(gs, &record, payload))
+            break;
+
+        offset += sizeof(record) + record.size;
+        count++;
+    }
+
+    if (offset < size)
+        TraceLog(LOG_WARNING, "Dropped %llu bytes of unfinished autosave",
+                 (unsigned long long)(size - offset));
+
+    snapshot_store_mark_all(&gs->snapshots);
+    gs->version++;
+    return count;
+}
+
+bool journal_recover(GlobalState *gs) {
+    if (!journal_enable()) return false;
+
+    char path[JOURNAL_PATH_SIZE];
+    MappedFile mf;
+    if (!journal_get_path(path, sizeof(path))
+        || !mapped_file_open(&mf, path))
+        return false;
+
+    bool loaded = false;
+    JournalHeader header;
+    if (mf.size < sizeof(header)) goto done;
+    memcpy(&header, mf.data, sizeof(header));
+    if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic))
+        || header.version != JOURNAL_VERSION || !header.generation)
+        goto done;
+
+    char snapshot_path[JOURNAL_PATH_SIZE];
+    if (!journal_get_snapshot_path(snapshot_path, sizeof(snapshot_path),
+                                   header.generation)
+        || !load_fsm_from_file(gs, snapshot_path, NULL))
+        goto done;
+
+    u64 count =
+        journal_replay(gs, mf.data + sizeof(header), mf.size - sizeof(header));
+    TraceLog(LOG_INFO, "Recovered the autosave and %llu edits after it",
+             (unsigned long long)count);
+
+    // The next compaction replaces these files
+    generation = header.generation;
+    recovered = true;
+    loaded = true;
+
+done:
+    mapped_file_close(&mf);
+    return loaded;
+}
+
+bool journal_take_recovered(void) {
+    bool result = recovered;
+    recovered = false;
+    return result;
+}
+
+void journal_shutdown(void) {
+    if (!enabled) return;
+
+    Job *job;
+    while ((job = completion_queue_pop(&completed_jobs))) {
+        JournalJob *jj = (JournalJob *)job->data;
+        file = jj->file;
+        journal_destroy_job(jj);
+    }
+    running = NULL;
+
+    if (file) fclose(file);
+    file = NULL;
+
+    // A clean exit leaves nothing to recover. A recovered machine that was
+    // never opened is kept for the next start
+    char path[JOURNAL_PATH_SIZE];
+    if (started) {
+        if (journal_get_path(path, sizeof(path))) remove(path);
+        if (generation
+            && journal_get_snapshot_path(path, sizeof(path), generation))
+            remove(path);
+    }
+
+    darray_destroy(pending);
+    pending = NULL;
+    enabled = false;
+    started = false;
+}
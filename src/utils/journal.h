@@ -0,0 +1,90 @@
+#pragma once
+
+#include "defines.h"
+#include "stateflow.h"
+
+#define JOURNAL_MAGIC "SFSJ"
+#define JOURNAL_VERSION 1
+
+// Seconds an edit may wait before it is written out
+#define JOURNAL_FLUSH_INTERVAL 1.0
+// Journal size after which it is folded into a new snapshot
+#define JOURNAL_COMPACT_SIZE (4 * 1024 * 1024)
+
+// The autosave is a binary snapshot of the machine and a journal of the
+// edits made since. Edits are appended by a worker, so saving costs as much
+// as the edit. Once the journal has grown large it is compacted into a new
+// snapshot. Both are removed on a clean exit, what is left after a crash is
+// recovered on the next start
+
+// Values are stored in the byte order of the machine that wrote the journal
+typedef struct JournalHeader {
+        char magic[4];
+        u32 version;
+        u64 generation;  // Of the snapshot the records apply to
+} JournalHeader;
+
+typedef enum JournalRecordType {
+    JOURNAL_RECORD_NODE,  // JournalNode and the name
+    JOURNAL_RECORD_REMOVE_NODE,  // The last node takes the index
+    JOURNAL_RECORD_TLINE,  // JournalTLine and the inputs
+    JOURNAL_RECORD_REMOVE_TLINE,  // The last tline takes the index
+    JOURNAL_RECORD_ALPHABET,  // JournalAlphabet and the alphabet
+    JOURNAL_RECORD_MAX
+} JournalRecordType;
+
+// Records are replayed up to the first one that was not completely written
+typedef struct JournalRecord {
+        u32 type;
+        u32 index;  // Of the node or tline, the count appends a new one
+        u32 size;  // Of the payload
+        u32 checksum;  // FNV-1a of the record with this zeroed and the payload
+} JournalRecord;
+
+typedef struct JournalNode {
+        float x;
+        float y;
+        u32 flags;  // FsmStateFlags
+        u32 name_len;
+} JournalNode;
+
+typedef struct JournalTLine {
+        u32 start;  // Node indices
+        u32 end;
+        u32 inputs_len;
+} JournalTLine;
+
+typedef struct JournalAlphabet {
+        u32 fsm_type;
+        u32 len;
+} JournalAlphabet;
+
+// Reads the autosave left by a crash into the empty model
+bool journal_recover(GlobalState *gs);
+
+// True once after a recovery
+bool journal_take_recovered(void);
+
+// Starts journaling the model, which is snapshotted first
+void journal_start(GlobalState *gs);
+
+// The node or tline was added or changed
+void journal_node(GlobalState *gs, u64 index);
+
+void journal_remove_node(u64 index);
+
+void journal_tline(GlobalState *gs, u64 index);
+
+void journal_remove_tline(u64 index);
+
+// The alphabet or the type of the machine changed
+void journal_alphabet(GlobalState *gs);
+
+// Writes out the edits and compacts, called once per frame
+void journal_update(GlobalState *gs);
+
+// Edits are waiting to be written
+bool journal_is_busy(void);
+
+// Removes the autosave, the worker pool must be destroyed first
+void journal_shutdown(void);
@@ -0,0 +1,98 @@
+#include "memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+// Keeps the memory after it aligned like malloc
+typedef struct MemoryHeader {
+        u64 size;
+        u64 tag;
+} MemoryHeader;
+
+typedef struct MemoryCounters {
+        volatile u64 live_bytes;
+        volatile u64 peak_bytes;
+        volatile u64 live_allocations;
+        volatile u64 total_allocations;
+} MemoryCounters;
+
+static MemoryCounters counters[MEMORY_TAG_MAX];
+
+static const char *tag_names[MEMORY_TAG_MAX] = {
+    [MEMORY_TAG_NODES] = "Nodes",
+    [MEMORY_TAG_TLINES] = "Tlines",
+    [MEMORY_TAG_STRINGS] = "Strings",
+    [MEMORY_TAG_UI] = "UI",
+    [MEMORY_TAG_ENGINE] = "Engine",
+};
+
+static void memory_track(MemoryTag tag, u64 size) {
+    MemoryCounters *c = &counters[tag];
+    u64 live = sync_add_u64(&c->live_bytes, size) + size;
+
+    u64 peak = sync_load_u64(&c->peak_bytes);
+    while (live > peak && !sync_cas_u64(&c->peak_bytes, peak, live))
+        peak = sync_load_u64(&c->peak_bytes);
+}
+
+void *memory_alloc(u64 size, MemoryTag tag) {
+    MemoryHeader *header = (MemoryHeader *)malloc(sizeof(MemoryHeader) + size);
+    if (!header) return NULL;
+    header->size = size;
+    header->tag = tag;
+
+    memory_track(tag, size);
+    sync_add_u64(&counters[tag].live_allocations, 1);
+    sync_add_u64(&counters[tag].total_allocations, 1);
+
+    return header + 1;
+}
+
+void *memory_calloc(u64 count, u64 size, MemoryTag tag) {
+    if (size && count > UINT64_MAX / size) return NULL;
+    void *ptr = memory_alloc(count * size, tag);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void *memory_realloc(void *ptr, u64 size, MemoryTag tag) {
+    if (!ptr) return memory_alloc(size, tag);
+
+    MemoryHeader *header = (MemoryHeader *)ptr - 1;
+    u64 old_size = header->size;
+    header = (MemoryHeader *)realloc(header, sizeof(MemoryHeader) + size);
+    if (!header) return NULL;
+    header->size = size;
+
+    // Counted as a free of the old size followed by a new block
+    sync_add_u64(&counters[header->tag].live_bytes, -old_size);
+    memory_track((MemoryTag)header->tag, size);
+    sync_add_u64(&counters[header->tag].total_allocations, 1);
+
+    return header + 1;
+}
+
+void memory_free(void *ptr) {
+    if (!ptr) return;
+
+    MemoryHeader *header = (MemoryHeader *)ptr - 1;
+    sync_add_u64(&counters[header->tag].live_bytes, -header->size);
+    sync_add_u64(&counters[header->tag].live_allocations, (u64)-1);
+    free(header);
+}
+
+MemoryStats memory_get_stats(MemoryTag tag) {
+    MemoryCounters *c = &counters[tag];
+    return (MemoryStats){
+        .live_bytes = sync_load_u64(&c->live_bytes),
+        .peak_bytes = sync_load_u64(&c->peak_bytes),
+        .live_allocations = sync_load_u64(&c->live_allocations),
+        .total_allocations = sync_load_u64(&c->total_allocations),
+    };
+}
+
+const char *memory_get_tag_name(MemoryTag tag) {
+    return tag < MEMORY_TAG_MAX ? tag_names[tag] : "Unknown";
+}
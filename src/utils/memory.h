@@ -0,0 +1,35 @@
+#pragma once
+
+#include "defines.h"
+
+typedef enum MemoryTag {
+    MEMORY_TAG_NODES,
+    MEMORY_TAG_TLINES,
+    MEMORY_TAG_STRINGS,  // Names, inputs, alphabets and loaded text
+    MEMORY_TAG_UI,  // Widgets and per-frame scratch memory
+    MEMORY_TAG_ENGINE,  // Compiled tables, traces and untagged darrays
+    MEMORY_TAG_MAX
+} MemoryTag;
+
+typedef struct MemoryStats {
+        u64 live_bytes;
+        u64 peak_bytes;
+        u64 live_allocations;
+        u64 total_allocations;  // Since the start of the program
+} MemoryStats;
+
+// Counted allocations, the memory must be released with memory_free and can
+// be used from any thread. Every block carries its size and tag in front of
+// it, so it can not be mixed up with the plain allocator functions
+void *memory_alloc(u64 size, MemoryTag tag);
+
+void *memory_calloc(u64 count, u64 size, MemoryTag tag);
+
+// The tag is only used when ptr is NULL, blocks keep their tag
+void *memory_realloc(void *ptr, u64 size, MemoryTag tag);
+
+void memory_free(void *ptr);
+
+MemoryStats memory_get_stats(MemoryTag tag);
+
+const char *memory_get_tag_name(MemoryTag tag);
@@ -42,7 +42,7 @@ NfaState is_nfa_valid(Node *nodes, TLine *tlines, const char *alphabet) {
     u64 tlines_length = darray_get_size(tlines);
 
     for (u64 i = 0; i < tlines_length; ++i)
-        if (!all_chars_present(alphabet, tlines[i].inputs))
+        if (!all_chars_present(alphabet, small_string_get(&tlines[i].inputs)))
             return NFA_STATE_INPUT_INVALID;
 
     for (u64 i = 0; i < nodes_length; ++i) {
@@ -70,13 +70,36 @@ Node **nfa_transition(Node *current_state, Node **states /*returned*/,
     char input_str[2] = {input, 0};
     for (u64 i = 0; i < tlines_length; ++i) {
         if (tlines[i].start == current_state
-            && all_chars_present(tlines[i].inputs, input_str)) {
+            && all_chars_present(small_string_get(&tlines[i].inputs),
+                                 input_str)) {
+            bool present = false;
             u64 length = darray_get_size(states);
-            for (u64 j = 0; j < length; ++j)
-                if (states[j] == tlines[i].end) continue;
-            darray_push(&states, tlines[i].end);
+            for (u64 j = 0; j < length && !present; ++j)
+                present = states[j] == tlines[i].end;
+            if (!present) darray_push(&states, tlines[i].end);
         }
     }
 
     return states;
 }
+
+Node **nfa_run(Node **states, TLine *tlines, const char *input, u64 len) {
+    u64 tlines_length = darray_get_size(tlines);
+    Node **next_states = darray_create(Node *);
+
+    for (u64 i = 0; i < len && darray_get_size(states); ++i) {
+        darray_clear(next_states);
+        u64 length = darray_get_size(states);
+        for (u64 j = 0; j < length; ++j)
+            next_states = nfa_transition(states[j], next_states, tlines,
+                                         tlines_length, input[i]);
+
+        Node **tmp = states;
+        states = next_states;
+        next_states = tmp;
+    }
+
+    darray_destroy(next_states);
+
+    return states;
+}
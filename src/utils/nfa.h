@@ -16,4 +16,8 @@ typedef enum NfaState {
 Node **nfa_transition(Node *current_state, Node **states /* returned */,
                       TLine *tlines, u64 tlines_length, char input);
 
+// Replaces the given set of states with the set after consuming the input
+Node **nfa_run(Node **states /* returned */, TLine *tlines, const char *input,
+               u64 len);
+
 NfaState is_nfa_valid(Node *nodes, TLine *tlines, const char *alphabet);
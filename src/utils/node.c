@@ -1,8 +1,8 @@
 #include "node.h"
 
 #include <raymath.h>
-#include <stdlib.h>
-#include <string.h>
+
+#include "text_layout.h"
 
 #define NODE_MINIMUM_RADIUS 50.0f
 
@@ -17,8 +17,7 @@ void node_create(Node *n, Vector2 center) {
     n->position = n->center;
     n->font = GetFontDefault();
     n->font_size = 30;
-    n->name = NULL;
-    n->name_length = 0;
+    small_string_create(&n->name);
     n->state = NODE_STATE_NORMAL;
     n->colors = (NodeColors){.normal = BLUE,
                              .hovered = DARKBLUE,
@@ -34,27 +33,21 @@ void node_create(Node *n, Vector2 center) {
 }
 
 void node_destroy(Node *n) {
-    free(n->name);
+    // The name is freed with the arena of the model
+    UNUSED(n);
 }
 
-void node_set_name(Node *n, const char *name, u32 len) {
+void node_set_name(Node *n, Arena *arena, const char *name, u32 len) {
     if (!len) {
         n->radius = NODE_MINIMUM_RADIUS;
-        free(n->name);
-        n->name = NULL;
-        n->name_length = 0;
+        small_string_create(&n->name);
         return;
     }
 
-    char *new_name = (char *)realloc(n->name, (len + 1) * sizeof(char));
-    if (!new_name) return;
-
-    strncpy(new_name, name, len);
-    new_name[len] = 0;
-    n->name_length = len;
-    n->name = new_name;
+    if (!small_string_set(&n->name, arena, name, len)) return;
 
-    Vector2 size = MeasureTextEx(n->font, n->name, n->font_size, 1.0f);
+    Vector2 size = text_measure(n->font, n->font_size, 1.0f,
+                                small_string_get(&n->name), n->name.len);
     n->radius = CLAMP_MIN((size.x / 2.0f) + 10.0f, NODE_MINIMUM_RADIUS);
 
     n->position = (Vector2){
@@ -67,8 +60,9 @@ void node_set_font(Node *n, Font font, float font_size) {
     n->font = font;
     n->font_size = font_size;
 
-    if (n->name) {
-        Vector2 size = MeasureTextEx(n->font, n->name, n->font_size, 1.0f);
+    if (n->name.len) {
+        Vector2 size = text_measure(n->font, n->font_size, 1.0f,
+                                    small_string_get(&n->name), n->name.len);
         n->radius = CLAMP_MIN((size.x / 2.0f) + 10.0f, NODE_MINIMUM_RADIUS);
         n->position = (Vector2){
             .x = n->center.x - (size.x / 2.0f),
@@ -81,33 +75,40 @@ void node_set_colors(Node *n, NodeColors colors) {
     n->colors = colors;
 }
 
-void node_draw(Node *n) {
-    Color color;
-
+Color node_get_color(Node *n) {
     switch (n->state) {
         case NODE_STATE_HIGHLIGHTED:
-            color = n->colors.highlighted;
-            break;
+            return n->colors.highlighted;
         case NODE_STATE_HOVERED:
-            color = n->colors.hovered;
-            break;
+            return n->colors.hovered;
         case NODE_STATE_DOWN:
-            color = n->colors.down;
-            break;
+            return n->colors.down;
         case NODE_STATE_NORMAL:
         default:
-            color = n->colors.normal;
-            break;
+            return n->colors.normal;
     }
+}
+
+void node_draw(Node *n, float zoom) {
+    Color color = node_get_color(n);
+
+    DetailLevel detail = node_get_detail_level(n->radius, zoom);
 
-    if (n->accepting_state) {
+    if (detail == DETAIL_LEVEL_MINIMAL) {
+        // Few pixels on screen, a coarse disc is indistinguishable. The ring
+        // of accepting states is thicker so that it still covers a pixel
+        DrawCircleSector(n->center, n->radius, 0.0f, 360.0f, 8, color);
+        if (n->accepting_state)
+            DrawRing(n->center, n->radius * NODE_MINIMAL_RING_INNER, n->radius,
+                     0.0f, 360.0f, 8, BLACK);
+    } else if (n->accepting_state) {
         DrawCircleV(n->center, n->radius, BLACK);
         DrawCircleV(n->center, n->radius * 0.9, color);
     } else {
         DrawCircleV(n->center, n->radius, color);
     }
-    DrawTextEx(n->font, n->name, n->position, n->font_size, 1.0f,
-               n->colors.text);
+
+    node_draw_label(n, zoom);
 
     if (n->initial_state) {
         // DrawSplineLinear(n->points, 3, 3.0f, BLACK);
@@ -123,6 +124,22 @@ void node_draw(Node *n) {
     }
 }
 
+void node_draw_label(Node *n, float zoom) {
+    if (node_get_detail_level(n->radius, zoom) != DETAIL_LEVEL_FULL) return;
+
+    DrawTextEx(n->font, small_string_get(&n->name), n->position, n->font_size,
+               1.0f, n->colors.text);
+}
+
+DetailLevel node_get_detail_level(float radius, float zoom) {
+    float screen_radius = radius * zoom;
+    if (screen_radius < NODE_DETAIL_MIN_SCREEN_RADIUS)
+        return DETAIL_LEVEL_MINIMAL;
+    if (screen_radius < NODE_LABEL_MIN_SCREEN_RADIUS)
+        return DETAIL_LEVEL_REDUCED;
+    return DETAIL_LEVEL_FULL;
+}
+
 i32 node_update(Node *n, Vector2 mpos, Vector2 delta, i32 handled) {
     return n->editing ? node_update_editing(n, mpos, delta, handled)
                       : node_update_animating(n, handled);
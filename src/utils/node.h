@@ -2,7 +2,9 @@
 
 #include <raylib.h>
 
+#include "arena.h"
 #include "defines.h"
+#include "small_string.h"
 
 typedef enum NodeState {
     NODE_STATE_NORMAL,
@@ -11,6 +13,20 @@ typedef enum NodeState {
     NODE_STATE_HIGHLIGHTED,
 } NodeState;
 
+// On-screen radius (in pixels) below which labels are no longer drawn
+#define NODE_LABEL_MIN_SCREEN_RADIUS 20.0f
+// On-screen radius (in pixels) below which only bare shapes are drawn
+#define NODE_DETAIL_MIN_SCREEN_RADIUS 8.0f
+// Inner radius of the accepting ring at the minimal detail level, relative
+// to the node radius
+#define NODE_MINIMAL_RING_INNER 0.6f
+
+typedef enum DetailLevel {
+    DETAIL_LEVEL_FULL,  // Labels, arrowheads and curved self loops
+    DETAIL_LEVEL_REDUCED,  // No labels, simplified self loops
+    DETAIL_LEVEL_MINIMAL,  // Bare discs and strokes
+} DetailLevel;
+
 typedef struct NodeColors {
         Color normal;
         Color text;
@@ -20,8 +36,7 @@ typedef struct NodeColors {
 } NodeColors;
 
 typedef struct Node {
-        char *name;
-        u32 name_length;
+        SmallString name;
         Font font;
         float font_size;
         Vector2 center;
@@ -77,13 +92,20 @@ void node_create(Node *n, Vector2 center);
 
 void node_destroy(Node *n);
 
-void node_set_name(Node *n, const char *name, u32 len);
+// Long names are stored in the arena
+void node_set_name(Node *n, Arena *arena, const char *name, u32 len);
 
 void node_set_font(Node *n, Font font, float font_size);
 
 void node_set_colors(Node *n, NodeColors colors);
 
-void node_draw(Node *n);
+Color node_get_color(Node *n);
+
+void node_draw(Node *n, float zoom);
+
+void node_draw_label(Node *n, float zoom);
+
+DetailLevel node_get_detail_level(float radius, float zoom);
 
 i32 node_update(Node *n, Vector2 mpos, Vector2 delta, i32 handled);
 
@@ -8,6 +8,7 @@ void node_selector_create(NodeSelector *ns, Rectangle rect) {
     ns->selected = false;
     ns->rect = rect;
     ns->font_size = rect.height;
+    ns->dirty = true;
     node_selector_set_font(ns, GetFontDefault());
 }
 
@@ -25,7 +26,7 @@ i32 node_selector_update(NodeSelector *ns, Node *nodes, Vector2 mpos,
                 node_update(&nodes[i], world_mpos, (Vector2){0, 0}, handled);
             if (nodes[i].selected) {
                 nodes[i].selected = false;
-                ns->node = &nodes[i];
+                node_selector_set_node(ns, &nodes[i]);
                 ns->selected = false;
                 SetMouseCursor(MOUSE_CURSOR_ARROW);
             }
@@ -64,11 +65,12 @@ i32 node_selector_update(NodeSelector *ns, Node *nodes, Vector2 mpos,
 void node_selector_draw(NodeSelector *ns) {
     DrawRectangleRec(ns->rect, WHITE);
     if (ns->node) {
-        u32 idx =
-            CLAMP_MIN((i32)(ns->node->name_length - ns->chars_to_show), 0);
-        DrawTextEx(ns->font, &ns->node->name[idx], ns->position, ns->font_size,
-                   1.0f, BLACK);
+        const char *name = small_string_get(&ns->node->name);
+        u32 idx = CLAMP_MIN((i32)(ns->node->name.len - ns->chars_to_show), 0);
+        DrawTextEx(ns->font, &name[idx], ns->position, ns->font_size, 1.0f,
+                   BLACK);
     }
+    ns->dirty = false;
 }
 
 void node_selector_set_font(NodeSelector *ns, Font font) {
@@ -78,8 +80,15 @@ void node_selector_set_font(NodeSelector *ns, Font font) {
     ns->chars_to_show = (u32)(ns->rect.width / size.x);
     ns->chars_to_show -= 1;
     ns->position = (Vector2){.x = ns->rect.x, .y = ns->rect.y};
+    ns->dirty = true;
     // ns->position = (Vector2){
     //     .x = ns->rect.x
     //        + ((ns->rect.width - ((ns->chars_to_show - 1) * size.x)) / 2),
     //     .y = ns->rect.y + ((ns->rect.height - size.y) / 2)};
 }
+
+void node_selector_set_node(NodeSelector *ns, Node *node) {
+    if (ns->node == node) return;
+    ns->node = node;
+    ns->dirty = true;
+}
@@ -14,6 +14,7 @@ typedef struct NodeSelector {
         Font font;
         float font_size;
         u32 chars_to_show;
+        bool dirty;  // Changed since it was last drawn
 } NodeSelector;
 
 void node_selector_create(NodeSelector *ns, Rectangle rect);
@@ -26,3 +27,5 @@ i32 node_selector_update(NodeSelector *ns, Node *nodes, Vector2 mpos,
 void node_selector_draw(NodeSelector *ns);
 
 void node_selector_set_font(NodeSelector *ns, Font font);
+
+void node_selector_set_node(NodeSelector *ns, Node *node);
@@ -0,0 +1,88 @@
+#include "slider.h"
+
+#include <raymath.h>
+
+void slider_create(Slider *sl, Rectangle rect, float min, float max) {
+    sl->rect = rect;
+    sl->min = min;
+    sl->max = max;
+    sl->value = min;
+    sl->dragging = false;
+    sl->changed = false;
+    sl->dirty = true;
+    slider_set_colors(
+        sl, (SliderColors){.track = BLACK, .fill = BLUE, .knob = VIOLET});
+}
+
+void slider_destroy(Slider *sl) {
+    UNUSED(sl);
+}
+
+void slider_set_colors(Slider *sl, SliderColors colors) {
+    sl->colors = colors;
+    sl->dirty = true;
+}
+
+void slider_set_range(Slider *sl, float min, float max) {
+    sl->min = min;
+    sl->max = max;
+    sl->value = Clamp(sl->value, min, max);
+    sl->dirty = true;
+}
+
+void slider_set_value(Slider *sl, float value) {
+    value = Clamp(value, sl->min, sl->max);
+    if (value == sl->value) return;
+    sl->value = value;
+    sl->dirty = true;
+}
+
+float slider_get_value(Slider *sl) {
+    return sl->value;
+}
+
+i32 slider_update(Slider *sl, Vector2 mpos, i32 handled) {
+    sl->changed = false;
+
+    if (sl->dragging) {
+        if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+            sl->dragging = false;
+            return handled;
+        }
+    } else if (CheckCollisionPointRec(mpos, sl->rect)
+               && !IS_INPUT_HANDLED(handled, INPUT_MOUSE_POSITION)) {
+        handled = MARK_INPUT_HANDLED(handled, INPUT_MOUSE_POSITION);
+
+        if (IS_INPUT_HANDLED(handled, INPUT_LEFT_BUTTON)) return handled;
+
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) sl->dragging = true;
+    }
+
+    if (!sl->dragging) return handled;
+
+    // Keeps following the mouse even when it leaves the slider
+    handled = MARK_INPUT_HANDLED(handled,
+                                 INPUT_MOUSE_POSITION | INPUT_LEFT_BUTTON);
+
+    float t = Clamp((mpos.x - sl->rect.x) / sl->rect.width, 0.0f, 1.0f);
+    float prev = sl->value;
+    slider_set_value(sl, Lerp(sl->min, sl->max, t));
+    sl->changed = sl->value != prev;
+
+    return handled;
+}
+
+void slider_draw(Slider *sl) {
+    float range = sl->max - sl->min;
+    float t = range > 0.0f ? (sl->value - sl->min) / range : 0.0f;
+    float knob_x = sl->rect.x + (sl->rect.width * t);
+    float knob_radius = sl->rect.height / 2.0f;
+
+    DrawRectangleRec(sl->rect, sl->colors.track);
+    DrawRectangleRec((Rectangle){sl->rect.x, sl->rect.y,
+                                 sl->rect.width * t, sl->rect.height},
+                     sl->colors.fill);
+    DrawCircleV((Vector2){knob_x, sl->rect.y + knob_radius}, knob_radius,
+                sl->colors.knob);
+    sl->dirty = false;
+}
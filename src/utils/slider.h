@@ -0,0 +1,38 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "defines.h"
+
+typedef struct SliderColors {
+        Color track;
+        Color fill;
+        Color knob;
+} SliderColors;
+
+typedef struct Slider {
+        Rectangle rect;
+        SliderColors colors;
+        float min;
+        float max;
+        float value;
+        bool dragging;
+        bool changed;  // Value was changed by the user in the last update
+        bool dirty;  // Changed since it was last drawn
+} Slider;
+
+void slider_create(Slider *sl, Rectangle rect, float min, float max);
+
+void slider_destroy(Slider *sl);
+
+void slider_set_colors(Slider *sl, SliderColors colors);
+
+void slider_set_range(Slider *sl, float min, float max);
+
+void slider_set_value(Slider *sl, float value);
+
+float slider_get_value(Slider *sl);
+
+i32 slider_update(Slider *sl, Vector2 mpos, i32 handled);
+
+void slider_draw(Slider *sl);
@@ -0,0 +1,58 @@
+#include "small_string.h"
+
+#include <string.h>
+
+static bool small_string_is_local(u32 len) {
+    return len < SMALL_STRING_INLINE_CAPACITY;
+}
+
+void small_string_create(SmallString *ss) {
+    ss->local[0] = 0;
+    ss->len = 0;
+}
+
+// The text may point into the current storage of the string
+static bool small_string_store(SmallString *ss, Arena *arena,
+                               const char *first, u32 first_len,
+                               const char *second, u32 second_len) {
+    u32 len = first_len + second_len;
+    char *dst;
+    if (small_string_is_local(len)) {
+        dst = ss->local;
+    } else {
+        dst = (char *)arena_alloc(arena, len + 1);
+        if (!dst) return false;
+    }
+
+    if (first_len) memmove(dst, first, first_len);
+    if (second_len) memmove(&dst[first_len], second, second_len);
+    dst[len] = 0;
+    if (!small_string_is_local(len)) ss->external = dst;
+    ss->len = len;
+    return true;
+}
+
+bool small_string_set(SmallString *ss, Arena *arena, const char *text,
+                      u32 len) {
+    return small_string_store(ss, arena, text, len, NULL, 0);
+}
+
+bool small_string_append(SmallString *ss, Arena *arena, const char *text,
+                         u32 len) {
+    return small_string_store(ss, arena, small_string_get(ss), ss->len, text,
+                              len);
+}
+
+void small_string_borrow(SmallString *ss, const char *text, u32 len) {
+    if (small_string_is_local(len)) {
+        memcpy(ss->local, text, len);
+        ss->local[len] = 0;
+    } else {
+        ss->external = (char *)text;
+    }
+    ss->len = len;
+}
+
+const char *small_string_get(const SmallString *ss) {
+    return small_string_is_local(ss->len) ? ss->local : ss->external;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "arena.h"
+#include "defines.h"
+
+#define SMALL_STRING_INLINE_CAPACITY 16
+
+// Up to 15 characters are stored inline, longer strings live in an arena
+// (or in memory borrowed from someone else) and are never freed one by one
+typedef struct SmallString {
+        union {
+                char local[SMALL_STRING_INLINE_CAPACITY];
+                char *external;
+        };
+        u32 len;
+} SmallString;
+
+void small_string_create(SmallString *ss);
+
+// False when the arena is out of memory, the string is left as it was
+bool small_string_set(SmallString *ss, Arena *arena, const char *text,
+                      u32 len);
+
+bool small_string_append(SmallString *ss, Arena *arena, const char *text,
+                         u32 len);
+
+// Refers to the text without copying it, it must outlive the string
+void small_string_borrow(SmallString *ss, const char *text, u32 len);
+
+// Always null terminated
+const char *small_string_get(const SmallString *ss);
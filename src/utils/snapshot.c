@@ -0,0 +1,290 @@
+#include "snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "memory.h"
+#include "thread.h"
+
+#define BIT_WORD(bit) ((bit) >> 6)
+#define BIT_MASK(bit) (1ULL << ((bit) & 63))
+
+// Without room for the bit everything from the block on is dirty, which
+// costs a larger capture but never misses a change
+static void snapshot_mark(u64 **bits, u64 *words, u64 *dirty_from,
+                          u64 block) {
+    if (BIT_WORD(block) >= *words) {
+        u64 new_words = MAX(BIT_WORD(block) + 1, *words * 2);
+        u64 *new_bits = (u64 *)memory_realloc(
+            *bits, new_words * sizeof(u64), MEMORY_TAG_ENGINE);
+        if (!new_bits) {
+            *dirty_from = MIN(*dirty_from, block * SNAPSHOT_BLOCK_SIZE);
+            return;
+        }
+        memset(&new_bits[*words], 0, (new_words - *words) * sizeof(u64));
+        *bits = new_bits;
+        *words = new_words;
+    }
+    (*bits)[BIT_WORD(block)] |= BIT_MASK(block);
+}
+
+static bool snapshot_is_marked(u64 *bits, u64 words, u64 block) {
+    if (BIT_WORD(block) >= words) return false;
+    return bits[BIT_WORD(block)] & BIT_MASK(block);
+}
+
+void snapshot_store_create(SnapshotStore *ss) {
+    // Nothing was captured yet, so everything is dirty
+    memset(ss, 0, sizeof(SnapshotStore));
+}
+
+void snapshot_store_destroy(SnapshotStore *ss) {
+    if (ss->latest) model_snapshot_release(ss->latest);
+    memory_free(ss->dirty_nodes);
+    memory_free(ss->dirty_tlines);
+    memset(ss, 0, sizeof(SnapshotStore));
+}
+
+void snapshot_store_mark_node(SnapshotStore *ss, u64 index) {
+    snapshot_mark(&ss->dirty_nodes, &ss->dirty_node_words,
+                  &ss->nodes_dirty_from, index / SNAPSHOT_BLOCK_SIZE);
+}
+
+void snapshot_store_mark_nodes_from(SnapshotStore *ss, u64 index) {
+    ss->nodes_dirty_from = MIN(ss->nodes_dirty_from, index);
+}
+
+void snapshot_store_mark_tline(SnapshotStore *ss, u64 index) {
+    snapshot_mark(&ss->dirty_tlines, &ss->dirty_tline_words,
+                  &ss->tlines_dirty_from, index / SNAPSHOT_BLOCK_SIZE);
+}
+
+void snapshot_store_mark_tlines_from(SnapshotStore *ss, u64 index) {
+    ss->tlines_dirty_from = MIN(ss->tlines_dirty_from, index);
+}
+
+void snapshot_store_mark_all(SnapshotStore *ss) {
+    ss->nodes_dirty_from = ss->tlines_dirty_from = 0;
+}
+
+static void node_block_release(NodeBlock *block) {
+    if (sync_add_u64(&block->refs, (u64)-1) == 1) memory_free(block);
+}
+
+static void tline_block_release(TLineBlock *block) {
+    if (sync_add_u64(&block->refs, (u64)-1) != 1) return;
+    memory_free(block->text);
+    memory_free(block);
+}
+
+static NodeBlock *node_block_create(Node *nodes, u64 first, u32 count) {
+    NodeBlock *block =
+        (NodeBlock *)memory_alloc(sizeof(NodeBlock), MEMORY_TAG_ENGINE);
+    if (!block) return NULL;
+    block->refs = 1;
+    block->count = count;
+    for (u32 i = 0; i < count; ++i) {
+        block->nodes[i].initial_state = nodes[first + i].initial_state;
+        block->nodes[i].accepting_state = nodes[first + i].accepting_state;
+    }
+    return block;
+}
+
+// Pointers outside of the nodes darray are treated as not connected
+static u32 snapshot_node_index(Node *nodes, u64 nodes_length, Node *node) {
+    if (!node || node < nodes || node >= nodes + nodes_length)
+        return SNAPSHOT_NO_NODE;
+    return node - nodes;
+}
+
+static TLineBlock *tline_block_create(Node *nodes, TLine *tlines, u64 first,
+                                      u32 count) {
+    TLineBlock *block =
+        (TLineBlock *)memory_alloc(sizeof(TLineBlock), MEMORY_TAG_ENGINE);
+    if (!block) return NULL;
+    block->refs = 1;
+    block->count = count;
+
+    u64 size = 0;
+    for (u32 i = 0; i < count; ++i) size += tlines[first + i].inputs.len + 1;
+    block->text = (char *)memory_alloc(CLAMP_MIN(size, 1), MEMORY_TAG_ENGINE);
+    if (!block->text) {
+        memory_free(block);
+        return NULL;
+    }
+
+    u64 nodes_length = darray_get_size(nodes);
+    char *text = block->text;
+    for (u32 i = 0; i < count; ++i) {
+        TLine *tl = &tlines[first + i];
+        SnapshotTLine *st = &block->tlines[i];
+        st->start = snapshot_node_index(nodes, nodes_length, tl->start);
+        st->end = snapshot_node_index(nodes, nodes_length, tl->end);
+        st->len = tl->inputs.len;
+        st->inputs = text;
+        memcpy(text, small_string_get(&tl->inputs), st->len + 1);
+        text += st->len + 1;
+    }
+    return block;
+}
+
+// Whether the block can be taken over from the previous version
+static bool snapshot_block_is_clean(u64 *bits, u64 words, u64 dirty_from,
+                                    u64 block, u32 old_count, u32 count) {
+    return old_count == count && (block + 1) * SNAPSHOT_BLOCK_SIZE <= dirty_from
+        && !snapshot_is_marked(bits, words, block);
+}
+
+ModelSnapshot *snapshot_store_acquire(SnapshotStore *ss, Node *nodes,
+                                      TLine *tlines, const char *alphabet,
+                                      u64 version) {
+    ModelSnapshot *old = ss->latest;
+    if (old && old->version == version) {
+        model_snapshot_retain(old);
+        return old;
+    }
+
+    ModelSnapshot *ms = (ModelSnapshot *)memory_calloc(
+        1, sizeof(ModelSnapshot), MEMORY_TAG_ENGINE);
+    if (!ms) return NULL;
+    ms->refs = 1;
+    ms->version = version;
+    ms->node_count = darray_get_size(nodes);
+    ms->tline_count = darray_get_size(tlines);
+
+    u64 node_blocks =
+        (ms->node_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    u64 tline_blocks =
+        (ms->tline_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    ms->node_blocks =
+        (NodeBlock **)memory_calloc(CLAMP_MIN(node_blocks, 1),
+                                    sizeof(NodeBlock *), MEMORY_TAG_ENGINE);
+    ms->tline_blocks =
+        (TLineBlock **)memory_calloc(CLAMP_MIN(tline_blocks, 1),
+                                     sizeof(TLineBlock *), MEMORY_TAG_ENGINE);
+    if (alphabet) {
+        u64 len = strlen(alphabet);
+        ms->alphabet = (char *)memory_alloc(len + 1, MEMORY_TAG_ENGINE);
+        if (ms->alphabet) memcpy(ms->alphabet, alphabet, len + 1);
+    }
+    if (!ms->node_blocks || !ms->tline_blocks
+        || (alphabet && !ms->alphabet)) {
+        model_snapshot_release(ms);
+        return NULL;
+    }
+
+    // Only the pointer tables are copied, blocks are shared while clean
+    u64 old_node_blocks = 0, old_tline_blocks = 0;
+    if (old) {
+        old_node_blocks =
+            (old->node_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+        old_tline_blocks =
+            (old->tline_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    }
+
+    for (u64 i = 0; i < node_blocks; ++i) {
+        u64 first = i * SNAPSHOT_BLOCK_SIZE;
+        u32 count = MIN(ms->node_count - first, SNAPSHOT_BLOCK_SIZE);
+        if (i < old_node_blocks
+            && snapshot_block_is_clean(ss->dirty_nodes, ss->dirty_node_words,
+                                       ss->nodes_dirty_from, i,
+                                       old->node_blocks[i]->count, count)) {
+            ms->node_blocks[i] = old->node_blocks[i];
+            sync_add_u64(&ms->node_blocks[i]->refs, 1);
+        } else {
+            ms->node_blocks[i] = node_block_create(nodes, first, count);
+        }
+        if (!ms->node_blocks[i]) {
+            model_snapshot_release(ms);
+            return NULL;
+        }
+    }
+
+    for (u64 i = 0; i < tline_blocks; ++i) {
+        u64 first = i * SNAPSHOT_BLOCK_SIZE;
+        u32 count = MIN(ms->tline_count - first, SNAPSHOT_BLOCK_SIZE);
+        if (i < old_tline_blocks
+            && snapshot_block_is_clean(ss->dirty_tlines, ss->dirty_tline_words,
+                                       ss->tlines_dirty_from, i,
+                                       old->tline_blocks[i]->count, count)) {
+            ms->tline_blocks[i] = old->tline_blocks[i];
+            sync_add_u64(&ms->tline_blocks[i]->refs, 1);
+        } else {
+            ms->tline_blocks[i] =
+                tline_block_create(nodes, tlines, first, count);
+        }
+        if (!ms->tline_blocks[i]) {
+            model_snapshot_release(ms);
+            return NULL;
+        }
+    }
+
+    memset(ss->dirty_nodes, 0, ss->dirty_node_words * sizeof(u64));
+    memset(ss->dirty_tlines, 0, ss->dirty_tline_words * sizeof(u64));
+    ss->nodes_dirty_from = ss->tlines_dirty_from = UINT64_MAX;
+
+    if (old) model_snapshot_release(old);
+    ss->latest = ms;
+    model_snapshot_retain(ms);
+
+    return ms;
+}
+
+void model_snapshot_retain(ModelSnapshot *ms) {
+    sync_add_u64(&ms->refs, 1);
+}
+
+void model_snapshot_release(ModelSnapshot *ms) {
+    if (sync_add_u64(&ms->refs, (u64)-1) != 1) return;
+
+    u64 node_blocks =
+        (ms->node_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    u64 tline_blocks =
+        (ms->tline_count + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    // A partially built snapshot has NULL blocks at the end
+    for (u64 i = 0; ms->node_blocks && i < node_blocks; ++i)
+        if (ms->node_blocks[i]) node_block_release(ms->node_blocks[i]);
+    for (u64 i = 0; ms->tline_blocks && i < tline_blocks; ++i)
+        if (ms->tline_blocks[i]) tline_block_release(ms->tline_blocks[i]);
+
+    memory_free(ms->node_blocks);
+    memory_free(ms->tline_blocks);
+    memory_free(ms->alphabet);
+    memory_free(ms);
+}
+
+bool model_snapshot_expand(ModelSnapshot *ms, Node **nodes, TLine **tlines) {
+    *nodes = darray_create_with_capacity(CLAMP_MIN(ms->node_count, 1), Node);
+    *tlines =
+        darray_create_with_capacity(CLAMP_MIN(ms->tline_count, 1), TLine);
+    if (!*nodes || !*tlines) {
+        if (*nodes) darray_destroy(*nodes);
+        if (*tlines) darray_destroy(*tlines);
+        return false;
+    }
+
+    for (u64 i = 0; i < ms->node_count; ++i) {
+        SnapshotNode *sn =
+            &ms->node_blocks[i / SNAPSHOT_BLOCK_SIZE]
+                 ->nodes[i % SNAPSHOT_BLOCK_SIZE];
+        Node node = {0};
+        node.initial_state = sn->initial_state;
+        node.accepting_state = sn->accepting_state;
+        darray_push(nodes, node);
+    }
+
+    // The capacity was reserved, so these pointers stay valid
+    for (u64 i = 0; i < ms->tline_count; ++i) {
+        SnapshotTLine *st =
+            &ms->tline_blocks[i / SNAPSHOT_BLOCK_SIZE]
+                 ->tlines[i % SNAPSHOT_BLOCK_SIZE];
+        TLine tline = {0};
+        if (st->start != SNAPSHOT_NO_NODE) tline.start = &(*nodes)[st->start];
+        if (st->end != SNAPSHOT_NO_NODE) tline.end = &(*nodes)[st->end];
+        small_string_borrow(&tline.inputs, st->inputs, st->len);
+        darray_push(tlines, tline);
+    }
+
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "defines.h"
+#include "node.h"
+#include "tline.h"
+
+// Elements per block, blocks are shared between versions while unchanged
+#define SNAPSHOT_BLOCK_SIZE 64
+#define SNAPSHOT_NO_NODE UINT32_MAX
+
+typedef struct SnapshotNode {
+        bool initial_state;
+        bool accepting_state;
+} SnapshotNode;
+
+typedef struct SnapshotTLine {
+        u32 start;  // Node index or SNAPSHOT_NO_NODE
+        u32 end;
+        char *inputs;  // Points into the text of the block
+        u32 len;
+} SnapshotTLine;
+
+typedef struct NodeBlock {
+        volatile u64 refs;
+        u32 count;
+        SnapshotNode nodes[SNAPSHOT_BLOCK_SIZE];
+} NodeBlock;
+
+typedef struct TLineBlock {
+        volatile u64 refs;
+        u32 count;
+        char *text;  // Inputs of every tline, one allocation per block
+        SnapshotTLine tlines[SNAPSHOT_BLOCK_SIZE];
+} TLineBlock;
+
+// Immutable, reference counted version of the automaton that other threads
+// can read while the model is edited. Only what the analysis needs is kept
+typedef struct ModelSnapshot {
+        volatile u64 refs;
+        u64 version;
+        u64 node_count;
+        u64 tline_count;
+        NodeBlock **node_blocks;
+        TLineBlock **tline_blocks;
+        char *alphabet;
+} ModelSnapshot;
+
+// Produces snapshots of the model, rebuilding only the blocks marked dirty
+// since the previous one. Every edit of the model must be marked
+typedef struct SnapshotStore {
+        ModelSnapshot *latest;
+        u64 *dirty_nodes;  // Bitset of node blocks
+        u64 *dirty_tlines;  // Bitset of tline blocks
+        u64 dirty_node_words;
+        u64 dirty_tline_words;
+        u64 nodes_dirty_from;  // Every node from this index is dirty
+        u64 tlines_dirty_from;
+} SnapshotStore;
+
+void snapshot_store_create(SnapshotStore *ss);
+
+void snapshot_store_destroy(SnapshotStore *ss);
+
+void snapshot_store_mark_node(SnapshotStore *ss, u64 index);
+
+// For removals, which move the following elements
+void snapshot_store_mark_nodes_from(SnapshotStore *ss, u64 index);
+
+void snapshot_store_mark_tline(SnapshotStore *ss, u64 index);
+
+void snapshot_store_mark_tlines_from(SnapshotStore *ss, u64 index);
+
+// For when the whole model is replaced
+void snapshot_store_mark_all(SnapshotStore *ss);
+
+// Returns a new reference, NULL on allocation failure
+ModelSnapshot *snapshot_store_acquire(SnapshotStore *ss, Node *nodes,
+                                      TLine *tlines, const char *alphabet,
+                                      u64 version);
+
+void model_snapshot_retain(ModelSnapshot *ms);
+
+// Frees the snapshot and the blocks no other version uses
+void model_snapshot_release(ModelSnapshot *ms);
+
+// Darrays in the layout of the model for code that works on it, the tline
+// inputs are borrowed from the snapshot. Free them with darray_destroy
+bool model_snapshot_expand(ModelSnapshot *ms, Node **nodes, TLine **tlines);
@@ -1,9 +1,9 @@
 #include "strops.h"
 
 bool all_chars_present(const char *alphabets, const char *inputs) {
-    u32 buf[128] = {0};
-    for (u64 i = 0; alphabets[i]; ++i) buf[(int)alphabets[i]]++;
+    u32 buf[256] = {0};
+    for (u64 i = 0; alphabets[i]; ++i) buf[(u8)alphabets[i]]++;
     for (u64 i = 0; inputs[i]; ++i)
-        if (!buf[(int)inputs[i]]) return false;
+        if (!buf[(u8)inputs[i]]) return false;
     return true;
 }
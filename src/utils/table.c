@@ -0,0 +1,695 @@
+#include "table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "memory.h"
+
+#define BIT_WORD(bit) ((bit) >> 6)
+#define BIT_MASK(bit) (1ULL << ((bit) & 63))
+
+// Columns are added in steps to avoid moving every row for each new symbol
+#define FSM_TABLE_MIN_STRIDE 8
+#define FSM_TABLE_MIN_CAPACITY 16
+
+static bool fsm_table_grow(void **array, u32 *capacity, u32 needed,
+                           u64 size) {
+    if (needed <= *capacity) return true;
+    u32 new_capacity = MAX(needed, MAX(*capacity * 2, FSM_TABLE_MIN_CAPACITY));
+    void *new_array =
+        memory_realloc(*array, new_capacity * size, MEMORY_TAG_ENGINE);
+    if (!new_array) return false;
+    *array = new_array;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Moves the rows into arrays of the given size, new cells are empty
+static bool fsm_table_layout(FsmTable *ft, u32 state_capacity, u32 stride) {
+    u64 cells = CLAMP_MIN((u64)state_capacity * stride, 1);
+    u32 *heads = (u32 *)memory_alloc(cells * sizeof(u32), MEMORY_TAG_ENGINE);
+    u32 *counts = (u32 *)memory_calloc(cells, sizeof(u32), MEMORY_TAG_ENGINE);
+    u32 *next = (u32 *)memory_alloc(cells * sizeof(u32), MEMORY_TAG_ENGINE);
+    u8 *flags = (u8 *)memory_realloc(
+        ft->flags, CLAMP_MIN(state_capacity, 1), MEMORY_TAG_ENGINE);
+    if (flags) ft->flags = flags;
+    if (!heads || !counts || !next || !flags) {
+        memory_free(heads);
+        memory_free(counts);
+        memory_free(next);
+        return false;
+    }
+
+    for (u64 i = 0; i < cells; ++i) heads[i] = next[i] = FSM_TABLE_NONE;
+
+    u64 row_size = ft->column_count * sizeof(u32);
+    for (u64 i = 0; i < ft->state_count; ++i) {
+        memcpy(&heads[i * stride], &ft->heads[i * ft->stride], row_size);
+        memcpy(&counts[i * stride], &ft->counts[i * ft->stride], row_size);
+        memcpy(&next[i * stride], &ft->next[i * ft->stride], row_size);
+    }
+
+    if (stride != ft->stride) {
+        for (u32 i = 0; i < ft->edge_count; ++i) {
+            FsmEdge *edge = &ft->edges[i];
+            if (edge->cell == FSM_TABLE_NONE) continue;
+            u32 state = edge->cell / ft->stride;
+            edge->cell = state * stride + edge->cell % ft->stride;
+        }
+    }
+
+    memory_free(ft->heads);
+    memory_free(ft->counts);
+    memory_free(ft->next);
+    ft->heads = heads;
+    ft->counts = counts;
+    ft->next = next;
+    ft->state_capacity = state_capacity;
+    ft->stride = stride;
+
+    return true;
+}
+
+static u32 fsm_table_find_initial(FsmTable *ft) {
+    // The last initial state wins, like in the editor
+    for (u32 i = ft->state_count; i > 0; --i)
+        if (ft->flags[i - 1] & FSM_STATE_INITIAL) return i - 1;
+    return FSM_TABLE_NONE;
+}
+
+static u32 fsm_table_alloc_edge(FsmTable *ft) {
+    if (ft->free_edge != FSM_TABLE_NONE) {
+        u32 e = ft->free_edge;
+        ft->free_edge = ft->edges[e].next_in_cell;
+        return e;
+    }
+
+    if (!fsm_table_grow((void **)&ft->edges, &ft->edge_capacity,
+                        ft->edge_count + 1, sizeof(FsmEdge)))
+        return FSM_TABLE_NONE;
+
+    return ft->edge_count++;
+}
+
+static bool fsm_table_add_column(FsmTable *ft, u8 c) {
+    if (ft->column_count == ft->stride
+        && !fsm_table_layout(ft, ft->state_capacity,
+                             MAX(ft->stride * 2, FSM_TABLE_MIN_STRIDE)))
+        return false;
+
+    ft->columns[c] = ft->column_count++;
+    return true;
+}
+
+static bool fsm_table_link(FsmTable *ft, u32 tline, u32 column) {
+    u32 e = fsm_table_alloc_edge(ft);
+    if (e == FSM_TABLE_NONE) return false;
+
+    FsmTableTLine *tl = &ft->tlines[tline];
+    u32 cell = tl->start * ft->stride + column;
+    FsmEdge *edge = &ft->edges[e];
+    edge->target = tl->end;
+    edge->tline = tline;
+    edge->cell = cell;
+    edge->next_in_cell = ft->heads[cell];
+    edge->next_in_tline = tl->first_edge;
+    ft->heads[cell] = e;
+    tl->first_edge = e;
+
+    if (++ft->counts[cell] == 1) {
+        ft->next[cell] = tl->end;
+    } else {
+        if (ft->counts[cell] == 2) ft->multi_cells++;
+        ft->next[cell] = FSM_TABLE_NONE;
+    }
+
+    return true;
+}
+
+static void fsm_table_clear_tline(FsmTable *ft, u32 tline) {
+    u32 e = ft->tlines[tline].first_edge;
+    while (e != FSM_TABLE_NONE) {
+        FsmEdge *edge = &ft->edges[e];
+        u32 next_edge = edge->next_in_tline;
+        u32 cell = edge->cell;
+
+        // Cells hold few edges, so a singly linked list is enough
+        u32 *link = &ft->heads[cell];
+        while (*link != e) link = &ft->edges[*link].next_in_cell;
+        *link = edge->next_in_cell;
+
+        u32 count = --ft->counts[cell];
+        if (count == 1) {
+            ft->multi_cells--;
+            ft->next[cell] = ft->edges[ft->heads[cell]].target;
+        } else if (count == 0) {
+            ft->next[cell] = FSM_TABLE_NONE;
+        }
+
+        edge->cell = FSM_TABLE_NONE;
+        edge->next_in_cell = ft->free_edge;
+        ft->free_edge = e;
+        e = next_edge;
+    }
+
+    ft->tlines[tline].first_edge = FSM_TABLE_NONE;
+}
+
+void fsm_table_create(FsmTable *ft) {
+    memset(ft, 0, sizeof(FsmTable));
+    memset(ft->columns, FSM_TABLE_NO_COLUMN, sizeof(ft->columns));
+    ft->initial = FSM_TABLE_NONE;
+    ft->free_edge = FSM_TABLE_NONE;
+}
+
+void fsm_table_destroy(FsmTable *ft) {
+    memory_free(ft->flags);
+    memory_free(ft->heads);
+    memory_free(ft->counts);
+    memory_free(ft->next);
+    memory_free(ft->edges);
+    memory_free(ft->tlines);
+    fsm_table_create(ft);
+}
+
+// Pointers outside of the nodes darray are treated as not connected
+static u32 fsm_table_node_index(Node *nodes, u64 nodes_length, Node *node) {
+    if (!node || node < nodes || node >= nodes + nodes_length)
+        return FSM_TABLE_NONE;
+    return node - nodes;
+}
+
+bool fsm_table_rebuild(FsmTable *ft, Node *nodes, TLine *tlines, u64 version) {
+    u64 nodes_length = darray_get_size(nodes);
+    u64 tlines_length = darray_get_size(tlines);
+
+    // Keeps the buffers, everything else starts over
+    memset(ft->columns, FSM_TABLE_NO_COLUMN, sizeof(ft->columns));
+    ft->column_count = 0;
+    ft->state_count = 0;
+    ft->tline_count = 0;
+    ft->edge_count = 0;
+    ft->multi_cells = 0;
+    ft->initial = FSM_TABLE_NONE;
+    ft->free_edge = FSM_TABLE_NONE;
+    ft->built = false;
+
+    for (u64 i = 0; i < nodes_length; ++i) {
+        u8 flags = (nodes[i].initial_state ? FSM_STATE_INITIAL : 0)
+                 | (nodes[i].accepting_state ? FSM_STATE_ACCEPTING : 0);
+        if (!fsm_table_add_state(ft, flags)) return false;
+    }
+
+    for (u64 i = 0; i < tlines_length; ++i) {
+        u32 start = fsm_table_node_index(nodes, nodes_length, tlines[i].start);
+        u32 end = fsm_table_node_index(nodes, nodes_length, tlines[i].end);
+        if (!fsm_table_set_tline(ft, i, start, end,
+                                 small_string_get(&tlines[i].inputs),
+                                 tlines[i].inputs.len))
+            return false;
+    }
+
+    ft->version = version;
+    ft->built = true;
+
+    return true;
+}
+
+bool fsm_table_sync(FsmTable *ft, Node *nodes, TLine *tlines, u64 version) {
+    if (ft->built && ft->version == version) return true;
+    return fsm_table_rebuild(ft, nodes, tlines, version);
+}
+
+static void *fsm_table_duplicate(void *src, u64 size) {
+    void *dst = memory_alloc(CLAMP_MIN(size, 1), MEMORY_TAG_ENGINE);
+    if (dst && size) memcpy(dst, src, size);
+    return dst;
+}
+
+bool fsm_table_copy(FsmTable *dst, FsmTable *src) {
+    u64 cells = (u64)src->state_count * src->stride;
+
+    *dst = *src;
+    dst->state_capacity = src->state_count;
+    dst->edge_capacity = src->edge_count;
+    dst->tline_capacity = src->tline_count;
+    dst->flags = (u8 *)fsm_table_duplicate(src->flags, src->state_count);
+    dst->heads = (u32 *)fsm_table_duplicate(src->heads, cells * sizeof(u32));
+    dst->counts = (u32 *)fsm_table_duplicate(src->counts, cells * sizeof(u32));
+    dst->next = (u32 *)fsm_table_duplicate(src->next, cells * sizeof(u32));
+    dst->edges = (FsmEdge *)fsm_table_duplicate(
+        src->edges, src->edge_count * sizeof(FsmEdge));
+    dst->tlines = (FsmTableTLine *)fsm_table_duplicate(
+        src->tlines, src->tline_count * sizeof(FsmTableTLine));
+
+    if (dst->flags && dst->heads && dst->counts && dst->next && dst->edges
+        && dst->tlines)
+        return true;
+
+    fsm_table_destroy(dst);
+    return false;
+}
+
+#define FSM_TABLE_IMAGE_ALIGN(size) (((size) + 7) & ~(u64)7)
+
+typedef struct FsmTableImageLayout {
+        u64 flags;
+        u64 heads;
+        u64 counts;
+        u64 next;
+        u64 edges;
+        u64 tlines;
+        u64 size;
+} FsmTableImageLayout;
+
+static FsmTableImageLayout fsm_table_image_layout(const FsmTableImage *image) {
+    u64 cells_size = (u64)image->state_count * image->stride * sizeof(u32);
+    FsmTableImageLayout layout;
+    layout.flags = FSM_TABLE_IMAGE_ALIGN(sizeof(FsmTableImage));
+    layout.heads = FSM_TABLE_IMAGE_ALIGN(layout.flags + image->state_count);
+    layout.counts = FSM_TABLE_IMAGE_ALIGN(layout.heads + cells_size);
+    layout.next = FSM_TABLE_IMAGE_ALIGN(layout.counts + cells_size);
+    layout.edges = FSM_TABLE_IMAGE_ALIGN(layout.next + cells_size);
+    layout.tlines = FSM_TABLE_IMAGE_ALIGN(
+        layout.edges + (u64)image->edge_count * sizeof(FsmEdge));
+    layout.size =
+        layout.tlines + (u64)image->tline_count * sizeof(FsmTableTLine);
+    return layout;
+}
+
+static FsmTableImage fsm_table_image_header(FsmTable *ft) {
+    FsmTableImage image;
+    memset(&image, 0, sizeof(image));
+    memcpy(image.columns, ft->columns, sizeof(image.columns));
+    image.column_count = ft->column_count;
+    image.stride = ft->stride;
+    image.state_count = ft->state_count;
+    image.initial = ft->initial;
+    image.multi_cells = ft->multi_cells;
+    image.edge_count = ft->edge_count;
+    image.free_edge = ft->free_edge;
+    image.tline_count = ft->tline_count;
+    return image;
+}
+
+u64 fsm_table_image_size(FsmTable *ft) {
+    FsmTableImage image = fsm_table_image_header(ft);
+    return fsm_table_image_layout(&image).size;
+}
+
+void fsm_table_write_image(FsmTable *ft, void *dst) {
+    FsmTableImage image = fsm_table_image_header(ft);
+    FsmTableImageLayout layout = fsm_table_image_layout(&image);
+    u64 cells_size = (u64)ft->state_count * ft->stride * sizeof(u32);
+    u8 *bytes = (u8 *)dst;
+
+    // The padding is zeroed so equal tables give equal images
+    memset(bytes, 0, layout.size);
+    memcpy(bytes, &image, sizeof(image));
+    if (ft->state_count) {
+        memcpy(bytes + layout.flags, ft->flags, ft->state_count);
+        memcpy(bytes + layout.heads, ft->heads, cells_size);
+        memcpy(bytes + layout.counts, ft->counts, cells_size);
+        memcpy(bytes + layout.next, ft->next, cells_size);
+    }
+    if (ft->edge_count)
+        memcpy(bytes + layout.edges, ft->edges,
+               ft->edge_count * sizeof(FsmEdge));
+    if (ft->tline_count)
+        memcpy(bytes + layout.tlines, ft->tlines,
+               ft->tline_count * sizeof(FsmTableTLine));
+}
+
+// Index into an array of the given length or FSM_TABLE_NONE
+static bool fsm_table_check_index(u32 index, u32 length) {
+    return index == FSM_TABLE_NONE || index < length;
+}
+
+// Length of a cell or tline list, FSM_TABLE_NONE when it does not end
+// within the limit
+static u32 fsm_table_check_list(FsmTable *ft, u32 first, bool in_cell,
+                                u32 limit) {
+    u32 length = 0;
+    for (u32 e = first; e != FSM_TABLE_NONE;
+         e = in_cell ? ft->edges[e].next_in_cell : ft->edges[e].next_in_tline)
+        if (length++ == limit) return FSM_TABLE_NONE;
+    return length;
+}
+
+// Index ranges alone would let a damaged image loop through its lists or
+// give other verdicts than its tlines, so the links are followed too
+static bool fsm_table_check_view(FsmTable *ft) {
+    // A shared column would let one symbol take the edges of another
+    u64 used_columns[2] = {0};
+    for (u32 i = 0; i < 128; ++i) {
+        u8 column = ft->columns[i];
+        if (column == FSM_TABLE_NO_COLUMN) continue;
+        if (column >= ft->column_count
+            || (used_columns[BIT_WORD(column)] & BIT_MASK(column)))
+            return false;
+        used_columns[BIT_WORD(column)] |= BIT_MASK(column);
+    }
+
+    for (u32 i = 0; i < ft->edge_count; ++i) {
+        FsmEdge *edge = &ft->edges[i];
+        if (!fsm_table_check_index(edge->next_in_cell, ft->edge_count)
+            || !fsm_table_check_index(edge->next_in_tline, ft->edge_count))
+            return false;
+    }
+
+    // Every slot is either free or in exactly one cell and one tline
+    u32 free_count =
+        fsm_table_check_list(ft, ft->free_edge, true, ft->edge_count);
+    if (free_count == FSM_TABLE_NONE) return false;
+    for (u32 e = ft->free_edge; e != FSM_TABLE_NONE;
+         e = ft->edges[e].next_in_cell)
+        if (ft->edges[e].cell != FSM_TABLE_NONE) return false;
+    u32 used = ft->edge_count - free_count;
+
+    u64 cells = (u64)ft->state_count * ft->stride;
+    u32 cell_edges = 0;
+    u32 multi_cells = 0;
+    for (u64 i = 0; i < cells; ++i) {
+        if (!fsm_table_check_index(ft->heads[i], ft->edge_count)
+            || fsm_table_check_list(ft, ft->heads[i], true, used)
+                   != ft->counts[i]
+            || (ft->counts[i] && i % ft->stride >= ft->column_count))
+            return false;
+
+        for (u32 e = ft->heads[i]; e != FSM_TABLE_NONE;
+             e = ft->edges[e].next_in_cell)
+            if (ft->edges[e].cell != i) return false;
+
+        u32 next = ft->counts[i] == 1 ? ft->edges[ft->heads[i]].target
+                                      : FSM_TABLE_NONE;
+        if (ft->next[i] != next) return false;
+        cell_edges += ft->counts[i];
+        multi_cells += ft->counts[i] > 1;
+    }
+    if (cell_edges != used || multi_cells != ft->multi_cells) return false;
+
+    u32 tline_edges = 0;
+    for (u32 i = 0; i < ft->tline_count; ++i) {
+        FsmTableTLine *tl = &ft->tlines[i];
+        if (!fsm_table_check_index(tl->start, ft->state_count)
+            || !fsm_table_check_index(tl->end, ft->state_count)
+            || !fsm_table_check_index(tl->first_edge, ft->edge_count))
+            return false;
+
+        u32 length = fsm_table_check_list(ft, tl->first_edge, false, used);
+        if (length == FSM_TABLE_NONE) return false;
+        tline_edges += length;
+
+        for (u32 e = tl->first_edge; e != FSM_TABLE_NONE;
+             e = ft->edges[e].next_in_tline) {
+            FsmEdge *edge = &ft->edges[e];
+            if (edge->tline != i || edge->cell == FSM_TABLE_NONE
+                || edge->target != tl->end
+                || edge->cell / ft->stride != tl->start)
+                return false;
+        }
+    }
+    if (tline_edges != used) return false;
+
+    for (u32 i = 0; i < ft->state_count; ++i)
+        if (ft->flags[i] & ~(FSM_STATE_INITIAL | FSM_STATE_ACCEPTING))
+            return false;
+
+    return ft->initial == fsm_table_find_initial(ft);
+}
+
+bool fsm_table_view_image(FsmTable *view, const void *src, u64 size) {
+    if (size < sizeof(FsmTableImage) || ((uintptr_t)src & 7)) return false;
+
+    const FsmTableImage *image = (const FsmTableImage *)src;
+    if (image->column_count > 128 || image->stride < image->column_count
+        || image->stride > 256)
+        return false;
+
+    FsmTableImageLayout layout = fsm_table_image_layout(image);
+    if (layout.size > size) return false;
+
+    u8 *bytes = (u8 *)src;
+    fsm_table_create(view);
+    memcpy(view->columns, image->columns, sizeof(view->columns));
+    view->column_count = image->column_count;
+    view->stride = image->stride;
+    view->state_count = view->state_capacity = image->state_count;
+    view->initial = image->initial;
+    view->multi_cells = image->multi_cells;
+    view->edge_count = view->edge_capacity = image->edge_count;
+    view->free_edge = image->free_edge;
+    view->tline_count = view->tline_capacity = image->tline_count;
+    view->flags = bytes + layout.flags;
+    view->heads = (u32 *)(bytes + layout.heads);
+    view->counts = (u32 *)(bytes + layout.counts);
+    view->next = (u32 *)(bytes + layout.next);
+    view->edges = (FsmEdge *)(bytes + layout.edges);
+    view->tlines = (FsmTableTLine *)(bytes + layout.tlines);
+    view->built = true;
+
+    if (fsm_table_check_view(view)) return true;
+
+    fsm_table_create(view);
+    return false;
+}
+
+bool fsm_table_matches(FsmTable *ft, Node *nodes, TLine *tlines) {
+    u64 nodes_length = darray_get_size(nodes);
+    u64 tlines_length = darray_get_size(tlines);
+    if (ft->state_count != nodes_length || ft->tline_count != tlines_length)
+        return false;
+
+    for (u64 i = 0; i < nodes_length; ++i) {
+        u8 flags = (nodes[i].initial_state ? FSM_STATE_INITIAL : 0)
+                 | (nodes[i].accepting_state ? FSM_STATE_ACCEPTING : 0);
+        if (ft->flags[i] != flags) return false;
+    }
+
+    u8 symbols[256];
+    memset(symbols, 0, sizeof(symbols));
+    for (u32 c = 0; c < 128; ++c)
+        if (ft->columns[c] != FSM_TABLE_NO_COLUMN) symbols[ft->columns[c]] = c;
+
+    for (u64 i = 0; i < tlines_length; ++i) {
+        FsmTableTLine *tl = &ft->tlines[i];
+        u32 start = fsm_table_node_index(nodes, nodes_length, tlines[i].start);
+        u32 end = fsm_table_node_index(nodes, nodes_length, tlines[i].end);
+        if (tl->start != start || tl->end != end) return false;
+        if (start == FSM_TABLE_NONE || end == FSM_TABLE_NONE) continue;
+
+        // The edges have to be the distinct symbols of the inputs
+        u64 inputs[2] = {0};
+        u32 distinct = 0;
+        const char *text = small_string_get(&tlines[i].inputs);
+        for (u32 j = 0; j < tlines[i].inputs.len; ++j) {
+            u8 c = text[j] & 127;
+            if (inputs[BIT_WORD(c)] & BIT_MASK(c)) continue;
+            inputs[BIT_WORD(c)] |= BIT_MASK(c);
+            distinct++;
+        }
+
+        u64 linked[2] = {0};
+        u32 length = 0;
+        for (u32 e = tl->first_edge; e != FSM_TABLE_NONE;
+             e = ft->edges[e].next_in_tline) {
+            u8 c = symbols[ft->edges[e].cell % ft->stride];
+            if (!(inputs[BIT_WORD(c)] & BIT_MASK(c))
+                || (linked[BIT_WORD(c)] & BIT_MASK(c)))
+                return false;
+            linked[BIT_WORD(c)] |= BIT_MASK(c);
+            length++;
+        }
+        if (length != distinct) return false;
+    }
+
+    return true;
+}
+
+bool fsm_table_is_deterministic(FsmTable *ft) {
+    return ft->multi_cells == 0;
+}
+
+bool fsm_table_add_state(FsmTable *ft, u8 flags) {
+    if (ft->state_count == ft->state_capacity
+        && !fsm_table_layout(
+            ft, MAX(ft->state_capacity * 2, FSM_TABLE_MIN_CAPACITY),
+            MAX(ft->stride, FSM_TABLE_MIN_STRIDE)))
+        return false;
+
+    u32 state = ft->state_count++;
+    u64 row = (u64)state * ft->stride;
+    for (u32 i = 0; i < ft->stride; ++i) {
+        ft->heads[row + i] = ft->next[row + i] = FSM_TABLE_NONE;
+        ft->counts[row + i] = 0;
+    }
+    ft->flags[state] = flags;
+    if (flags & FSM_STATE_INITIAL) ft->initial = state;
+
+    return true;
+}
+
+void fsm_table_set_state(FsmTable *ft, u32 state, u8 flags) {
+    ft->flags[state] = flags;
+    if (flags & FSM_STATE_INITIAL)
+        ft->initial = state;
+    else if (ft->initial == state)
+        ft->initial = fsm_table_find_initial(ft);
+}
+
+void fsm_table_remove_state(FsmTable *ft, u32 state) {
+    u32 last = ft->state_count - 1;
+    bool was_initial = ft->initial == state;
+
+    if (state != last) {
+        u64 from = (u64)last * ft->stride;
+        u64 to = (u64)state * ft->stride;
+        memcpy(&ft->heads[to], &ft->heads[from], ft->stride * sizeof(u32));
+        memcpy(&ft->counts[to], &ft->counts[from], ft->stride * sizeof(u32));
+        memcpy(&ft->next[to], &ft->next[from], ft->stride * sizeof(u32));
+        ft->flags[state] = ft->flags[last];
+
+        for (u32 i = 0; i < ft->column_count; ++i)
+            for (u32 e = ft->heads[to + i]; e != FSM_TABLE_NONE;
+                 e = ft->edges[e].next_in_cell)
+                ft->edges[e].cell = to + i;
+
+        // Only the endpoints are scanned, the edges are patched in place
+        for (u32 i = 0; i < ft->tline_count; ++i) {
+            FsmTableTLine *tl = &ft->tlines[i];
+            if (tl->start == last) tl->start = state;
+            if (tl->end != last) continue;
+            tl->end = state;
+            for (u32 e = tl->first_edge; e != FSM_TABLE_NONE;
+                 e = ft->edges[e].next_in_tline) {
+                ft->edges[e].target = state;
+                if (ft->counts[ft->edges[e].cell] == 1)
+                    ft->next[ft->edges[e].cell] = state;
+            }
+        }
+
+        if (ft->initial == last) ft->initial = state;
+    }
+
+    ft->state_count--;
+    if (was_initial) ft->initial = fsm_table_find_initial(ft);
+}
+
+bool fsm_table_set_tline(FsmTable *ft, u32 tline, u32 start, u32 end,
+                         const char *inputs, u32 len) {
+    if (tline == ft->tline_count) {
+        if (!fsm_table_grow((void **)&ft->tlines, &ft->tline_capacity,
+                            ft->tline_count + 1, sizeof(FsmTableTLine)))
+            return false;
+        ft->tlines[tline].first_edge = FSM_TABLE_NONE;
+        ft->tline_count++;
+    } else {
+        fsm_table_clear_tline(ft, tline);
+    }
+
+    FsmTableTLine *tl = &ft->tlines[tline];
+    tl->start = start < ft->state_count ? start : FSM_TABLE_NONE;
+    tl->end = end < ft->state_count ? end : FSM_TABLE_NONE;
+    if (tl->start == FSM_TABLE_NONE || tl->end == FSM_TABLE_NONE) return true;
+
+    u64 seen[2] = {0};
+    for (u32 i = 0; i < len; ++i) {
+        u8 c = inputs[i] & 127;
+        if (seen[BIT_WORD(c)] & BIT_MASK(c)) continue;
+        seen[BIT_WORD(c)] |= BIT_MASK(c);
+
+        if (ft->columns[c] == FSM_TABLE_NO_COLUMN
+            && !fsm_table_add_column(ft, c))
+            return false;
+        if (!fsm_table_link(ft, tline, ft->columns[c])) return false;
+    }
+
+    return true;
+}
+
+void fsm_table_remove_tline(FsmTable *ft, u32 tline) {
+    fsm_table_clear_tline(ft, tline);
+
+    u32 last = ft->tline_count - 1;
+    if (tline != last) {
+        ft->tlines[tline] = ft->tlines[last];
+        for (u32 e = ft->tlines[tline].first_edge; e != FSM_TABLE_NONE;
+             e = ft->edges[e].next_in_tline)
+            ft->edges[e].tline = tline;
+    }
+
+    ft->tline_count--;
+}
+
+bool fsm_matcher_create(FsmMatcher *fm, FsmTable *ft) {
+    u32 states = CLAMP_MIN(ft->state_count, 1);
+    fm->table = ft;
+    fm->current = (u32 *)memory_alloc(states * sizeof(u32), MEMORY_TAG_ENGINE);
+    fm->next = (u32 *)memory_alloc(states * sizeof(u32), MEMORY_TAG_ENGINE);
+    fm->seen = (u64 *)memory_calloc((states + 63) / 64, sizeof(u64),
+                                    MEMORY_TAG_ENGINE);
+    if (!fm->current || !fm->next || !fm->seen) {
+        fsm_matcher_destroy(fm);
+        return false;
+    }
+    return true;
+}
+
+void fsm_matcher_destroy(FsmMatcher *fm) {
+    memory_free(fm->current);
+    memory_free(fm->next);
+    memory_free(fm->seen);
+    fm->current = NULL;
+    fm->next = NULL;
+    fm->seen = NULL;
+}
+
+static bool fsm_matcher_accepts_dfa(FsmTable *ft, const char *input, u64 len) {
+    u32 state = ft->initial;
+    for (u64 i = 0; i < len && state != FSM_TABLE_NONE; ++i) {
+        u8 column = ft->columns[input[i] & 127];
+        if (column == FSM_TABLE_NO_COLUMN) return false;
+        state = ft->next[(u64)state * ft->stride + column];
+    }
+    return state != FSM_TABLE_NONE && (ft->flags[state] & FSM_STATE_ACCEPTING);
+}
+
+bool fsm_matcher_accepts(FsmMatcher *fm, const char *input, u64 len) {
+    FsmTable *ft = fm->table;
+    if (ft->initial == FSM_TABLE_NONE) return false;
+    if (fsm_table_is_deterministic(ft))
+        return fsm_matcher_accepts_dfa(ft, input, len);
+
+    u32 current_length = 1;
+    fm->current[0] = ft->initial;
+
+    for (u64 i = 0; i < len && current_length; ++i) {
+        u8 column = ft->columns[input[i] & 127];
+        if (column == FSM_TABLE_NO_COLUMN) return false;
+
+        u32 next_length = 0;
+        for (u32 j = 0; j < current_length; ++j) {
+            u64 cell = (u64)fm->current[j] * ft->stride + column;
+            for (u32 e = ft->heads[cell]; e != FSM_TABLE_NONE;
+                 e = ft->edges[e].next_in_cell) {
+                u32 state = ft->edges[e].target;
+                if (fm->seen[BIT_WORD(state)] & BIT_MASK(state)) continue;
+                fm->seen[BIT_WORD(state)] |= BIT_MASK(state);
+                fm->next[next_length++] = state;
+            }
+        }
+        for (u32 j = 0; j < next_length; ++j)
+            fm->seen[BIT_WORD(fm->next[j])] &= ~BIT_MASK(fm->next[j]);
+
+        u32 *swap = fm->current;
+        fm->current = fm->next;
+        fm->next = swap;
+        current_length = next_length;
+    }
+
+    for (u32 i = 0; i < current_length; ++i)
+        if (ft->flags[fm->current[i]] & FSM_STATE_ACCEPTING) return true;
+
+    return false;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "defines.h"
+#include "node.h"
+#include "tline.h"
+
+#define FSM_TABLE_NONE UINT32_MAX
+// Characters that are not used by any tline
+#define FSM_TABLE_NO_COLUMN 0xff
+
+typedef enum FsmStateFlags {
+    FSM_STATE_INITIAL = 1 << 0,
+    FSM_STATE_ACCEPTING = 1 << 1,
+} FsmStateFlags;
+
+// One symbol of a tline, linked into its cell and into its tline
+typedef struct FsmEdge {
+        u32 target;
+        u32 tline;
+        u32 cell;
+        u32 next_in_cell;
+        u32 next_in_tline;
+} FsmEdge;
+
+typedef struct FsmTableTLine {
+        u32 start;  // State index or FSM_TABLE_NONE
+        u32 end;
+        u32 first_edge;
+} FsmTableTLine;
+
+// Transition table of the automaton. Edits of the model are applied as
+// patches that only touch the affected rows, the version tells which model
+// version the table matches. States and tlines are the darray indices
+typedef struct FsmTable {
+        u64 version;
+        bool built;  // Matches some version of the model
+        u8 columns[128];  // Column of each ASCII character
+        u32 column_count;
+        u32 stride;  // Cells per row, at least column_count
+        u32 state_count;
+        u32 state_capacity;
+        u32 initial;  // FSM_TABLE_NONE without an initial state
+        u8 *flags;  // FsmStateFlags of each state
+        u32 *heads;  // First edge of each cell
+        u32 *counts;  // Edges in each cell
+        u32 *next;  // Target of each cell with exactly one edge
+        u32 multi_cells;  // Cells with more than one edge
+        FsmEdge *edges;
+        u32 edge_count;  // Used slots, including freed ones
+        u32 edge_capacity;
+        u32 free_edge;  // Freed slots, linked through next_in_cell
+        FsmTableTLine *tlines;
+        u32 tline_count;
+        u32 tline_capacity;
+} FsmTable;
+
+// Header of a serialized table. The arrays follow in the order of the
+// pointers of FsmTable, each starting at a multiple of 8 bytes
+typedef struct FsmTableImage {
+        u8 columns[128];
+        u32 column_count;
+        u32 stride;
+        u32 state_count;
+        u32 initial;
+        u32 multi_cells;
+        u32 edge_count;
+        u32 free_edge;
+        u32 tline_count;
+} FsmTableImage;
+
+// Runs a table over inputs, the scratch space is reused between runs
+typedef struct FsmMatcher {
+        FsmTable *table;
+        u32 *current;  // Active states
+        u32 *next;
+        u64 *seen;  // Bitset of the states already in next
+} FsmMatcher;
+
+void fsm_table_create(FsmTable *ft);
+
+void fsm_table_destroy(FsmTable *ft);
+
+// Compiles the whole model
+bool fsm_table_rebuild(FsmTable *ft, Node *nodes, TLine *tlines, u64 version);
+
+// Rebuilds only when the table does not match the version
+bool fsm_table_sync(FsmTable *ft, Node *nodes, TLine *tlines, u64 version);
+
+bool fsm_table_copy(FsmTable *dst, FsmTable *src);
+
+// Bytes written by fsm_table_write_image
+u64 fsm_table_image_size(FsmTable *ft);
+
+void fsm_table_write_image(FsmTable *ft, void *dst);
+
+// Points the table into an 8 byte aligned image without copying, it can be
+// matched against but not patched or destroyed. Every index and list is
+// checked, so a damaged image is rejected instead of being read out of bounds
+bool fsm_table_view_image(FsmTable *view, const void *src, u64 size);
+
+// The table was built from this model. A checked view may still have been
+// written for another one, this compares the states and the tline symbols
+bool fsm_table_matches(FsmTable *ft, Node *nodes, TLine *tlines);
+
+// No cell has more than one edge
+bool fsm_table_is_deterministic(FsmTable *ft);
+
+// Appends a state
+bool fsm_table_add_state(FsmTable *ft, u8 flags);
+
+void fsm_table_set_state(FsmTable *ft, u32 state, u8 flags);
+
+// The state must have no tlines left, the last state takes its index
+void fsm_table_remove_state(FsmTable *ft, u32 state);
+
+// Replaces the edges of the tline, tline_count appends a new one
+bool fsm_table_set_tline(FsmTable *ft, u32 tline, u32 start, u32 end,
+                         const char *inputs, u32 len);
+
+// The last tline takes its index
+void fsm_table_remove_tline(FsmTable *ft, u32 tline);
+
+bool fsm_matcher_create(FsmMatcher *fm, FsmTable *ft);
+
+void fsm_matcher_destroy(FsmMatcher *fm);
+
+// Same result as the animation: accepted if an accepting state is active
+bool fsm_matcher_accepts(FsmMatcher *fm, const char *input, u64 len);
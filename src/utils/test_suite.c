@@ -0,0 +1,117 @@
+#include "test_suite.h"
+
+#include <raylib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+
+static void test_suite_evaluate(Job *job) {
+    TestSuite *ts = (TestSuite *)job->data;
+
+    FsmMatcher matcher;
+    if (!fsm_matcher_create(&matcher, &ts->table)) {
+        job_set_progress(job, ts->count);
+        return;
+    }
+
+    u64 failed = 0;
+    for (u64 i = 0; i < ts->count; ++i) {
+        // Checking every case would make the counters bounce between cores
+        if ((i & 1023) == 0) {
+            if (job_is_cancelled(job)) break;
+            job_set_progress(job, i);
+        }
+
+        TestCase *tc = &ts->cases[i];
+        bool accepted =
+            fsm_matcher_accepts(&matcher, &ts->text[tc->offset], tc->len);
+        if (accepted == tc->expected) continue;
+
+        // The index is written before the count that makes it visible
+        ts->failures[failed++] = i;
+        sync_store_u64(&ts->failed, failed);
+    }
+
+    fsm_matcher_destroy(&matcher);
+    if (!job_is_cancelled(job)) job_set_progress(job, ts->count);
+}
+
+bool test_suite_parse(TestSuite *ts, char *text, u64 len) {
+    memset(ts, 0, sizeof(TestSuite));
+    ts->text = text;
+
+    u64 lines = 1;
+    for (u64 i = 0; i < len; ++i) lines += text[i] == '\n';
+
+    ts->cases =
+        (TestCase *)memory_alloc(lines * sizeof(TestCase), MEMORY_TAG_ENGINE);
+    ts->failures = (u64 *)memory_alloc(lines * sizeof(u64), MEMORY_TAG_ENGINE);
+    if (!ts->cases || !ts->failures) {
+        test_suite_destroy(ts);
+        return false;
+    }
+
+    u64 skipped = 0;
+    for (u64 start = 0, line = 0; start < len; ++line) {
+        u64 end = start;
+        while (end < len && text[end] != '\n') ++end;
+        u64 next = end + 1;
+        if (end > start && text[end - 1] == '\r') --end;
+
+        char verdict = end > start ? text[start] : 0;
+        if (verdict == '+' || verdict == '-') {
+            ts->cases[ts->count++] = (TestCase){.offset = start + 1,
+                                                .len = end - start - 1,
+                                                .expected = verdict == '+'};
+        } else if (verdict && verdict != '#') {
+            if (!skipped)
+                TraceLog(LOG_WARNING, "Malformed test case on line %llu",
+                         (unsigned long long)line + 1);
+            ++skipped;
+        }
+        start = next;
+    }
+
+    if (skipped)
+        TraceLog(LOG_WARNING, "Skipped %llu malformed test cases",
+                 (unsigned long long)skipped);
+
+    return true;
+}
+
+bool test_suite_run(TestSuite *ts, WorkerPool *wp, CompletionQueue *completed,
+                    FsmTable *table) {
+    if (!fsm_table_copy(&ts->table, table)) return false;
+
+    job_init(&ts->job, test_suite_evaluate, ts, completed);
+    ts->job.total = ts->count;
+    worker_pool_submit(wp, &ts->job);
+
+    return true;
+}
+
+void test_suite_destroy(TestSuite *ts) {
+    fsm_table_destroy(&ts->table);
+    memory_free(ts->text);
+    memory_free(ts->cases);
+    memory_free(ts->failures);
+    ts->text = NULL;
+    ts->cases = NULL;
+    ts->failures = NULL;
+    ts->count = 0;
+    ts->failed = 0;
+}
+
+bool test_suite_is_running(TestSuite *ts) {
+    return ts->job.run && !job_is_finished(&ts->job);
+}
+
+u64 test_suite_get_done(TestSuite *ts) {
+    return sync_load_u64(&ts->job.progress);
+}
+
+const char *test_suite_get_case(TestSuite *ts, u64 index, u32 *len) {
+    *len = ts->cases[index].len;
+    return &ts->text[ts->cases[index].offset];
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defines.h"
+#include "table.h"
+#include "worker.h"
+
+typedef struct TestCase {
+        u64 offset;  // Start of the string in the suite text
+        u32 len;
+        bool expected;  // Whether the string should be accepted
+} TestCase;
+
+// Strings with expected verdicts, evaluated as a worker pool job. The job
+// progress counts the evaluated cases, the counters may be read at any time
+typedef struct TestSuite {
+        char *text;
+        TestCase *cases;
+        u64 count;
+        u64 *failures;  // Failing case indices, the first failed are valid
+        volatile u64 failed;
+        FsmTable table;
+        Job job;  // Its data is the suite
+} TestSuite;
+
+// One case per line: '+' for strings that should be accepted and '-' for
+// rejected ones, followed by the string. Empty lines and lines starting
+// with '#' are skipped. Takes ownership of the text
+bool test_suite_parse(TestSuite *ts, char *text, u64 len);
+
+// Copies the compiled automaton and submits the evaluation, the job is
+// pushed to the completion queue once it is done or cancelled
+bool test_suite_run(TestSuite *ts, WorkerPool *wp, CompletionQueue *completed,
+                    FsmTable *table);
+
+// Must not be called while the job is submitted and not yet completed
+void test_suite_destroy(TestSuite *ts);
+
+bool test_suite_is_running(TestSuite *ts);
+
+u64 test_suite_get_done(TestSuite *ts);
+
+const char *test_suite_get_case(TestSuite *ts, u64 index, u32 *len);
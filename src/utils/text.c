@@ -4,24 +4,30 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "memory.h"
+#include "text_layout.h"
+
 void text_box_create(TextBox *tb, Rectangle rect) {
     tb->rect = rect;
     tb->font_size = rect.height;
     tb->color = BLACK;
     tb->text = NULL;
+    tb->dirty = true;
 }
 
 void text_box_set_text_and_font(TextBox *tb, const char *text, u32 len,
                                 Font font) {
-    char *new_text = (char *)realloc(tb->text, (len + 1) * sizeof(char));
+    char *new_text = (char *)memory_realloc(
+        tb->text, (len + 1) * sizeof(char), MEMORY_TAG_UI);
     if (!new_text) return;
     for (u32 i = 0; i < len; ++i) new_text[i] = text[i];
     new_text[len] = 0;
     tb->text = new_text;
     tb->font = font;
+    tb->dirty = true;
 
     // Vector2 size = MeasureTextEx(tb->font, tb->text, tb->rect.height, 1.0f);
-    Vector2 size = MeasureTextEx(tb->font, tb->text, tb->rect.height, 1.0f);
+    Vector2 size = text_measure(tb->font, tb->rect.height, 1.0f, tb->text, len);
 
     float scale_x = tb->rect.width / size.x;
     float scale_y = tb->rect.height / size.y;
@@ -35,13 +41,15 @@ void text_box_set_text_and_font(TextBox *tb, const char *text, u32 len,
 
 void text_box_set_color(TextBox *tb, Color color) {
     tb->color = color;
+    tb->dirty = true;
 }
 
 void text_box_draw(TextBox *tb) {
     DrawTextEx(tb->font, tb->text, tb->position, tb->font_size, 1.0f,
                tb->color);
+    tb->dirty = false;
 }
 
 void text_box_destroy(TextBox *tb) {
-    free(tb->text);
+    memory_free(tb->text);
 }
@@ -11,6 +11,7 @@ typedef struct TextBox {
         Color color;
         Font font;
         float font_size;
+        bool dirty;  // Changed since it was last drawn
 } TextBox;
 
 void text_box_create(TextBox *tb, Rectangle rect);
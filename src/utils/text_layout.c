@@ -0,0 +1,160 @@
+#include "text_layout.h"
+
+#include <string.h>
+
+#include "darray.h"
+#include "hash.h"
+#include "thread.h"
+
+#define TEXT_CACHE_SIZE 256
+// Longer strings are measured every time
+#define TEXT_CACHE_MAX_LEN 64
+
+typedef struct TextCacheEntry {
+        u64 hash;
+        u32 font_id;
+        u32 len;
+        float font_size;
+        float spacing;
+        Vector2 size;
+        bool used;
+        char text[TEXT_CACHE_MAX_LEN];  // Compared on a hit, hashes collide
+} TextCacheEntry;
+
+// Models are also built on worker threads, each thread measures on its own
+static THREAD_LOCAL TextCacheEntry text_cache[TEXT_CACHE_SIZE];
+
+static float glyph_advance(Font font, int codepoint);
+
+static Vector2 text_measure_uncached(Font font, float font_size,
+                                     float spacing, const char *text, u32 len);
+
+static u32 text_run_find(TextRun *run, double offset);
+
+void text_run_create(TextRun *run, Font font, float font_size, float spacing) {
+    run->font = font;
+    run->font_size = font_size;
+    run->spacing = spacing;
+    run->prefix = darray_create_tagged(double, MEMORY_TAG_UI);
+    run->len = 0;
+    darray_push(&run->prefix, 0.0);
+}
+
+void text_run_destroy(TextRun *run) {
+    darray_destroy(run->prefix);
+}
+
+void text_run_set_text(TextRun *run, const char *text, u32 len) {
+    darray_clear(run->prefix);
+    if (!darray_reserve(&run->prefix, (u64)len + 1)) {
+        run->len = 0;
+        darray_push(&run->prefix, 0.0);
+        return;
+    }
+
+    double scale = run->font_size / (double)run->font.baseSize;
+    double offset = 0.0;
+    darray_push(&run->prefix, offset);
+    for (u32 i = 0; i < len; ++i) {
+        offset += (glyph_advance(run->font, text[i]) * scale) + run->spacing;
+        darray_push(&run->prefix, offset);
+    }
+    run->len = len;
+}
+
+float text_run_get_width(TextRun *run, u32 from, u32 to) {
+    to = CLAMP_MAX(to, run->len);
+    if (from >= to) return 0.0f;
+    // No spacing after the last glyph
+    return (float)(run->prefix[to] - run->prefix[from] - run->spacing);
+}
+
+void text_run_draw(TextRun *run, const char *text, u32 from, u32 to,
+                   u32 anchor, Vector2 position, float min_x, float max_x,
+                   Color color) {
+    to = CLAMP_MAX(to, run->len);
+    anchor = CLAMP_MAX(anchor, run->len);
+    if (from >= to) return;
+
+    // Screen x of the start of the line
+    double origin = position.x - run->prefix[anchor];
+
+    // First glyph ending after min_x and first glyph starting after max_x
+    u32 first = text_run_find(run, min_x - origin);
+    u32 last = text_run_find(run, max_x - origin) + 1;
+    first = CLAMP_MIN(first, from);
+    last = CLAMP_MAX(last, to);
+
+    for (u32 i = first; i < last; ++i) {
+        if (text[i] == ' ') continue;
+        Vector2 pos = {(float)(origin + run->prefix[i]), position.y};
+        DrawTextCodepoint(run->font, text[i], pos, run->font_size, color);
+    }
+}
+
+float text_glyph_width(Font font, float font_size, int codepoint) {
+    return glyph_advance(font, codepoint) * (font_size / (float)font.baseSize);
+}
+
+Vector2 text_measure(Font font, float font_size, float spacing,
+                     const char *text, u32 len) {
+    if (!text || !len) return (Vector2){0};
+    if (len > TEXT_CACHE_MAX_LEN)
+        return text_measure_uncached(font, font_size, spacing, text, len);
+
+    u64 hash = fnv1a_64(FNV1A_64_OFFSET, text, len);
+    u32 slot = (u32)(hash ^ font.texture.id ^ (u32)font_size)
+             % TEXT_CACHE_SIZE;
+    TextCacheEntry *entry = &text_cache[slot];
+
+    if (entry->used && entry->hash == hash && entry->len == len
+        && entry->font_id == font.texture.id && entry->font_size == font_size
+        && entry->spacing == spacing && !memcmp(entry->text, text, len))
+        return entry->size;
+
+    *entry = (TextCacheEntry){
+        .hash = hash,
+        .font_id = font.texture.id,
+        .len = len,
+        .font_size = font_size,
+        .spacing = spacing,
+        .size = text_measure_uncached(font, font_size, spacing, text, len),
+        .used = true
+    };
+    memcpy(entry->text, text, len);
+
+    return entry->size;
+}
+
+static float glyph_advance(Font font, int codepoint) {
+    int index = GetGlyphIndex(font, codepoint);
+    if (font.glyphs[index].advanceX > 0) return font.glyphs[index].advanceX;
+    return font.recs[index].width + font.glyphs[index].offsetX;
+}
+
+// Spacing goes between codepoints, not between the bytes of UTF-8
+static Vector2 text_measure_uncached(Font font, float font_size,
+                                     float spacing, const char *text,
+                                     u32 len) {
+    float scale = font_size / (float)font.baseSize;
+    float width = 0.0f;
+    u32 count = 0;
+    for (u32 i = 0; i < len;) {
+        int size = 1;
+        width += glyph_advance(font, GetCodepointNext(&text[i], &size));
+        count++;
+        i += size;
+    }
+    return (Vector2){(width * scale) + ((count - 1) * spacing), font_size};
+}
+
+// Index of the glyph containing the offset
+static u32 text_run_find(TextRun *run, double offset) {
+    u32 low = 0, high = run->len;
+    while (low < high) {
+        u32 mid = low + ((high - low) / 2);
+        if (run->prefix[mid + 1] <= offset) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
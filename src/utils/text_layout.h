@@ -0,0 +1,40 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "defines.h"
+
+// Measured widths of a single line of ASCII text, prefix[i] is the offset of
+// the i-th glyph from the start of the line. Offsets are doubles so that
+// lines millions of glyphs long stay exact.
+typedef struct TextRun {
+        Font font;
+        float font_size;
+        float spacing;
+        double *prefix;  // Darray of len + 1 offsets
+        u32 len;
+} TextRun;
+
+void text_run_create(TextRun *run, Font font, float font_size, float spacing);
+
+void text_run_destroy(TextRun *run);
+
+void text_run_set_text(TextRun *run, const char *text, u32 len);
+
+// Width of the glyphs [from, to), same as MeasureTextEx on that substring
+float text_run_get_width(TextRun *run, u32 from, u32 to);
+
+// Draws the glyphs [from, to) that overlap [min_x, max_x], position is where
+// the glyph at anchor starts. Anchoring near the visible part keeps positions
+// exact however far the line extends off screen.
+void text_run_draw(TextRun *run, const char *text, u32 from, u32 to,
+                   u32 anchor, Vector2 position, float min_x, float max_x,
+                   Color color);
+
+// Width of a single glyph, same as MeasureTextEx on a one character string
+float text_glyph_width(Font font, float font_size, int codepoint);
+
+// MeasureTextEx on a line of UTF-8, backed by a cache keyed by font, size
+// and string contents
+Vector2 text_measure(Font font, float font_size, float spacing,
+                     const char *text, u32 len);
@@ -0,0 +1,247 @@
+#include "thread.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+// windows.h must stay out of files that include raylib.h
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+typedef struct ThreadStart {
+        ThreadFunc func;
+        void *arg;
+} ThreadStart;
+
+#if defined(_WIN32)
+static DWORD WINAPI thread_start(LPVOID param) {
+#else
+static void *thread_start(void *param) {
+#endif
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+bool thread_create(Thread *t, ThreadFunc func, void *arg) {
+    t->handle = NULL;
+    t->running = false;
+
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (!start) return false;
+    start->func = func;
+    start->arg = arg;
+
+#if defined(_WIN32)
+    HANDLE handle = CreateThread(NULL, 0, thread_start, start, 0, NULL);
+    if (!handle) {
+        free(start);
+        return false;
+    }
+    t->handle = handle;
+#else
+    pthread_t *handle = (pthread_t *)malloc(sizeof(pthread_t));
+    if (!handle || pthread_create(handle, NULL, thread_start, start) != 0) {
+        free(handle);
+        free(start);
+        return false;
+    }
+    t->handle = handle;
+#endif
+
+    t->running = true;
+    return true;
+}
+
+void thread_join(Thread *t) {
+    if (!t->running) return;
+
+#if defined(_WIN32)
+    WaitForSingleObject((HANDLE)t->handle, INFINITE);
+    CloseHandle((HANDLE)t->handle);
+#else
+    pthread_join(*(pthread_t *)t->handle, NULL);
+    free(t->handle);
+#endif
+
+    t->handle = NULL;
+    t->running = false;
+}
+
+#if defined(_WIN32)
+bool mutex_create(Mutex *m) {
+    m->handle = malloc(sizeof(CRITICAL_SECTION));
+    if (!m->handle) return false;
+    InitializeCriticalSection((CRITICAL_SECTION *)m->handle);
+    return true;
+}
+
+void mutex_destroy(Mutex *m) {
+    if (!m->handle) return;
+    DeleteCriticalSection((CRITICAL_SECTION *)m->handle);
+    free(m->handle);
+    m->handle = NULL;
+}
+
+void mutex_lock(Mutex *m) {
+    EnterCriticalSection((CRITICAL_SECTION *)m->handle);
+}
+
+void mutex_unlock(Mutex *m) {
+    LeaveCriticalSection((CRITICAL_SECTION *)m->handle);
+}
+
+bool cond_create(Cond *c) {
+    c->handle = malloc(sizeof(CONDITION_VARIABLE));
+    if (!c->handle) return false;
+    InitializeConditionVariable((CONDITION_VARIABLE *)c->handle);
+    return true;
+}
+
+void cond_destroy(Cond *c) {
+    free(c->handle);
+    c->handle = NULL;
+}
+
+void cond_wait(Cond *c, Mutex *m) {
+    SleepConditionVariableCS((CONDITION_VARIABLE *)c->handle,
+                             (CRITICAL_SECTION *)m->handle, INFINITE);
+}
+
+void cond_wait_timeout(Cond *c, Mutex *m, double seconds) {
+    SleepConditionVariableCS((CONDITION_VARIABLE *)c->handle,
+                             (CRITICAL_SECTION *)m->handle,
+                             (DWORD)(seconds * 1000.0));
+}
+
+void cond_broadcast(Cond *c) {
+    WakeAllConditionVariable((CONDITION_VARIABLE *)c->handle);
+}
+#else
+bool mutex_create(Mutex *m) {
+    m->handle = malloc(sizeof(pthread_mutex_t));
+    if (!m->handle) return false;
+    if (pthread_mutex_init((pthread_mutex_t *)m->handle, NULL) == 0)
+        return true;
+    free(m->handle);
+    m->handle = NULL;
+    return false;
+}
+
+void mutex_destroy(Mutex *m) {
+    if (!m->handle) return;
+    pthread_mutex_destroy((pthread_mutex_t *)m->handle);
+    free(m->handle);
+    m->handle = NULL;
+}
+
+void mutex_lock(Mutex *m) {
+    pthread_mutex_lock((pthread_mutex_t *)m->handle);
+}
+
+void mutex_unlock(Mutex *m) {
+    pthread_mutex_unlock((pthread_mutex_t *)m->handle);
+}
+
+bool cond_create(Cond *c) {
+    c->handle = malloc(sizeof(pthread_cond_t));
+    if (!c->handle) return false;
+    if (pthread_cond_init((pthread_cond_t *)c->handle, NULL) == 0) return true;
+    free(c->handle);
+    c->handle = NULL;
+    return false;
+}
+
+void cond_destroy(Cond *c) {
+    if (!c->handle) return;
+    pthread_cond_destroy((pthread_cond_t *)c->handle);
+    free(c->handle);
+    c->handle = NULL;
+}
+
+void cond_wait(Cond *c, Mutex *m) {
+    pthread_cond_wait((pthread_cond_t *)c->handle,
+                      (pthread_mutex_t *)m->handle);
+}
+
+void cond_wait_timeout(Cond *c, Mutex *m, double seconds) {
+    // The deadline is on the clock the condition was created with
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    u64 nanoseconds = (u64)deadline.tv_nsec + (u64)(seconds * 1e9);
+    deadline.tv_sec += nanoseconds / 1000000000;
+    deadline.tv_nsec = nanoseconds % 1000000000;
+    pthread_cond_timedwait((pthread_cond_t *)c->handle,
+                           (pthread_mutex_t *)m->handle, &deadline);
+}
+
+void cond_broadcast(Cond *c) {
+    pthread_cond_broadcast((pthread_cond_t *)c->handle);
+}
+#endif
+
+#if defined(_MSC_VER)
+u64 sync_load_u64(volatile u64 *p) {
+    return (u64)InterlockedCompareExchange64((volatile LONG64 *)p, 0, 0);
+}
+
+void sync_store_u64(volatile u64 *p, u64 value) {
+    InterlockedExchange64((volatile LONG64 *)p, (LONG64)value);
+}
+
+u64 sync_add_u64(volatile u64 *p, u64 value) {
+    return (u64)InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)value);
+}
+
+bool sync_cas_u64(volatile u64 *p, u64 expected, u64 desired) {
+    return (u64)InterlockedCompareExchange64((volatile LONG64 *)p,
+                                             (LONG64)desired, (LONG64)expected)
+        == expected;
+}
+
+void *sync_load_ptr(void *volatile *p) {
+    return InterlockedCompareExchangePointer(p, NULL, NULL);
+}
+
+void *sync_exchange_ptr(void *volatile *p, void *value) {
+    return InterlockedExchangePointer(p, value);
+}
+
+bool sync_cas_ptr(void *volatile *p, void *expected, void *desired) {
+    return InterlockedCompareExchangePointer(p, desired, expected) == expected;
+}
+#else
+u64 sync_load_u64(volatile u64 *p) {
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+void sync_store_u64(volatile u64 *p, u64 value) {
+    __atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+u64 sync_add_u64(volatile u64 *p, u64 value) {
+    return __atomic_fetch_add(p, value, __ATOMIC_SEQ_CST);
+}
+
+bool sync_cas_u64(volatile u64 *p, u64 expected, u64 desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+void *sync_load_ptr(void *volatile *p) {
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+void *sync_exchange_ptr(void *volatile *p, void *value) {
+    return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+bool sync_cas_ptr(void *volatile *p, void *expected, void *desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
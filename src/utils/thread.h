@@ -0,0 +1,68 @@
+#pragma once
+
+#include "defines.h"
+
+#if defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL _Thread_local
+#endif
+
+typedef void (*ThreadFunc)(void *arg);
+
+typedef struct Thread {
+        void *handle;
+        bool running;  // Created and not joined yet
+} Thread;
+
+bool thread_create(Thread *t, ThreadFunc func, void *arg);
+
+// Blocks until the thread returns, does nothing if it is not running
+void thread_join(Thread *t);
+
+typedef struct Mutex {
+        void *handle;
+} Mutex;
+
+typedef struct Cond {
+        void *handle;
+} Cond;
+
+bool mutex_create(Mutex *m);
+
+void mutex_destroy(Mutex *m);
+
+void mutex_lock(Mutex *m);
+
+void mutex_unlock(Mutex *m);
+
+bool cond_create(Cond *c);
+
+void cond_destroy(Cond *c);
+
+// The mutex must be locked, it is locked again when this returns
+void cond_wait(Cond *c, Mutex *m);
+
+// Like cond_wait, but gives up after the given number of seconds
+void cond_wait_timeout(Cond *c, Mutex *m, double seconds);
+
+void cond_broadcast(Cond *c);
+
+// Sequentially consistent operations on values shared between threads
+u64 sync_load_u64(volatile u64 *p);
+
+void sync_store_u64(volatile u64 *p, u64 value);
+
+// Returns the previous value
+u64 sync_add_u64(volatile u64 *p, u64 value);
+
+// Stores desired if *p is expected, returns whether it did
+bool sync_cas_u64(volatile u64 *p, u64 expected, u64 desired);
+
+void *sync_load_ptr(void *volatile *p);
+
+// Returns the previous value
+void *sync_exchange_ptr(void *volatile *p, void *value);
+
+// Stores desired if *p is expected, returns whether it did
+bool sync_cas_ptr(void *volatile *p, void *expected, void *desired);
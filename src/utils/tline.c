@@ -3,12 +3,18 @@
 #include <raymath.h>
 #include <stdlib.h>
 
+// Number of points used to approximate a self loop when zoomed out
+#define TLINE_LOOP_REDUCED_POINTS 9
+
 static bool check_collision_point_bezier_cubic(Vector2 point, Vector2 p0,
                                                Vector2 p1, Vector2 p2,
                                                Vector2 p3, float thickness,
                                                u32 segments);
 
-static void tlines_process_input(TLine *tl);
+static u32 tline_merge_inputs(char *merged, const char *first, u32 first_len,
+                              const char *second, u32 second_len);
+
+static void tline_get_loop_points(TLine *tl, Vector2 *points, u32 count);
 
 static i32 tline_update_editing(TLine *tl, Vector2 mpos, i32 handled);
 
@@ -23,8 +29,7 @@ void tline_create(TLine *tl) {
     tline_set_start_node(tl, NULL);
     tline_set_end_node(tl, NULL);
     tline_set_font(tl, GetFontDefault());
-    tl->inputs = NULL;
-    tl->len = 0;
+    small_string_create(&tl->inputs);
     tl->pressed = false;
     tl->selected = false;
     tl->state = TLINE_STATE_NORMAL;
@@ -32,7 +37,8 @@ void tline_create(TLine *tl) {
 }
 
 void tline_destroy(TLine *tl) {
-    free(tl->inputs);
+    // The inputs are freed with the arena of the model
+    UNUSED(tl);
 }
 
 void tline_set_colors(TLine *tl, TLineColors colors) {
@@ -51,20 +57,31 @@ void tline_set_end_node(TLine *tl, Node *n) {
     tl->end = n;
 }
 
-void tline_set_inputs(TLine *tl, const char *inputs, u32 len) {
-    char *new_inputs = (char *)realloc(tl->inputs, (len + 1) * sizeof(char));
-    if (!new_inputs) return;
+// Inputs read back from a file are already sorted without duplicates
+static bool tline_inputs_are_merged(const char *inputs, u32 len) {
+    for (u32 i = 0; i < len; ++i) {
+        u8 c = inputs[i];
+        if (!c || c >= TLINE_MAX_INPUTS || (i && c <= (u8)inputs[i - 1]))
+            return false;
+    }
+    return true;
+}
+
+void tline_set_inputs(TLine *tl, Arena *arena, const char *inputs, u32 len) {
+    if (tline_inputs_are_merged(inputs, len)) {
+        small_string_set(&tl->inputs, arena, inputs, len);
+        return;
+    }
+
+    char merged[TLINE_MAX_INPUTS + 1];
+    u32 merged_len = tline_merge_inputs(merged, inputs, len, NULL, 0);
     // TraceLog(LOG_INFO, "%s", inputs);
-    for (u32 i = 0; i < len; ++i) new_inputs[i] = inputs[i];
-    new_inputs[len] = 0;
-    tl->inputs = new_inputs;
-    tl->len = len;
-    tlines_process_input(tl);
+    small_string_set(&tl->inputs, arena, merged, merged_len);
 }
 
 const char *tline_get_inputs(TLine *tl, u32 *len) {
-    if (len) *len = tl->len;
-    return tl->inputs;
+    if (len) *len = tl->inputs.len;
+    return small_string_get(&tl->inputs);
 }
 
 i32 tline_update(TLine *tl, Vector2 mpos, i32 handled) {
@@ -72,70 +89,104 @@ i32 tline_update(TLine *tl, Vector2 mpos, i32 handled) {
                        : tline_update_animating(tl, handled);
 }
 
-void tline_draw(TLine *tl) {
-    Color color;
+Color tline_get_color(TLine *tl) {
+    if (tl->selected) return BLACK;
+
     switch (tl->state) {
         case TLINE_STATE_DOWN:
-            color = tl->colors.down;
-            break;
+            return tl->colors.down;
         case TLINE_STATE_HOVERED:
-            color = tl->colors.hovered;
-            break;
+            return tl->colors.hovered;
         case TLINE_STATE_HIGHLIGHTED:
-            color = tl->colors.highlighted;
-            break;
+            return tl->colors.highlighted;
         case TLINE_STATE_NORMAL:
         default:
-            color = tl->colors.normal;
-            break;
+            return tl->colors.normal;
     }
+}
+
+void tline_draw(TLine *tl, float zoom) {
+    if (!tl->start || !tl->end) return;
+
+    Color color = tline_get_color(tl);
+    DetailLevel detail = node_get_detail_level(
+        fminf(tl->start->radius, tl->end->radius), zoom);
+
+    if (tl->start != tl->end) {
+        if (detail == DETAIL_LEVEL_MINIMAL) {
+            // Edges shorter than the discs they join are fully covered
+            if (Vector2Distance(tl->start->center, tl->end->center)
+                <= tl->start->radius + tl->end->radius)
+                return;
+            DrawLineV(tl->start->center, tl->end->center, color);
+            return;
+        }
 
-    if (tl->start && tl->end) {
-        if (tl->start != tl->end) {
-            Vector2 center =
-                Vector2Lerp(tl->start->center, tl->end->center, 0.60);
-            Vector2 dir = Vector2Normalize(
-                Vector2Subtract(tl->end->center, tl->start->center));
-            Vector2 perp = {-dir.y, dir.x};
-            Vector2 points[3] = {Vector2Add(center, Vector2Scale(perp, 10)),
-                                 Vector2Add(center, Vector2Scale(dir, 20)),
-                                 Vector2Add(center, Vector2Scale(perp, -10))};
-
-            Vector2 text_pos = Vector2Add(center, Vector2Scale(perp, 11));
-            // if (dir.x < 0) text_pos = Vector2Add(center, Vector2Scale(perp,
-            // -11));
-
-            // DrawLineBezier(tl->start->center, tl->end->center, 2.0f,
-            //                tl->selected ? BLACK : color);
-            DrawLineEx(tl->start->center, tl->end->center, 3.0f,
-                       tl->selected ? BLACK : color);
-            DrawTriangle(points[0], points[1], points[2],
-                         tl->selected ? BLACK : color);
-            DrawTextEx(tl->font, tl->inputs, text_pos, 32, 1.0f,
-                       tl->selected ? BLACK : color);
-        } else {
-            // Self loop
-            DrawSplineBezierCubic(tl->points, 4, 3.0f,
-                                  tl->selected ? BLACK : color);
-            DrawTextEx(
-                tl->font, tl->inputs,
-                (Vector2){tl->start->center.x - 30.0f,
-                          tl->start->center.y - tl->start->radius * 3.0f},
-                32, 1.0f, tl->selected ? BLACK : color);
+        Vector2 points[3];
+        tline_get_arrow_points(tl, points);
+
+        // DrawLineBezier(tl->start->center, tl->end->center, 2.0f,
+        //                tl->selected ? BLACK : color);
+        DrawLineEx(tl->start->center, tl->end->center, 3.0f, color);
+        DrawTriangle(points[0], points[1], points[2], color);
+    } else {
+        // Self loop
+        if (detail == DETAIL_LEVEL_MINIMAL) return;
+
+        if (detail == DETAIL_LEVEL_REDUCED) {
+            Vector2 points[TLINE_LOOP_REDUCED_POINTS];
+            tline_get_loop_points(tl, points, TLINE_LOOP_REDUCED_POINTS);
+            DrawLineStrip(points, TLINE_LOOP_REDUCED_POINTS, color);
+            return;
         }
+
+        DrawSplineBezierCubic(tl->points, 4, 3.0f, color);
     }
+
+    tline_draw_label(tl, zoom);
 }
 
-void tline_append_inputs(TLine *tl, const char *input, u32 len) {
-    char *new_input =
-        (char *)realloc(tl->inputs, (tl->len + len + 1) * sizeof(char));
-    if (!new_input) return;
-    for (u32 i = tl->len; i < tl->len + len; ++i)
-        new_input[i] = input[i - tl->len];
-    tl->inputs = new_input;
-    tl->len += len;
-    tl->inputs[tl->len] = 0;
-    tlines_process_input(tl);
+void tline_draw_label(TLine *tl, float zoom) {
+    if (!tl->start || !tl->end) return;
+
+    DetailLevel detail = node_get_detail_level(
+        fminf(tl->start->radius, tl->end->radius), zoom);
+    if (detail != DETAIL_LEVEL_FULL) return;
+
+    Vector2 text_pos;
+    if (tl->start != tl->end) {
+        Vector2 center = Vector2Lerp(tl->start->center, tl->end->center, 0.60);
+        Vector2 dir = Vector2Normalize(
+            Vector2Subtract(tl->end->center, tl->start->center));
+        Vector2 perp = {-dir.y, dir.x};
+        text_pos = Vector2Add(center, Vector2Scale(perp, 11));
+        // if (dir.x < 0) text_pos = Vector2Add(center, Vector2Scale(perp,
+        // -11));
+    } else {
+        text_pos = (Vector2){tl->start->center.x - 30.0f,
+                             tl->start->center.y - tl->start->radius * 3.0f};
+    }
+
+    DrawTextEx(tl->font, small_string_get(&tl->inputs), text_pos, 32, 1.0f,
+               tline_get_color(tl));
+}
+
+void tline_get_arrow_points(TLine *tl, Vector2 *points) {
+    Vector2 center = Vector2Lerp(tl->start->center, tl->end->center, 0.60);
+    Vector2 dir =
+        Vector2Normalize(Vector2Subtract(tl->end->center, tl->start->center));
+    Vector2 perp = {-dir.y, dir.x};
+    points[0] = Vector2Add(center, Vector2Scale(perp, 10));
+    points[1] = Vector2Add(center, Vector2Scale(dir, 20));
+    points[2] = Vector2Add(center, Vector2Scale(perp, -10));
+}
+
+void tline_append_inputs(TLine *tl, Arena *arena, const char *input,
+                         u32 len) {
+    char merged[TLINE_MAX_INPUTS + 1];
+    u32 merged_len = tline_merge_inputs(merged, small_string_get(&tl->inputs),
+                                        tl->inputs.len, input, len);
+    small_string_set(&tl->inputs, arena, merged, merged_len);
 }
 
 static bool check_collision_point_bezier_cubic(Vector2 mpos, Vector2 p0,
@@ -162,14 +213,34 @@ static bool check_collision_point_bezier_cubic(Vector2 mpos, Vector2 p0,
     return false;
 }
 
-static void tlines_process_input(TLine *tl) {
-    char buf[128] = {0};
-    for (u32 i = 0; tl->inputs[i]; ++i) buf[(int)tl->inputs[i]]++;
-    tl->len = 0;
-    for (u32 i = 0; i < 128; ++i)
-        if (buf[i]) tl->inputs[tl->len++] = (char)i;
+static void tline_get_loop_points(TLine *tl, Vector2 *points, u32 count) {
+    Vector2 *p = tl->points;
+    for (u32 i = 0; i < count; ++i) {
+        float t = (float)i / (float)(count - 1);
+        float u = 1.0f - t;
+        points[i] = (Vector2){
+            u * u * u * p[0].x + 3 * u * u * t * p[1].x + 3 * u * t * t * p[2].x
+                + t * t * t * p[3].x,
+            u * u * u * p[0].y + 3 * u * u * t * p[1].y + 3 * u * t * t * p[2].y
+                + t * t * t * p[3].y};
+    }
+}
 
-    tl->inputs[tl->len] = 0;
+// Sorted without duplicates, the result is null terminated
+static u32 tline_merge_inputs(char *merged, const char *first, u32 first_len,
+                              const char *second, u32 second_len) {
+    bool buf[TLINE_MAX_INPUTS] = {0};
+    for (u32 i = 0; i < first_len; ++i)
+        if ((u8)first[i] < TLINE_MAX_INPUTS) buf[(u8)first[i]] = true;
+    for (u32 i = 0; i < second_len; ++i)
+        if ((u8)second[i] < TLINE_MAX_INPUTS) buf[(u8)second[i]] = true;
+
+    u32 len = 0;
+    // The terminator is not an input
+    for (u32 i = 1; i < TLINE_MAX_INPUTS; ++i)
+        if (buf[i]) merged[len++] = (char)i;
+    merged[len] = 0;
+    return len;
 }
 
 static i32 tline_update_editing(TLine *tl, Vector2 mpos, i32 handled) {
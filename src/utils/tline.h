@@ -2,8 +2,13 @@
 
 #include <raylib.h>
 
+#include "arena.h"
 #include "defines.h"
 #include "node.h"
+#include "small_string.h"
+
+// Inputs are ASCII characters
+#define TLINE_MAX_INPUTS 128
 
 typedef enum TLineState {
     TLINE_STATE_NORMAL,
@@ -28,8 +33,7 @@ typedef struct TLine {
         Node *start;
         Node *end;
         Font font;
-        char *inputs;
-        u32 len;
+        SmallString inputs;  // Sorted without duplicates
         bool pressed;
         bool editing;
         bool selected;
@@ -43,7 +47,8 @@ void tline_set_start_node(TLine *tl, Node *n);
 
 void tline_set_end_node(TLine *tl, Node *n);
 
-void tline_set_inputs(TLine *tl, const char *inputs, u32 len);
+// Long inputs are stored in the arena
+void tline_set_inputs(TLine *tl, Arena *arena, const char *inputs, u32 len);
 
 void tline_set_colors(TLine *tl, TLineColors colors);
 
@@ -53,6 +58,14 @@ const char *tline_get_inputs(TLine *tl, u32 *len);
 
 i32 tline_update(TLine *tl, Vector2 mpos, i32 handled);
 
-void tline_draw(TLine *tl);
+Color tline_get_color(TLine *tl);
+
+void tline_draw(TLine *tl, float zoom);
+
+void tline_draw_label(TLine *tl, float zoom);
+
+// Fills the 3 points of the arrowhead of a non self loop tline
+void tline_get_arrow_points(TLine *tl, Vector2 *points);
 
-void tline_append_inputs(TLine *tl, const char *input, u32 len);
+void tline_append_inputs(TLine *tl, Arena *arena, const char *input,
+                         u32 len);
@@ -0,0 +1,217 @@
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+
+#define BIT_WORD(bit) ((bit) >> 6)
+#define BIT_MASK(bit) (1ULL << ((bit) & 63))
+
+// Consumes the symbol from the listed states, the row dedupes the targets.
+// Fired may be NULL
+static u32 run_trace_take(FsmTable *ft, char symbol, u32 *states,
+                          u32 length, u32 *next, u64 *next_row, u64 *fired) {
+    u8 column = ft->columns[symbol & 127];
+    if (column == FSM_TABLE_NO_COLUMN) return 0;
+
+    u32 next_length = 0;
+    for (u32 i = 0; i < length; ++i) {
+        u64 cell = (u64)states[i] * ft->stride + column;
+        for (u32 e = ft->heads[cell]; e != FSM_TABLE_NONE;
+             e = ft->edges[e].next_in_cell) {
+            FsmEdge *edge = &ft->edges[e];
+            if (fired) fired[BIT_WORD(edge->tline)] |= BIT_MASK(edge->tline);
+            if (next_row[BIT_WORD(edge->target)] & BIT_MASK(edge->target))
+                continue;
+            next_row[BIT_WORD(edge->target)] |= BIT_MASK(edge->target);
+            next[next_length++] = edge->target;
+        }
+    }
+
+    return next_length;
+}
+
+// Only the words of the listed states can be set
+static void run_trace_clear_row(u64 *row, u32 *states, u32 length) {
+    for (u32 i = 0; i < length; ++i) row[BIT_WORD(states[i])] = 0;
+}
+
+// The next states become the active ones
+static void run_trace_swap(RunTrace *rt) {
+    run_trace_clear_row(rt->active, rt->states, rt->state_length);
+
+    u64 *row = rt->active;
+    rt->active = rt->next_active;
+    rt->next_active = row;
+    u32 *states = rt->states;
+    rt->states = rt->next_states;
+    rt->next_states = states;
+    rt->state_length = rt->next_state_length;
+    rt->next_state_length = 0;
+}
+
+// Fills the next states and the fired row from the active states
+static void run_trace_transition(RunTrace *rt) {
+    memset(rt->fired, 0, rt->tline_words * sizeof(u64));
+    run_trace_clear_row(rt->next_active, rt->next_states,
+                        rt->next_state_length);
+    rt->next_state_length = 0;
+    if (rt->step >= rt->len) return;
+
+    rt->next_state_length = run_trace_take(
+        &rt->table, rt->input[rt->step], rt->states, rt->state_length,
+        rt->next_states, rt->next_active, rt->fired);
+}
+
+// Puts the cursor on the step, which must have a checkpoint
+static void run_trace_load(RunTrace *rt, u64 step) {
+    u64 *row = &rt->checkpoints[step / rt->interval * rt->node_words];
+    memcpy(rt->active, row, rt->node_words * sizeof(u64));
+
+    rt->state_length = 0;
+    for (u32 i = 0; i < rt->table.state_count; ++i)
+        if (row[BIT_WORD(i)] & BIT_MASK(i)) rt->states[rt->state_length++] = i;
+
+    rt->step = step;
+    run_trace_transition(rt);
+}
+
+// Replays from the checkpoint before the step, unless the cursor is already
+// between the two
+static void run_trace_seek(RunTrace *rt, u64 step) {
+    u64 checkpoint = step - step % rt->interval;
+    if (rt->step > step || rt->step < checkpoint)
+        run_trace_load(rt, checkpoint);
+
+    while (rt->step < step) {
+        run_trace_swap(rt);
+        rt->step++;
+        run_trace_transition(rt);
+    }
+}
+
+bool run_trace_create(RunTrace *rt, FsmTable *ft, const char *input,
+                      u64 len) {
+    memset(rt, 0, sizeof(RunTrace));
+    fsm_table_create(&rt->table);
+    rt->len = len;
+    rt->node_words = CLAMP_MIN((ft->state_count + 63) / 64, 1);
+    rt->tline_words = CLAMP_MIN((ft->tline_count + 63) / 64, 1);
+    rt->step = UINT64_MAX;
+
+    u64 row_size = rt->node_words * sizeof(u64);
+    rt->interval = RUN_TRACE_MIN_INTERVAL;
+    while (rt->interval <= len
+           && (len / rt->interval + 1) * row_size
+                  > RUN_TRACE_CHECKPOINT_BUDGET)
+        rt->interval *= 2;
+
+    rt->input = (char *)memory_alloc(CLAMP_MIN(len, 1), MEMORY_TAG_STRINGS);
+    rt->checkpoints =
+        (u64 *)memory_calloc((len / rt->interval + 1) * rt->node_words,
+                             sizeof(u64), MEMORY_TAG_ENGINE);
+    rt->active =
+        (u64 *)memory_calloc(rt->node_words, sizeof(u64), MEMORY_TAG_ENGINE);
+    rt->next_active =
+        (u64 *)memory_calloc(rt->node_words, sizeof(u64), MEMORY_TAG_ENGINE);
+    rt->fired =
+        (u64 *)memory_calloc(rt->tline_words, sizeof(u64), MEMORY_TAG_ENGINE);
+    u64 states_size = CLAMP_MIN(ft->state_count, 1) * sizeof(u32);
+    rt->states = (u32 *)memory_alloc(states_size, MEMORY_TAG_ENGINE);
+    rt->next_states = (u32 *)memory_alloc(states_size, MEMORY_TAG_ENGINE);
+
+    if (!rt->input || !rt->checkpoints || !rt->active || !rt->next_active
+        || !rt->fired || !rt->states || !rt->next_states
+        || !fsm_table_copy(&rt->table, ft)) {
+        run_trace_destroy(rt);
+        return false;
+    }
+
+    if (len) memcpy(rt->input, input, len);
+
+    return true;
+}
+
+void run_trace_destroy(RunTrace *rt) {
+    fsm_table_destroy(&rt->table);
+    memory_free(rt->input);
+    memory_free(rt->checkpoints);
+    memory_free(rt->active);
+    memory_free(rt->next_active);
+    memory_free(rt->fired);
+    memory_free(rt->states);
+    memory_free(rt->next_states);
+    rt->input = NULL;
+    rt->checkpoints = NULL;
+    rt->active = NULL;
+    rt->next_active = NULL;
+    rt->fired = NULL;
+    rt->states = NULL;
+    rt->next_states = NULL;
+    rt->len = 0;
+}
+
+void run_trace_build(RunTrace *rt, Job *job) {
+    FsmTable *ft = &rt->table;
+
+    rt->state_length = 0;
+    if (ft->initial != FSM_TABLE_NONE) {
+        rt->active[BIT_WORD(ft->initial)] |= BIT_MASK(ft->initial);
+        rt->states[rt->state_length++] = ft->initial;
+    }
+
+    // Checkpoints after the run died out stay empty
+    for (u64 i = 0;; ++i) {
+        if (i % rt->interval == 0)
+            memcpy(&rt->checkpoints[i / rt->interval * rt->node_words],
+                   rt->active, rt->node_words * sizeof(u64));
+        if (i == rt->len || !rt->state_length) break;
+
+        // Checking every symbol would make the counters bounce between cores
+        if (job && (i & 4095) == 0) {
+            if (job_is_cancelled(job)) return;
+            job_set_progress(job, i);
+        }
+
+        rt->next_state_length = run_trace_take(
+            ft, rt->input[i], rt->states, rt->state_length, rt->next_states,
+            rt->next_active, NULL);
+        run_trace_swap(rt);
+    }
+
+    rt->accepted = false;
+    for (u32 i = 0; i < rt->state_length && !rt->accepted; ++i)
+        rt->accepted = ft->flags[rt->states[i]] & FSM_STATE_ACCEPTING;
+
+    // The cursor starts over at the first lookup
+    run_trace_clear_row(rt->active, rt->states, rt->state_length);
+    rt->state_length = 0;
+    rt->step = UINT64_MAX;
+
+    if (job) job_set_progress(job, rt->len);
+}
+
+static void run_trace_job(Job *job) {
+    run_trace_build((RunTrace *)job->data, job);
+}
+
+void run_trace_run(RunTrace *rt, WorkerPool *wp, CompletionQueue *completed) {
+    job_init(&rt->job, run_trace_job, rt, completed);
+    rt->job.total = rt->len;
+    worker_pool_submit(wp, &rt->job);
+}
+
+bool run_trace_is_active(RunTrace *rt, u64 step, u32 node) {
+    if (!rt->checkpoints || step > rt->len) return false;
+    if (node >= rt->table.state_count) return false;
+    run_trace_seek(rt, step);
+    return rt->active[BIT_WORD(node)] & BIT_MASK(node);
+}
+
+bool run_trace_has_fired(RunTrace *rt, u64 symbol, u32 tline) {
+    if (!rt->checkpoints || symbol >= rt->len) return false;
+    if (tline >= rt->table.tline_count) return false;
+    run_trace_seek(rt, symbol);
+    return rt->fired[BIT_WORD(tline)] & BIT_MASK(tline);
+}
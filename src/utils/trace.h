@@ -0,0 +1,57 @@
+#pragma once
+
+#include "defines.h"
+#include "table.h"
+#include "worker.h"
+
+// Bytes the checkpoints of a trace may take, the interval between them grows
+// with the input so that long inputs on large automata stay bounded
+#define RUN_TRACE_CHECKPOINT_BUDGET (16 * 1024 * 1024)
+// Fewest steps between two checkpoints, a lookup replays at most this many
+// steps while the budget allows it
+#define RUN_TRACE_MIN_INTERVAL 64
+
+// A run of the automaton over an input. The active nodes are kept every
+// interval steps, any other step is replayed from the checkpoint before it.
+// A cursor keeps the last replayed step, so stepping through the run in
+// order costs a single step each time
+typedef struct RunTrace {
+        char *input;  // Copy of the input
+        u64 len;  // Number of input symbols
+        FsmTable table;  // Copy, the model may change while the job runs
+        u64 *checkpoints;  // Active node bitset every interval steps
+        u64 interval;
+        u32 node_words;  // u64 words per active row
+        u32 tline_words;  // u64 words per fired row
+        bool accepted;
+        u64 step;  // Of the cursor, UINT64_MAX before the first lookup
+        u64 *active;  // Active nodes after step symbols
+        u64 *next_active;  // Active nodes after step + 1 symbols
+        u64 *fired;  // Tlines taken while consuming symbol step
+        u32 *states;  // Active nodes after step symbols as a list
+        u32 *next_states;
+        u32 state_length;
+        u32 next_state_length;
+        Job job;  // Its data is the trace
+} RunTrace;
+
+// Copies the table and the input. Node and tline bits are the state and
+// tline indices of the table
+bool run_trace_create(RunTrace *rt, FsmTable *ft, const char *input, u64 len);
+
+// Must not be called while the job is submitted and not yet completed
+void run_trace_destroy(RunTrace *rt);
+
+// Runs the automaton over the whole input and records the checkpoints. The
+// job may be NULL, otherwise it is polled for cancellation and progress
+void run_trace_build(RunTrace *rt, Job *job);
+
+// Submits the build, the job is pushed to the completion queue once it is
+// done or cancelled
+void run_trace_run(RunTrace *rt, WorkerPool *wp, CompletionQueue *completed);
+
+// Whether the node is active after consuming step symbols
+bool run_trace_is_active(RunTrace *rt, u64 step, u32 node);
+
+// Whether the tline was taken while consuming the given symbol
+bool run_trace_has_fired(RunTrace *rt, u64 symbol, u32 tline);
@@ -0,0 +1,146 @@
+#include "worker.h"
+
+#include <stdlib.h>
+
+static void worker_pool_work(void *arg);
+static void worker_pool_complete(Job *job);
+
+bool worker_pool_create(WorkerPool *wp, u32 thread_count) {
+    wp->first = wp->last = NULL;
+    wp->stopping = false;
+    wp->thread_count = 0;
+    wp->threads = (Thread *)calloc(thread_count, sizeof(Thread));
+    if (!wp->threads) return false;
+
+    if (!mutex_create(&wp->mutex)) {
+        free(wp->threads);
+        return false;
+    }
+    if (!cond_create(&wp->cond)) {
+        mutex_destroy(&wp->mutex);
+        free(wp->threads);
+        return false;
+    }
+
+    for (u32 i = 0; i < thread_count; ++i)
+        if (thread_create(&wp->threads[wp->thread_count], worker_pool_work,
+                          wp))
+            wp->thread_count++;
+
+    if (wp->thread_count) return true;
+
+    worker_pool_destroy(wp);
+    return false;
+}
+
+void worker_pool_destroy(WorkerPool *wp) {
+    if (!wp->threads) return;
+
+    mutex_lock(&wp->mutex);
+    wp->stopping = true;
+    for (Job *job = wp->first; job; job = job->next) job_cancel(job);
+    cond_broadcast(&wp->cond);
+    mutex_unlock(&wp->mutex);
+
+    for (u32 i = 0; i < wp->thread_count; ++i) thread_join(&wp->threads[i]);
+
+    cond_destroy(&wp->cond);
+    mutex_destroy(&wp->mutex);
+    free(wp->threads);
+    wp->threads = NULL;
+    wp->thread_count = 0;
+}
+
+void worker_pool_submit(WorkerPool *wp, Job *job) {
+    job->next = NULL;
+
+    mutex_lock(&wp->mutex);
+    if (wp->last)
+        wp->last->next = job;
+    else
+        wp->first = job;
+    wp->last = job;
+    cond_broadcast(&wp->cond);
+    mutex_unlock(&wp->mutex);
+}
+
+void job_init(Job *job, JobFunc run, void *data, CompletionQueue *completed) {
+    job->run = run;
+    job->data = data;
+    job->completed = completed;
+    job->progress = 0;
+    job->total = 1;
+    job->cancel = 0;
+    job->finished = 0;
+    job->next = NULL;
+}
+
+void job_cancel(Job *job) {
+    sync_store_u64(&job->cancel, 1);
+}
+
+bool job_is_cancelled(Job *job) {
+    return sync_load_u64(&job->cancel);
+}
+
+bool job_is_finished(Job *job) {
+    return sync_load_u64(&job->finished);
+}
+
+void job_set_progress(Job *job, u64 progress) {
+    sync_store_u64(&job->progress, progress);
+}
+
+void job_set_progress_of(Job *job, u64 done, u64 all) {
+    job_set_progress(job, all ? MIN(done, all) * job->total / all : job->total);
+}
+
+float job_get_progress(Job *job) {
+    if (!job->total) return 1.0f;
+    return (float)sync_load_u64(&job->progress) / job->total;
+}
+
+// Only the owner pops, so the head can not be popped and pushed back between
+// reading its next pointer and the exchange
+Job *completion_queue_pop(CompletionQueue *cq) {
+    Job *head = sync_load_ptr((void *volatile *)&cq->head);
+    while (head
+           && !sync_cas_ptr((void *volatile *)&cq->head, head, head->next))
+        head = sync_load_ptr((void *volatile *)&cq->head);
+
+    return head;
+}
+
+static void worker_pool_work(void *arg) {
+    WorkerPool *wp = (WorkerPool *)arg;
+
+    mutex_lock(&wp->mutex);
+    for (;;) {
+        while (!wp->first && !wp->stopping) cond_wait(&wp->cond, &wp->mutex);
+        // Jobs left when stopping are cancelled and only handed back
+        if (!wp->first) break;
+
+        Job *job = wp->first;
+        wp->first = job->next;
+        if (!wp->first) wp->last = NULL;
+        mutex_unlock(&wp->mutex);
+
+        if (!job_is_cancelled(job)) job->run(job);
+        worker_pool_complete(job);
+
+        mutex_lock(&wp->mutex);
+    }
+    mutex_unlock(&wp->mutex);
+}
+
+static void worker_pool_complete(Job *job) {
+    CompletionQueue *cq = job->completed;
+    sync_store_u64(&job->finished, 1);
+
+    // The job belongs to its owner as soon as it is on the stack
+    Job *head;
+    do {
+        head = sync_load_ptr((void *volatile *)&cq->head);
+        job->next = head;
+    } while (!sync_cas_ptr((void *volatile *)&cq->head, head, job));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "defines.h"
+#include "thread.h"
+
+typedef struct Job Job;
+
+typedef void (*JobFunc)(Job *job);
+
+// Lock-free stack of finished jobs. Any thread may push, only the owner pops
+typedef struct CompletionQueue {
+        Job *volatile head;
+} CompletionQueue;
+
+struct Job {
+        JobFunc run;  // Called on a worker thread, skipped once cancelled
+        void *data;
+        CompletionQueue *completed;  // Receives the job when it is finished
+        volatile u64 progress;  // Units of work done so far
+        u64 total;  // Units of work in the whole job
+        volatile u64 cancel;  // Polled by run to stop early
+        volatile u64 finished;  // Results can be read once this is set
+        Job *next;
+};
+
+typedef struct WorkerPool {
+        Thread *threads;
+        u32 thread_count;
+        Mutex mutex;
+        Cond cond;
+        Job *first;  // Pending jobs, in submission order
+        Job *last;
+        bool stopping;
+} WorkerPool;
+
+bool worker_pool_create(WorkerPool *wp, u32 thread_count);
+
+// Pending jobs are completed without running, running ones are waited for
+void worker_pool_destroy(WorkerPool *wp);
+
+void worker_pool_submit(WorkerPool *wp, Job *job);
+
+void job_init(Job *job, JobFunc run, void *data, CompletionQueue *completed);
+
+void job_cancel(Job *job);
+
+bool job_is_cancelled(Job *job);
+
+bool job_is_finished(Job *job);
+
+void job_set_progress(Job *job, u64 progress);
+
+// For work that is only sized once it runs, scales done/all to the total
+void job_set_progress_of(Job *job, u64 done, u64 all);
+
+// Fraction of the work done, between 0 and 1
+float job_get_progress(Job *job);
+
+// Returns NULL when no finished job is left, the owner frees what it gets
+Job *completion_queue_pop(CompletionQueue *cq);